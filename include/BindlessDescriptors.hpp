@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+// Free list of the slots of one descriptor array. Freed slots are handed out again before
+// untouched ones, so the arrays stay dense at the bottom.
+class DescriptorSlotAllocator {
+	public:
+		void init(uint32_t capacity);
+		// throws once every slot is in use
+		uint32_t allocate();
+		void free(uint32_t slot);
+
+		uint32_t capacity() const { return static_cast<uint32_t>(_used.size()); }
+		uint32_t usedCount() const { return capacity() - static_cast<uint32_t>(_freeSlots.size()); }
+
+	private:
+		std::vector<uint32_t> _freeSlots;	// next slot on top
+		std::vector<bool> _used;
+};
+
+// One descriptor set holding every buffer and image the shaders read, as two large update-after-bind,
+// partially bound arrays. Resources are added once and get a slot, shaders index the arrays with
+// slots handed over in push constants, so the set is bound once per command buffer no matter how
+// many objects or materials are drawn.
+//   binding 0: StructuredBuffer<T> buffers[], storage buffers
+//   binding 1: Texture2D images[], sampled images
+// Slots are written immediately. A slot may only be removed once no pending command buffer reads it.
+class BindlessDescriptors {
+	public:
+		static constexpr uint32_t BUFFER_BINDING = 0;
+		static constexpr uint32_t IMAGE_BINDING = 1;
+		// upper bounds, init() lowers them to what the device allows
+		static constexpr uint32_t MAX_BUFFERS = 65536;
+		static constexpr uint32_t MAX_IMAGES = 16384;
+
+		// Vulkan 1.2 descriptor indexing features the arrays need
+		static bool supported(const vk::PhysicalDeviceVulkan12Features& features);
+		static void enableFeatures(vk::PhysicalDeviceVulkan12Features& features);
+
+		void init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::ShaderStageFlags stageFlags);
+		void destroy();
+
+		uint32_t addBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range);
+		uint32_t addImage(vk::ImageView imageView, vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+		void removeBuffer(uint32_t slot) { _bufferSlots.free(slot); }
+		void removeImage(uint32_t slot) { _imageSlots.free(slot); }
+
+		vk::DescriptorSetLayout layout() const { return _descriptorSetLayout; }
+		vk::DescriptorSet descriptorSet() const { return _descriptorSet; }
+		uint32_t bufferCount() const { return _bufferSlots.usedCount(); }
+		uint32_t imageCount() const { return _imageSlots.usedCount(); }
+
+	private:
+		vk::Device _device;
+		vk::DescriptorSetLayout _descriptorSetLayout;
+		vk::DescriptorPool _descriptorPool;
+		vk::DescriptorSet _descriptorSet;
+		DescriptorSlotAllocator _bufferSlots;
+		DescriptorSlotAllocator _imageSlots;
+};
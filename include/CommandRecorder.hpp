@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+#include "JobSystem.hpp"
+
+// Remembers what one command buffer has bound and drops binds that would change nothing.
+// Secondary command buffers inherit no state, so every recorded chunk needs its own.
+class BindCache {
+	public:
+		explicit BindCache(vk::CommandBuffer commandBuffer) : _commandBuffer(commandBuffer) {}
+
+		void bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline);
+		static constexpr uint32_t MAX_SETS = 4;
+		static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 4;
+
+		// a set is only redundant when its dynamic offsets match too
+		void bindDescriptorSet(vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout, uint32_t setIndex, vk::DescriptorSet descriptorSet, vk::ArrayProxy<const uint32_t> dynamicOffsets = nullptr);
+		void bindVertexBuffer(vk::Buffer buffer, vk::DeviceSize offset);
+		void bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::IndexType indexType);
+
+		// binds recorded and binds dropped as redundant so far
+		uint32_t bindCount() const { return _bindCount; }
+		uint32_t skippedCount() const { return _skippedCount; }
+
+	private:
+		vk::CommandBuffer _commandBuffer;
+		struct BoundSet {
+			vk::DescriptorSet descriptorSet;
+			std::array<uint32_t, MAX_DYNAMIC_OFFSETS> dynamicOffsets = {};
+			uint32_t dynamicOffsetCount = 0;
+		};
+
+		vk::Pipeline _pipeline;
+		vk::PipelineLayout _pipelineLayout;	// of the bound sets, another layout forgets them all
+		std::array<BoundSet, MAX_SETS> _sets;
+		vk::Buffer _vertexBuffer;
+		vk::DeviceSize _vertexOffset = 0;
+		vk::Buffer _indexBuffer;
+		vk::DeviceSize _indexOffset = 0;
+		vk::IndexType _indexType = vk::IndexType::eUint16;
+		uint32_t _bindCount = 0;
+		uint32_t _skippedCount = 0;
+
+		// counts the bind and returns true if it has to be recorded
+		bool changes(bool redundant);
+};
+
+// Records a draw list into secondary command buffers as jobs on the JobSystem.
+// Every chunk slot owns one command pool per frame in flight; a slot is only ever used by
+// one job at a time and reset once that frame's fence has signaled.
+class CommandRecorder {
+	public:
+		// records items [first, last) into commandBuffer, called concurrently from several threads
+		using RecordRange = std::function<void(vk::CommandBuffer commandBuffer, uint32_t first, uint32_t last)>;
+
+		// below this many items per chunk the split costs more than it saves
+		static constexpr uint32_t MIN_ITEMS_PER_THREAD = 64;
+
+		void init(vk::Device device, JobSystem& jobSystem, uint32_t queueFamilyIndex, uint32_t frameCount);
+		void destroy();
+
+		// Returns the secondary command buffers in draw order, ready for executeCommands()
+		std::vector<vk::CommandBuffer> record(uint32_t frame, const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t itemCount, const RecordRange& recordRange);
+
+		uint32_t threadCount() const { return static_cast<uint32_t>(_threadFrames.size()); }
+
+	private:
+		struct ThreadFrame {
+			vk::CommandPool commandPool;
+			vk::CommandBuffer commandBuffer;
+		};
+
+		vk::Device _device;
+		JobSystem* _jobSystem = nullptr;
+		std::vector<std::vector<ThreadFrame>> _threadFrames;	// [chunk][frame]
+
+		void recordChunk(uint32_t chunk, uint32_t chunkCount, uint32_t frame, const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t itemCount, const RecordRange& recordRange);
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+#include "glm/glm.hpp"
+#include "MemoryAllocator.hpp"
+
+// Mirrors ObjectData in shaders/cull.hlsl (std430, 48 bytes)
+struct ObjectData {
+	glm::vec4 boundingSphere;	// xyz center in mesh space, w radius
+	uint32_t indexCount = 0;	// LOD 0
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstMeshlet = 0;	// the mesh's meshlets, meshletCount 0 when it has none
+	uint32_t meshletCount = 0;
+	uint32_t firstLod = 0;	// the mesh's LODs in the LOD buffer, at least one
+	uint32_t lodCount = 1;
+	uint32_t padding = 0;
+};
+
+// Mirrors LodData in shaders/cull.hlsl, the index range of one LOD of a mesh
+struct LodData {
+	uint32_t firstIndex = 0;	// absolute, the mesh's firstIndex already added
+	uint32_t indexCount = 0;
+};
+
+// Mirrors MeshletData in shaders/cull.hlsl (std430, 48 bytes), a MeshletRecord placed in the shared index buffer
+struct MeshletData {
+	glm::vec4 boundingSphere;	// xyz center in mesh space, w radius
+	glm::vec4 cone;	// xyz axis, w cutoff, see MeshletRecord
+	uint32_t firstIndex = 0;	// absolute, the mesh's firstIndex already added
+	uint32_t indexCount = 0;
+	uint32_t padding[2] = {};
+};
+
+// Mirrors ClusterData in shaders/cull.hlsl, one meshlet of one object. Clusters are listed object
+// by object, each object's in the order of its meshlets.
+struct ClusterData {
+	uint32_t object = 0;
+	uint32_t meshlet = 0;
+};
+
+// Mirrors InstanceData in shaders/shader.hlsl and cull.hlsl (std430, 112 bytes), one per object,
+// rewritten every frame into that frame's region of the instance ring
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec4 color;
+	glm::vec4 positionDecode;	// mesh position = xyz + stored position * w, see VertexLayout.hpp
+	uint32_t lod = 0;	// this frame's LOD, relative to the object's firstLod
+	uint32_t padding[3] = {};
+};
+
+// Mesh space bounding sphere in scene space, the radius scaled by the largest axis of model
+glm::vec4 worldBoundingSphere(const glm::vec4& sphere, const glm::mat4& model);
+
+// Six planes pointing inwards, normalized so plane distances are in scene units
+struct Frustum {
+	std::array<glm::vec4, 6> planes;
+
+	// Gribb/Hartmann extraction from a scene-to-clip matrix, same as CS_main in cull.hlsl
+	static Frustum fromMatrix(const glm::mat4& matrix);
+	// smallest signed distance of the sphere to any plane, negative = fully outside
+	float sphereMargin(const glm::vec4& sphere) const;
+};
+
+// Signed distance of the meshlet's triangles to all facing away from cameraPosition, positive = all
+// backfacing. Assumes model has a uniform scale, like everything TransformSystem writes.
+float meshletConeMargin(const MeshletData& meshlet, const InstanceData& instance, const glm::vec3& cameraPosition);
+
+// CPU reference of the cull shader: one indirect draw of the instance's LOD per visible object, in
+// object order, firstInstance is the object index
+void cullObjects(const std::vector<ObjectData>& objects, const std::vector<LodData>& lods, const InstanceData* instances, const Frustum& frustum, std::vector<vk::DrawIndexedIndirectCommand>& drawCommands);
+// CPU reference of the cluster cull shader: one indirect draw per meshlet of a visible object whose
+// own sphere is inside the frustum and that is not entirely backfacing, in cluster order. Meshlets
+// only cover LOD 0, an object at a coarser LOD is drawn whole in place of its first cluster.
+void cullClusters(const std::vector<ObjectData>& objects, const std::vector<LodData>& lods, const std::vector<MeshletData>& meshlets, const std::vector<ClusterData>& clusters, const InstanceData* instances, const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<vk::DrawIndexedIndirectCommand>& drawCommands);
+
+// Frustum culls the object buffer in a compute shader and compacts the survivors, each at the LOD
+// its instance picked, into a per-frame indirect buffer plus draw count for drawIndexedIndirectCount.
+// Given clusters, it culls every meshlet of every object instead (frustum and backface cone) and
+// emits one draw per surviving meshlet, for the same graphics pipeline. This only needs compute
+// and drawIndexedIndirectCount, no mesh shaders, so it runs anywhere GPU culling does.
+// With validation on, the results are read back and checked against cullObjects() / cullClusters().
+class CullingPass {
+	public:
+		static constexpr uint32_t WORKGROUP_SIZE = 64;
+		// maxComputeWorkGroupCount[0] every device supports, larger dispatches wrap into y
+		static constexpr uint32_t MAX_WORKGROUPS_X = 65535;
+
+		// instanceBuffer holds one region of instanceRegionSize bytes per frame in flight. The uniforms are
+		// bound at a dynamic offset into uniformBuffer, passed to record() every frame.
+		// clusters empty = object culling, meshlets / meshletBuffer / clusterBuffer are unused then.
+		void init(vk::Device device, MemoryAllocator& allocator, vk::PipelineCache pipelineCache, const std::vector<ObjectData>& objects, vk::Buffer objectBuffer, const std::vector<LodData>& lods, vk::Buffer lodBuffer, vk::Buffer instanceBuffer, vk::DeviceSize instanceRegionSize, uint32_t frameCount, vk::Buffer uniformBuffer, vk::DeviceSize uniformBufferSize,
+			const std::vector<MeshletData>& meshlets, vk::Buffer meshletBuffer, const std::vector<ClusterData>& clusters, vk::Buffer clusterBuffer, bool validate);
+		void destroy();
+
+		// Records the count reset and the cull dispatch. Must be recorded outside a render pass, the
+		// caller makes the result visible to indirect draws, see VulkanEngine::initRenderGraph().
+		void record(vk::CommandBuffer commandBuffer, uint32_t frame, uint32_t uniformOffset, const glm::mat4& cullMatrix, const glm::vec3& cameraPosition);
+		// Copies this frame's result for validate(), record after the last indirect draw and a barrier
+		// from the cull dispatch to transfer reads
+		void recordReadback(vk::CommandBuffer commandBuffer, uint32_t frame);
+		// Checks the frame's readback against the CPU reference once its fence has signaled,
+		// instances is the frame's region of the instance ring, still holding what the GPU culled
+		void validate(uint32_t frame, const InstanceData* instances);
+
+		vk::Buffer indirectBuffer(uint32_t frame) const { return _frames[frame].indirectBuffer; }
+		vk::Buffer countBuffer(uint32_t frame) const { return _frames[frame].countBuffer; }
+		uint32_t maxDrawCount() const { return itemCount(); }
+		uint32_t validatedFrameCount() const { return _validatedFrameCount; }
+
+	private:
+		struct Frame {
+			vk::Buffer indirectBuffer;
+			Allocation indirectAllocation;
+			vk::Buffer countBuffer;
+			Allocation countAllocation;
+			vk::Buffer readbackBuffer;
+			Allocation readbackAllocation;
+			vk::DescriptorSet descriptorSet;
+			glm::mat4 cullMatrix;
+			glm::vec3 cameraPosition;
+			bool pendingReadback = false;
+		};
+
+		vk::Device _device;
+		MemoryAllocator* _allocator = nullptr;
+		bool _validate = false;
+		std::vector<ObjectData> _objects;
+		std::vector<LodData> _lods;
+		std::vector<MeshletData> _meshlets;
+		std::vector<ClusterData> _clusters;
+		std::vector<Frame> _frames;
+		uint32_t _validatedFrameCount = 0;
+
+		vk::ShaderModule _shaderModule;
+		vk::DescriptorSetLayout _descriptorSetLayout;
+		vk::DescriptorPool _descriptorPool;
+		vk::PipelineLayout _pipelineLayout;
+		vk::Pipeline _pipeline;
+
+		// objects or clusters, one thread and at most one draw each
+		uint32_t itemCount() const { return static_cast<uint32_t>(_clusters.empty() ? _objects.size() : _clusters.size()); }
+		// the object or cluster a draw came from, UINT32_MAX if it matches none
+		uint32_t drawItem(const vk::DrawIndexedIndirectCommand& drawCommand) const;
+		// smallest cull margin of an item, negative = culled
+		float itemMargin(uint32_t item, const InstanceData* instances, const Frustum& frustum, const glm::vec3& cameraPosition) const;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+enum class QueueType {
+	eGraphics,	// rendering and presentation
+	eCompute,	// async compute, GPU culling
+	eTransfer	// uploads
+};
+
+// A semaphore a submit waits on before stages run, value 0 for a binary semaphore
+struct SemaphoreWait {
+	vk::Semaphore semaphore;
+	uint64_t value = 0;
+	vk::PipelineStageFlags stages;
+};
+
+// A semaphore a submit signals once its work has executed, value 0 for a binary semaphore
+struct SemaphoreSignal {
+	vk::Semaphore semaphore;
+	uint64_t value = 0;
+};
+
+// Picks a queue family per QueueType and owns the queues. Compute gets a family without graphics and
+// transfer one with neither when the device has them, so culling and uploads overlap rendering.
+// Otherwise they fall back to the graphics queue, as on lavapipe, and their work serializes with it.
+// Work handed between queues is ordered by timeline semaphores, exclusive buffers also need their
+// ownership released on one family and acquired on the other, see releaseBuffer() / acquireBuffer().
+class DeviceQueues {
+	public:
+		// before device creation, whose queues come from queueCreateInfos()
+		void selectFamilies(vk::PhysicalDevice physicalDevice, bool asyncCompute, bool asyncTransfer);
+		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos() const;
+		void init(vk::Device device);
+
+		vk::Queue queue(QueueType type) const { return _queues[index(type)]; }
+		uint32_t family(QueueType type) const { return _families[index(type)]; }
+		// runs on a family of its own instead of the graphics queue
+		bool dedicated(QueueType type) const { return family(type) != family(QueueType::eGraphics); }
+		// distinct families of types for vk::SharingMode::eConcurrent, empty when they are all one
+		std::vector<uint32_t> sharingFamilies(std::initializer_list<QueueType> types) const;
+
+		void submit(QueueType type, const std::vector<vk::CommandBuffer>& commandBuffers, const std::vector<SemaphoreWait>& waits, const std::vector<SemaphoreSignal>& signals) const;
+
+		// Hands an exclusive buffer from src's family to dst's: release at the end of src's work, acquire
+		// at the start of dst's, with a semaphore between the submits. Records nothing within one family.
+		void releaseBuffer(vk::CommandBuffer commandBuffer, vk::Buffer buffer, QueueType src, QueueType dst, vk::PipelineStageFlags2 srcStages, vk::AccessFlags2 srcAccess) const;
+		void acquireBuffer(vk::CommandBuffer commandBuffer, vk::Buffer buffer, QueueType src, QueueType dst, vk::PipelineStageFlags2 dstStages, vk::AccessFlags2 dstAccess) const;
+
+	private:
+		static size_t index(QueueType type) { return static_cast<size_t>(type); }
+
+		std::array<uint32_t, 3> _families = {};
+		std::array<vk::Queue, 3> _queues;
+};
+
+vk::Semaphore createTimelineSemaphore(vk::Device device, uint64_t initialValue = 0);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+// What a physical device supports among the features the engine requires or has fast paths for
+struct DeviceCapabilities {
+	// required
+	bool timelineSemaphore = false;
+	bool synchronization2 = false;
+	bool swapchain = false;	// windowed only
+	bool present = false;	// windowed only, a graphics family can present to the surface
+	// optional, each turns on a fast path
+	bool drawIndirectCount = false;	// GPU culling, with multiDrawIndirect and drawIndirectFirstInstance
+	bool descriptorIndexing = false;	// bindless, see BindlessDescriptors::supported()
+	bool presentWait = false;	// input latency, see Swapchain::presentWaitSupported()
+	bool dedicatedCompute = false;	// a compute family without graphics
+	bool dedicatedTransfer = false;	// a transfer family without graphics or compute
+	vk::DeviceSize deviceLocalBytes = 0;	// largest device local heap
+};
+
+// A physical device as the selector saw it, rejection is empty for suitable devices
+struct DeviceCandidate {
+	vk::PhysicalDevice physicalDevice;
+	uint32_t index = 0;	// enumeration order
+	std::string name;
+	vk::PhysicalDeviceType type = vk::PhysicalDeviceType::eOther;
+	uint32_t apiVersion = 0;
+	DeviceCapabilities capabilities;
+	std::string rejection;
+	int64_t score = 0;
+};
+
+// Environment variable holding a device override, used when the config sets none
+constexpr const char* DEVICE_OVERRIDE_ENV = "VFS_DEVICE";
+
+// Capabilities and score of every device, surface null when headless
+std::vector<DeviceCandidate> enumerateDevices(vk::Instance instance, vk::SurfaceKHR surface);
+
+// The suitable device with the highest score: discrete over integrated over virtual over CPU, then
+// optional features, dedicated queues and device local memory. overrideName (else $VFS_DEVICE)
+// pins a device by enumeration index, by type (discrete, integrated, virtual, cpu) or by a case
+// insensitive part of its name, e.g. llvmpipe for lavapipe in CI. Throws if nothing is suitable
+// or the override matches no suitable device. Prints every candidate and the choice.
+DeviceCandidate selectPhysicalDevice(vk::Instance instance, vk::SurfaceKHR surface, const std::string& overrideName = "");
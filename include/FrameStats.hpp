@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct MetricSummary {
+	size_t count = 0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+// Per-frame timings in milliseconds plus the submitted triangle count, collected by VulkanEngine::draw() once warm-up frames are done
+struct FrameStats {
+	std::vector<double> cpuFrameMs;		// wall time of draw()
+	std::vector<double> frameWaitMs;	// CPU stalled on the frame timeline semaphore for a free frame in flight
+	std::vector<double> acquireMs;		// acquireNextImageKHR (windowed only)
+	std::vector<double> presentMs;		// presentKHR (windowed only)
+	std::vector<double> gpuMs;			// timestamp delta around the render pass
+	std::vector<double> gpuIdleMs;		// GPU waiting for the CPU between consecutive frames, from timestamps
+	std::vector<double> inputLatencyMs;	// frame sampling input until its image reached the screen (windowed, VK_KHR_present_wait)
+	std::vector<double> triangles;		// triangles of every object's selected LOD, before culling
+	std::vector<double> binds;		// pipeline, descriptor set and buffer binds recorded over all secondary command buffers
+	std::vector<double> bindsSkipped;	// binds BindCache dropped because the state was already bound
+	std::vector<double> framesQueued;	// earlier frames still on the GPU while this one was recorded, the CPU/GPU overlap
+	std::vector<double> pendingDeletions;	// released resources and deferred deletions the GPU has not passed yet
+	std::vector<double> pendingDeletionBytes;	// memory those hold
+	uint32_t framesInFlight = 0;
+	std::string presentMode = "none";	// headless frames are never presented
+	uint32_t swapchainRecreates = 0;
+
+	static MetricSummary summarize(std::vector<double> samples);
+	void writeJson(std::ostream& out, const std::string& deviceName, bool headless) const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+// GPU zones for the trace from timestamp queries around regions of a frame's command buffer, see
+// Tracing.hpp. Timestamps are on the GPU's clock: every frame remembers when the CPU submitted it,
+// the GPU cannot start before that, so the smallest start minus submit time over the whole capture
+// maps GPU time onto the CPU clock. That is off by the shortest submit to start latency seen, tens of
+// microseconds on an idle GPU, and ignores drift between the clocks over the capture.
+class GpuTrace {
+	public:
+		// does nothing unless tracing was started and the queue family has timestamps
+		void init(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount);
+		void destroy();
+		bool enabled() const { return static_cast<bool>(_queryPool); }
+
+		// first thing in the frame's command buffer, resets its queries
+		void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frame);
+		// Zones nest, end() closes the innermost open one. The name is not copied. Zones beyond
+		// MAX_ZONES in a frame are left out.
+		void begin(vk::CommandBuffer commandBuffer, const char* name);
+		void end(vk::CommandBuffer commandBuffer);
+		// right before the frame's command buffer is submitted
+		void submitted(uint32_t frame);
+		// once the frame's submit has finished, reads back its zones
+		void collect(uint32_t frame);
+		// maps every collected zone onto the CPU clock and hands it to the tracer
+		void flush();
+
+		static constexpr uint32_t MAX_ZONES = 32;
+
+	private:
+		struct Zone {
+			const char* name = nullptr;
+			uint32_t query = 0;	// begin, end is the next one
+			uint64_t beginNs = 0;	// GPU clock, once collected
+			uint64_t endNs = 0;
+		};
+
+		struct Frame {
+			std::vector<Zone> zones;
+			std::vector<uint32_t> openZones;
+			uint64_t submitNs = 0;	// traceNow() clock, 0 until submitted
+		};
+
+		vk::Device _device;
+		vk::QueryPool _queryPool;
+		double _timestampPeriod = 1.0;
+		uint64_t _timestampMask = UINT64_MAX;
+		uint32_t _frame = 0;	// being recorded
+		std::vector<Frame> _frames;
+		std::vector<Zone> _collected;
+		int64_t _clockOffset = INT64_MAX;	// GPU minus CPU clock, smallest seen
+};
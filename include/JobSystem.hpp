@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Job = std::function<void()>;
+
+// Counts outstanding jobs. Reaches zero once every job scheduled against it has finished,
+// at which point jobs scheduled to run after it are released.
+class JobCounter {
+	public:
+		bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation {
+			Job job;
+			JobCounter* counter;
+		};
+
+		std::atomic<uint32_t> _pending{ 0 };
+		std::vector<Continuation> _continuations;	// guarded by JobSystem::_continuationMutex
+};
+
+// Work-stealing scheduler. Every thread owns a deque: the owner pushes and pops at the back
+// (most recent first, cache warm), idle threads steal from the front of other deques.
+// Thread 0 is the thread that called init(), it only runs jobs while inside wait().
+class JobSystem {
+	public:
+		// 0 = one worker per hardware thread besides the calling thread
+		void init(uint32_t workerCount = 0);
+		void destroy();
+
+		void schedule(Job job, JobCounter* counter = nullptr);
+		// runs job once dependency reaches zero, without blocking any thread in the meantime
+		void scheduleAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+		// splits [0, count) into chunks of at most grainSize and runs rangeJob(first, last) on each,
+		// rangeJob is referenced, not copied, and must outlive the wait on counter
+		void parallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t first, uint32_t last)>& rangeJob, JobCounter& counter);
+
+		// Runs other jobs until counter reaches zero, so a waiting worker keeps making progress
+		void wait(JobCounter& counter);
+
+		uint32_t workerCount() const { return static_cast<uint32_t>(_workers.size()); }
+		// workers + the thread that owns the system
+		uint32_t threadCount() const { return static_cast<uint32_t>(_queues.size()); }
+		// index of the calling thread, 0 for the owner thread and for threads outside the system
+		static uint32_t threadIndex();
+
+	private:
+		struct Task {
+			Job job;
+			JobCounter* counter = nullptr;
+		};
+
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::unique_ptr<WorkQueue>> _queues;	// one per thread, [0] = owner thread
+		std::vector<std::thread> _workers;
+
+		std::atomic<uint32_t> _queuedTasks{ 0 };
+		std::atomic<uint32_t> _sleepingWorkers{ 0 };
+		std::atomic<bool> _quit{ false };
+		std::mutex _sleepMutex;
+		std::condition_variable _workAvailable;
+		std::mutex _continuationMutex;
+
+		void push(Task task);
+		bool pop(uint32_t queueIndex, Task& task);
+		bool steal(uint32_t thiefIndex, Task& task);
+		bool runOneTask(uint32_t threadIndex);
+		void finish(JobCounter* counter);
+		void workerLoop(uint32_t threadIndex);
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+#include "MeshFile.hpp"
+
+// Runtime choice between the discrete LODs MeshConverter stores per mesh: every LOD's mesh space
+// error (MeshLod::error) is projected to pixels at the object's distance from the camera and the
+// coarsest one within the pixel threshold wins.
+constexpr float LOD_HYSTERESIS = 0.25f;	// how far below the threshold a coarser LOD has to be before it is taken
+
+// Pixels one mesh space unit covers, measured at the point of the bounding sphere nearest to the
+// camera and scaled by the largest axis of model. projectionScale = |projection[1][1]| * viewport
+// height / 2, distances below nearPlane are clamped so objects around the camera keep LOD 0.
+float meshPixelsPerUnit(const glm::vec4& boundingSphere, const glm::mat4& model, const glm::vec3& cameraPosition, float projectionScale, float nearPlane);
+
+// Coarsest LOD whose projected error is at most errorPixels. An object moves to a finer LOD as soon
+// as its current one exceeds errorPixels, but to a coarser one only once that is below
+// errorPixels * (1 - hysteresis), so objects near a threshold distance do not pop back and forth.
+// lods must have non-decreasing errors, as MeshConverter writes them.
+uint32_t selectLod(const MeshLod* lods, uint32_t lodCount, float pixelsPerUnit, uint32_t currentLod, float errorPixels, float hysteresis = LOD_HYSTERESIS);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+enum class AllocationStrategy {
+	eBuddy,		// general purpose, power-of-two sub-allocation with coalescing on free
+	eLinear		// bump allocation for short lived data (staging), block rewinds once it is empty
+};
+
+struct Allocation {
+	vk::DeviceMemory deviceMemory;
+	vk::DeviceSize offset = 0;
+	vk::DeviceSize size = 0;			// requested size
+	vk::DeviceSize allocatedSize = 0;	// size actually reserved in the block
+	void* mapped = nullptr;				// persistently mapped pointer for host visible memory
+	uint32_t memoryTypeIndex = UINT32_MAX;
+	uint32_t blockIndex = UINT32_MAX;
+	AllocationStrategy strategy = AllocationStrategy::eBuddy;
+	bool dedicated = false;				// owns its vk::DeviceMemory (request larger than a block)
+};
+
+struct AllocatorStats {
+	uint32_t deviceMemoryCount = 0;
+	uint32_t allocationCount = 0;
+	vk::DeviceSize reservedBytes = 0;		// bytes obtained from vkAllocateMemory
+	vk::DeviceSize requestedBytes = 0;		// bytes asked for by callers
+	vk::DeviceSize allocatedBytes = 0;		// bytes handed out after alignment / rounding
+	vk::DeviceSize freeBytes = 0;
+	vk::DeviceSize largestFreeRange = 0;
+
+	// wasted space inside allocations due to rounding
+	float internalFragmentation() const;
+	// how badly the free space is split: 0 = one contiguous range, -> 1 = many small holes
+	float externalFragmentation() const;
+};
+
+class MemoryAllocator {
+	public:
+		static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+		static constexpr vk::DeviceSize MIN_BUDDY_SIZE = 256;
+
+		void init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+		void destroy();
+
+		Allocation allocate(const vk::MemoryRequirements& memoryRequirements, vk::MemoryPropertyFlags memoryPropertyFlags, AllocationStrategy strategy = AllocationStrategy::eBuddy, bool optimalTilingImage = false);
+		void free(Allocation& allocation);
+
+		AllocatorStats getStats() const;
+		void printStats(std::ostream& out) const;
+
+	private:
+		struct MemoryBlock {
+			vk::DeviceMemory deviceMemory;
+			vk::DeviceSize size = 0;
+			void* mapped = nullptr;
+			AllocationStrategy strategy = AllocationStrategy::eBuddy;
+			uint32_t liveAllocations = 0;
+			vk::DeviceSize requestedBytes = 0;
+			vk::DeviceSize allocatedBytes = 0;
+
+			//buddy: free offsets per order, order 0 == MIN_BUDDY_SIZE
+			std::vector<std::set<vk::DeviceSize>> freeLists;
+			//linear: bump pointer
+			vk::DeviceSize head = 0;
+		};
+
+		struct MemoryPool {
+			std::vector<std::unique_ptr<MemoryBlock>> blocks;
+		};
+
+		vk::PhysicalDevice _physicalDevice;
+		vk::Device _device;
+		vk::PhysicalDeviceMemoryProperties _memoryProperties;
+		vk::DeviceSize _blockSize = DEFAULT_BLOCK_SIZE;
+		vk::DeviceSize _bufferImageGranularity = 1;
+		uint32_t _maxMemoryAllocationCount = 0;
+		uint32_t _deviceMemoryCount = 0;
+		std::vector<MemoryPool> _pools;
+		std::vector<std::unique_ptr<MemoryBlock>> _dedicatedBlocks;
+
+		uint32_t findMemoryTypeIndex(uint32_t typeFilter, vk::MemoryPropertyFlags memoryPropertyFlags) const;
+		std::unique_ptr<MemoryBlock> createBlock(uint32_t memoryTypeIndex, vk::DeviceSize size, AllocationStrategy strategy);
+		void destroyBlock(MemoryBlock& block);
+
+		bool allocateBuddy(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset, vk::DeviceSize& allocatedSize);
+		void freeBuddy(MemoryBlock& block, vk::DeviceSize offset, vk::DeviceSize allocatedSize);
+		bool allocateLinear(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset, vk::DeviceSize& allocatedSize);
+		uint32_t orderCount(vk::DeviceSize blockSize) const;
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary mesh container (.mesh), laid out so a memory mapping can be copied straight into
+// staging memory:
+//   MeshFileHeader
+//   per mesh: vertex blob, index blob, meshlet blob, each starting on MESH_BLOB_ALIGNMENT
+//   MeshRecord[meshCount] at meshTableOffset
+// The table goes last so meshes can be streamed out one at a time by MeshFileWriter.
+// All values are little endian.
+constexpr uint32_t MESH_FILE_MAGIC = 0x4853454d;	// "MESH"
+constexpr uint32_t MESH_FILE_VERSION = 3;
+constexpr uint64_t MESH_BLOB_ALIGNMENT = 256;
+constexpr uint32_t MAX_MESH_LODS = 8;
+constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+struct MeshFileHeader {
+	uint32_t magic = MESH_FILE_MAGIC;
+	uint32_t version = MESH_FILE_VERSION;
+	uint32_t meshCount = 0;
+	uint32_t padding = 0;
+	uint64_t meshTableOffset = 0;
+	// sums over all meshes, enough to size one vertex and one index buffer for the whole file
+	uint64_t vertexDataSize = 0;
+	uint64_t indexDataSize = 0;
+	uint64_t meshletDataSize = 0;
+	uint64_t reserved[2] = {};
+};
+static_assert(sizeof(MeshFileHeader) == 64);
+
+// Index range of one level of detail, relative to the mesh's first index. LOD 0 is the full mesh.
+struct MeshLod {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f;	// object space error against LOD 0
+	uint32_t padding = 0;
+};
+static_assert(sizeof(MeshLod) == 16);
+
+// A contiguous run of LOD 0 triangles touching at most MAX_MESHLET_VERTICES vertices, the unit
+// of cluster culling. The cone bounds the triangle normals: the whole meshlet faces away from
+// a camera at c when dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius.
+struct MeshletRecord {
+	float boundingSphere[4] = {};	// xyz center, w radius, mesh space
+	float coneAxis[3] = {};
+	float coneCutoff = 1.0f;	// sine of the cone's half angle, 1 = never backfacing
+	uint32_t firstIndex = 0;	// relative to the mesh's first index
+	uint32_t indexCount = 0;
+	uint32_t vertexCount = 0;
+	uint32_t padding = 0;
+};
+static_assert(sizeof(MeshletRecord) == 48);
+
+struct MeshRecord {
+	float boundingSphere[4] = {};	// xyz center, w radius, mesh space
+	float aabbMin[4] = {};
+	float aabbMax[4] = {};
+	uint64_t vertexOffset = 0;	// file offsets of the blobs
+	uint64_t indexOffset = 0;
+	uint64_t meshletOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	uint32_t vertexLayout = 0;	// VertexLayout::key()
+	uint32_t indexCount = 0;
+	uint32_t indexSize = 4;	// 2 or 4 bytes
+	uint32_t lodCount = 0;
+	uint32_t meshletCount = 0;	// 0 when the converter built none
+	uint32_t padding = 0;
+	float positionDecode[4] = { 0.0f, 0.0f, 0.0f, 1.0f };	// PositionDecode, xyz offset, w scale
+	MeshLod lods[MAX_MESH_LODS];
+};
+static_assert(sizeof(MeshRecord) == 248);
+
+// Read-only memory mapping of a mesh file. open() validates the header and every record
+// against the file size, after that all pointers handed out stay valid until close().
+class MeshFile {
+	public:
+		void open(const std::string& path);
+		void close();
+
+		const MeshFileHeader& header() const { return *reinterpret_cast<const MeshFileHeader*>(_data); }
+		uint32_t meshCount() const { return header().meshCount; }
+		const MeshRecord& mesh(uint32_t index) const { return reinterpret_cast<const MeshRecord*>(_data + header().meshTableOffset)[index]; }
+		const void* vertexData(uint32_t index) const { return _data + mesh(index).vertexOffset; }
+		const void* indexData(uint32_t index) const { return _data + mesh(index).indexOffset; }
+		const MeshletRecord* meshlets(uint32_t index) const { return reinterpret_cast<const MeshletRecord*>(_data + mesh(index).meshletOffset); }
+
+		const uint8_t* data() const { return _data; }
+		uint64_t size() const { return _size; }
+
+	private:
+		std::string _path;
+		const uint8_t* _data = nullptr;
+		uint64_t _size = 0;
+#ifdef _WIN32
+		void* _fileHandle = nullptr;
+		void* _mappingHandle = nullptr;
+#else
+		int _fileDescriptor = -1;
+#endif
+
+		void validate() const;
+};
+
+// Source of one mesh for MeshFileWriter, the data is only read during addMesh()
+struct MeshSource {
+	const void* vertices = nullptr;
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	uint32_t vertexLayout = 0;
+	float positionDecode[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const void* indices = nullptr;
+	uint32_t indexCount = 0;
+	uint32_t indexSize = 4;
+	float boundingSphere[4] = {};
+	float aabbMin[3] = {};
+	float aabbMax[3] = {};
+	// empty = a single LOD covering all indices
+	std::vector<MeshLod> lods;
+	std::vector<MeshletRecord> meshlets;
+};
+
+// Streams meshes into a new file, only the mesh table is kept in memory
+class MeshFileWriter {
+	public:
+		void open(const std::string& path);
+		void addMesh(const MeshSource& source);
+		// writes the mesh table and patches the header
+		void close();
+
+		uint64_t bytesWritten() const { return _offset; }
+
+	private:
+		std::string _path;
+		std::ofstream _file;
+		uint64_t _offset = 0;
+		MeshFileHeader _header;
+		std::vector<MeshRecord> _records;
+
+		void write(const void* data, uint64_t size);
+		void align();
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Import time index and vertex reordering for triangle lists, run by MeshConverter in this order:
+//   optimizeVertexCache, optimizeOverdraw, optimizeVertexFetch
+// All functions work on 32 bit indices, the converter narrows them to 16 bit afterwards when the
+// vertex count allows it.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;	// post-transform FIFO entries the optimizer targets
+constexpr float OVERDRAW_THRESHOLD = 1.05f;	// ACMR the overdraw pass may give up, relative to the input
+constexpr float BORDER_QUADRIC_WEIGHT = 10.0f;	// how much more a border edge resists moving than a triangle plane
+
+struct VertexCacheStatistics {
+	uint32_t verticesTransformed = 0;	// cache misses
+	float acmr = 0.0f;	// transformed vertices per triangle, 0.5 is the limit for regular grids, 3 is no reuse
+	float atvr = 0.0f;	// transformed vertices per referenced vertex, 1 is optimal
+};
+// Simulates a FIFO post-transform cache of cacheSize entries
+VertexCacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander et al. 2007): fans triangles around the vertex that is most likely still in the
+// cache, linear in the triangle count. destination may not alias indices.
+void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+
+// Splits the cache optimized order into clusters wherever the cache restarts or the ACMR of the
+// cluster so far stays within threshold, then sorts clusters so the ones facing away from the mesh
+// center (likely occluders from any view) are drawn first. positions are xyz floats.
+void optimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount, float threshold = OVERDRAW_THRESHOLD);
+
+// Remap table for ordering vertices by first use: remap[old] = new, or UINT32_MAX for vertices no
+// triangle references. Returns the number of vertices kept. Rewrites indices in place.
+uint32_t optimizeVertexFetch(uint32_t* indices, size_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap);
+
+// Quadric edge collapse (Garland and Heckbert 1997) for LODs. Vertices only ever move onto a
+// neighbour, so the result still indexes the original vertex buffer and needs no vertices of its own.
+// Collapses are taken cheapest first until at most targetIndexCount indices are left or the next one
+// would move the surface by more than targetError (mesh space distance). Border vertices only slide
+// along the border, vertices sharing their position with another vertex (attribute seams) and
+// vertices on non-manifold edges stay where they are. Returns the number of indices written to
+// destination, which needs room for indexCount; resultError gets the largest error of any collapse.
+size_t simplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount, size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+// Moves count components of every kept vertex to its remapped position, dropping unreferenced ones
+template<typename T>
+void remapVertexStream(std::vector<T>& stream, uint32_t components, const std::vector<uint32_t>& remap, uint32_t keptVertexCount) {
+	std::vector<T> remapped(static_cast<size_t>(keptVertexCount) * components);
+	for (size_t vertex = 0; vertex < remap.size(); vertex++) {
+		if (remap[vertex] != UINT32_MAX) {
+			for (uint32_t component = 0; component < components; component++) {
+				remapped[static_cast<size_t>(remap[vertex]) * components + component] = stream[vertex * components + component];
+			}
+		}
+	}
+	stream.swap(remapped);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshFile.hpp"
+
+// Splits a triangle list into meshlets of consecutive triangles, so every meshlet is a plain index
+// range the existing vertex pipeline can draw. Run it after optimizeVertexCache/optimizeOverdraw,
+// their order keeps neighbouring triangles together. positions are xyz floats in mesh space,
+// positionError (the vertex encoding's maximum) is added to every bounding sphere.
+std::vector<MeshletRecord> buildMeshlets(const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount, float positionError = 0.0f);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+// vk::PipelineCache persisted to disk between runs.
+// A cache written by a different device or driver is discarded instead of handed to the driver.
+class PipelineCache {
+	public:
+		void init(vk::PhysicalDevice physicalDevice, vk::Device device, const std::string& path);
+		void save();
+		void destroy();
+
+		vk::PipelineCache get() const { return _pipelineCache; }
+		// true when a matching cache was loaded from disk
+		bool isWarm() const { return _warm; }
+
+	private:
+		vk::PhysicalDevice _physicalDevice;
+		vk::Device _device;
+		vk::PipelineCache _pipelineCache;
+		std::string _path;
+		bool _warm = false;
+
+		std::vector<char> load() const;
+		bool isCompatible(const std::vector<char>& data) const;
+};
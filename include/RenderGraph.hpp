@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+#include "MemoryAllocator.hpp"
+
+// How a pass touches a resource, see RenderGraph::usageScope() for the stages, access and layout of each
+enum class ResourceUsage {
+	eIndirectRead,		// parameters and count of indirect draws
+	eVertexRead,		// vertex and index buffers
+	eComputeRead,		// storage buffer or image, or sampled image, in a compute shader
+	eComputeWrite,		// storage buffer or image in a compute shader
+	eGraphicsRead,		// storage buffer or sampled image in the vertex or fragment shader
+	eColorAttachment,
+	eDepthAttachment,	// depth tested and written
+	eDepthRead,			// depth tested, read only
+	eTransferRead,
+	eTransferWrite,
+	ePresent			// only as the final usage of an output
+};
+
+struct UsageScope {
+	vk::PipelineStageFlags2 stages;
+	vk::AccessFlags2 access;
+	vk::ImageLayout layout = vk::ImageLayout::eUndefined;	// images only
+	bool write = false;
+};
+
+// A frame described as passes that declare what they read and write. compile() culls the passes
+// nothing depends on, places barriers between the rest only where a hazard or a layout change needs
+// one, merged into one vkCmdPipelineBarrier2 per pass, and lets transient images whose lifetimes do
+// not overlap share memory. execute() records the live passes with their barriers.
+// Passes run in the order they were added, which has to be a valid order for their reads and writes.
+// Buffers are synchronized with global memory barriers, so the graph only needs to know them by name.
+class RenderGraph {
+	public:
+		using ResourceId = uint32_t;
+		using PassId = uint32_t;
+		using RecordFunction = std::function<void(vk::CommandBuffer commandBuffer)>;
+		// called before (begin true) and after every live pass, its barriers included
+		using PassHook = std::function<void(vk::CommandBuffer commandBuffer, const char* passName, bool begin)>;
+		using MemoryRequirementsFunction = std::function<vk::MemoryRequirements(const vk::ImageCreateInfo& imageCreateInfo)>;
+
+		static UsageScope usageScope(ResourceUsage usage);
+
+		// Image created and owned by the graph. Its contents live from its first to its last use in a
+		// frame, the memory is shared with other transient images outside that range.
+		ResourceId createImage(const std::string& name, const vk::ImageCreateInfo& imageCreateInfo);
+		ResourceId importBuffer(const std::string& name);
+		// image owned elsewhere, in initialLayout at the start of every frame. setImage() before execute().
+		// availableStages are where it becomes usable, the stages of the semaphore wait for an acquired
+		// swapchain image: its first barrier waits on them, so a layout transition can't run before the wait.
+		ResourceId importImage(const std::string& name, vk::ImageLayout initialLayout, vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor,
+			vk::PipelineStageFlags2 availableStages = {});
+		// The resource is used after the frame, its writers are never culled. finalUsage is transitioned
+		// to after the last pass, ePresent for a swapchain image.
+		void markOutput(ResourceId resource, std::optional<ResourceUsage> finalUsage = std::nullopt);
+
+		PassId addPass(const std::string& name, RecordFunction record);
+		void read(PassId pass, ResourceId resource, ResourceUsage usage);
+		void write(PassId pass, ResourceId resource, ResourceUsage usage);
+		// effects outside the graph, a host readback or a render pass writing the swapchain: never culled
+		void setSideEffects(PassId pass);
+
+		// creates the transient images and their shared memory
+		void compile(vk::Device device, MemoryAllocator& allocator);
+		// without a device: plans with memoryRequirements standing in for the images', creates nothing
+		void compile(const MemoryRequirementsFunction& memoryRequirements);
+		void destroy();
+
+		void setImage(ResourceId resource, vk::Image image);
+		vk::Image image(ResourceId resource) const { return _resources[resource].image; }
+		vk::ImageView imageView(ResourceId resource) const { return _resources[resource].imageView; }	// transient images only
+		void execute(vk::CommandBuffer commandBuffer, const PassHook& passHook = {}) const;
+
+		// live and culled passes in order, the barriers before each, how transient memory is shared
+		void printSchedule(std::ostream& out) const;
+
+		uint32_t livePassCount() const;
+		uint32_t barrierBatchCount() const;	// vkCmdPipelineBarrier2 calls per execute()
+		vk::DeviceSize transientBytes() const { return _transientBytes; }	// what the transient images need on their own
+		vk::DeviceSize aliasedBytes() const { return _aliasedBytes; }		// what they share
+		vk::DeviceSize aliasingSavedBytes() const { return _transientBytes - _aliasedBytes; }
+
+	private:
+		struct Resource {
+			std::string name;
+			bool isImage = false;
+			bool transient = false;
+			bool output = false;
+			std::optional<ResourceUsage> finalUsage;
+			vk::ImageCreateInfo imageCreateInfo;
+			vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+			vk::PipelineStageFlags2 availableStages;	// imported images only
+			vk::ImageAspectFlags aspect;
+			vk::Image image;
+			vk::ImageView imageView;
+			vk::MemoryRequirements memoryRequirements;
+			uint32_t firstPass = UINT32_MAX;	// live passes using it, transient images only
+			uint32_t lastPass = 0;
+			uint32_t memorySlot = UINT32_MAX;
+		};
+
+		struct Access {
+			ResourceId resource = 0;
+			ResourceUsage usage = ResourceUsage::eComputeRead;
+		};
+
+		struct Barrier {
+			ResourceId resource = 0;
+			vk::PipelineStageFlags2 srcStages;
+			vk::AccessFlags2 srcAccess;
+			vk::PipelineStageFlags2 dstStages;
+			vk::AccessFlags2 dstAccess;
+			vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+			vk::ImageLayout newLayout = vk::ImageLayout::eUndefined;
+		};
+
+		struct Pass {
+			std::string name;
+			RecordFunction record;
+			std::vector<Access> accesses;
+			bool sideEffects = false;
+			bool live = false;
+			std::vector<Barrier> barriers;	// recorded before the pass
+		};
+
+		// memory shared by transient images, each bound at the start of the allocation
+		struct MemorySlot {
+			vk::MemoryRequirements memoryRequirements;
+			Allocation allocation;
+			std::vector<ResourceId> resources;	// in order of first use
+		};
+
+		void cullPasses();
+		void computeLifetimes();
+		void planMemory();
+		void buildBarriers();
+		void recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<Barrier>& barriers) const;
+		// the pass's accesses merged per resource, a resource read and written becomes one write
+		std::vector<std::pair<ResourceId, UsageScope>> passScopes(const Pass& pass) const;
+
+		std::vector<Resource> _resources;
+		std::vector<Pass> _passes;
+		std::vector<Barrier> _finalBarriers;	// after the last pass
+		std::vector<MemorySlot> _memorySlots;
+		vk::Device _device;
+		MemoryAllocator* _allocator = nullptr;
+		vk::DeviceSize _transientBytes = 0;
+		vk::DeviceSize _aliasedBytes = 0;
+		bool _compiled = false;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 64 bit draw sort key, most significant field first. Sorting keys groups draws by pass, then
+// pipeline, then material (descriptor set), then mesh, and orders every group front to back:
+//   63..60 pass, 59..50 pipeline, 49..38 material, 37..22 mesh, 21..0 depth
+class DrawKey {
+	public:
+		static constexpr uint32_t PASS_BITS = 4;
+		static constexpr uint32_t PIPELINE_BITS = 10;
+		static constexpr uint32_t MATERIAL_BITS = 12;
+		static constexpr uint32_t MESH_BITS = 16;
+		static constexpr uint32_t DEPTH_BITS = 22;
+
+		// depth is the view distance divided by the far plane, clamped to [0, 1]. Fields wider than
+		// their bits are masked, so callers keep ids below 1 << bits.
+		static uint64_t make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+		static uint32_t pass(uint64_t key) { return field(key, PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS, PASS_BITS); }
+		static uint32_t pipeline(uint64_t key) { return field(key, MATERIAL_BITS + MESH_BITS + DEPTH_BITS, PIPELINE_BITS); }
+		static uint32_t material(uint64_t key) { return field(key, MESH_BITS + DEPTH_BITS, MATERIAL_BITS); }
+		static uint32_t mesh(uint64_t key) { return field(key, DEPTH_BITS, MESH_BITS); }
+
+	private:
+		static uint32_t field(uint64_t key, uint32_t shift, uint32_t bits) { return static_cast<uint32_t>((key >> shift) & ((1ull << bits) - 1)); }
+};
+static_assert(DrawKey::PASS_BITS + DrawKey::PIPELINE_BITS + DrawKey::MATERIAL_BITS + DrawKey::MESH_BITS + DrawKey::DEPTH_BITS == 64);
+
+// Draws of one frame, submitted with a sort key and recorded in key order. sort() is a stable LSD
+// radix sort over 8 bit digits that skips every digit all keys share, so a frame whose keys only
+// differ in mesh and depth costs five passes instead of eight.
+class RenderQueue {
+	public:
+		struct Item {
+			uint64_t key;
+			uint32_t draw;	// index into the caller's draw list
+		};
+
+		void clear() { _items.clear(); }
+		void reserve(size_t count) { _items.reserve(count); }
+		void submit(uint64_t key, uint32_t draw) { _items.push_back({ key, draw }); }
+		void sort();
+
+		const std::vector<Item>& items() const { return _items; }
+		uint32_t size() const { return static_cast<uint32_t>(_items.size()); }
+
+	private:
+		std::vector<Item> _items;
+		std::vector<Item> _scratch;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+#include "MemoryAllocator.hpp"
+#include "UploadManager.hpp"
+
+// A deletion that may run once the frame timeline semaphore reaches timelineValue and the upload
+// timeline uploadTicket, 0 = no upload to wait for
+struct DeferredDeletion {
+	uint64_t timelineValue = 0;
+	UploadTicket uploadTicket = 0;
+	vk::DeviceSize bytes = 0;	// memory it gives back, 0 for objects without their own
+	std::function<void()> deletion;
+};
+
+// Deletions waiting on the frame and upload timelines. collect() runs whatever the GPU has passed, so
+// nothing is destroyed under a pending submit or copy and nothing waits for the device either.
+class DeletionQueue {
+	public:
+		void push(uint64_t timelineValue, vk::DeviceSize bytes, std::function<void()>&& deletion, UploadTicket uploadTicket = 0);
+		// runs every deletion both completed values have reached, in the order they were pushed
+		void collect(uint64_t completedValue, UploadTicket completedUploadTicket);
+		// runs everything, only once the device is idle and every upload batch was flushed
+		void flush() { collect(UINT64_MAX, UINT64_MAX); }
+
+		size_t pendingCount() const { return _pending.size(); }
+		vk::DeviceSize pendingBytes() const { return _pendingBytes; }
+		vk::DeviceSize peakPendingBytes() const { return _peakPendingBytes; }
+		uint64_t retiredCount() const { return _retiredCount; }
+		vk::DeviceSize retiredBytes() const { return _retiredBytes; }
+
+	private:
+		std::vector<DeferredDeletion> _pending;
+		vk::DeviceSize _pendingBytes = 0;
+		vk::DeviceSize _peakPendingBytes = 0;
+		uint64_t _retiredCount = 0;
+		vk::DeviceSize _retiredBytes = 0;
+};
+
+// Refers to a resource in a ResourceRegistry. A slot's generation changes when it is released, so a
+// handle kept past release() is caught instead of reaching a destroyed or reused resource.
+struct ResourceHandle {
+	uint32_t index = 0;
+	uint32_t generation = 0;	// 0 = null handle
+
+	explicit operator bool() const { return generation != 0; }
+	bool operator==(const ResourceHandle& other) const = default;
+};
+
+// Owns buffers and images behind generational handles and remembers the last frame timeline value
+// each was used at and the last upload ticket that wrote it. release() invalidates the handle at once
+// and queues the destruction against both, so assets can be streamed out mid-run without a waitIdle,
+// even ones released before any frame drew them or while their copy is still recorded or in flight.
+class ResourceRegistry {
+	public:
+		void init(vk::Device device, MemoryAllocator& allocator, DeletionQueue& deletionQueue);
+		// releases what is still alive and flushes the deletion queue, the device must be idle
+		void destroy();
+
+		ResourceHandle createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryPropertyFlags, AllocationStrategy allocationStrategy = AllocationStrategy::eBuddy, const std::vector<uint32_t>& queueFamilyIndices = {});
+		ResourceHandle createImage(const vk::ImageCreateInfo& imageCreateInfo, vk::MemoryPropertyFlags memoryPropertyFlags);
+
+		// the submit signaling timelineValue reads or writes the resource
+		void markUsed(ResourceHandle handle, uint64_t timelineValue);
+		// a copy into the resource is part of the upload batch completing ticket
+		void markUploaded(ResourceHandle handle, UploadTicket ticket);
+		// uploadManager.upload() into a buffer, marked with the ticket it returns
+		UploadTicket upload(UploadManager& uploadManager, ResourceHandle handle, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+		// the handle is stale from here on, the resource is destroyed once the GPU passed its last use and upload
+		void release(ResourceHandle handle);
+
+		bool alive(ResourceHandle handle) const;
+		// throw on a null or stale handle
+		vk::Buffer buffer(ResourceHandle handle) const;
+		vk::Image image(ResourceHandle handle) const;
+		const Allocation& allocation(ResourceHandle handle) const;
+
+		uint32_t liveCount() const { return _liveCount; }
+		vk::DeviceSize liveBytes() const { return _liveBytes; }
+
+	private:
+		struct Resource {
+			vk::Buffer buffer;
+			vk::Image image;
+			Allocation allocation;
+			uint64_t lastUse = 0;
+			UploadTicket lastUpload = 0;
+			uint32_t generation = 1;
+			bool alive = false;
+		};
+
+		ResourceHandle insert(vk::Buffer buffer, vk::Image image, const Allocation& allocation);
+		// index of a live handle's slot, throws otherwise
+		uint32_t resolve(ResourceHandle handle) const;
+
+		vk::Device _device;
+		MemoryAllocator* _allocator = nullptr;
+		DeletionQueue* _deletionQueue = nullptr;
+		std::vector<Resource> _resources;
+		std::vector<uint32_t> _freeIndices;
+		uint32_t _liveCount = 0;
+		vk::DeviceSize _liveBytes = 0;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+// How the present mode is picked from the modes the surface offers
+enum class PresentPolicy {
+	eLowLatency,	// Mailbox, then Immediate, then FIFO: the newest frame reaches the screen soonest
+	eLowPower		// FIFO relaxed, then FIFO: at most one frame per vblank, the CPU and GPU idle in between
+};
+
+// "latency", "power" or one mode ("mailbox", "immediate", "fifo", "fifo-relaxed"), false for anything else
+bool parsePresentOption(const std::string& name, PresentPolicy& policy, std::optional<vk::PresentModeKHR>& presentMode);
+
+// A swapchain and its image views that were replaced by recreate(). Frames submitted before the
+// swapchain was recreated may still render into it, destroyRetired() once they have finished.
+struct RetiredSwapchain {
+	vk::SwapchainKHR swapchain;
+	std::vector<vk::ImageView> imageViews;
+};
+
+// Window swapchain configured from what the surface reports instead of fixed values. Format and
+// present mode are picked once in init(), image count and extent every time recreate() builds a
+// swapchain, which hands the previous one over as oldSwapchain so presentation continues without
+// a device wide wait.
+class Swapchain {
+	public:
+		static vk::SurfaceFormatKHR chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& available, vk::Format preferred);
+		// requested wins when the surface supports it, FIFO is always there to fall back on
+		static vk::PresentModeKHR choosePresentMode(const std::vector<vk::PresentModeKHR>& available, PresentPolicy policy, std::optional<vk::PresentModeKHR> requested);
+		// one image to render into besides the ones queued or on screen, Mailbox needs at least three
+		static uint32_t chooseImageCount(const vk::SurfaceCapabilitiesKHR& capabilities, vk::PresentModeKHR presentMode);
+		// the surface's extent when it has one, otherwise the window's clamped to what the surface allows
+		static vk::Extent2D chooseExtent(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Extent2D windowExtent);
+
+		// VK_KHR_present_id and VK_KHR_present_wait, both with their features, for waitForPresent()
+		static bool presentWaitSupported(vk::PhysicalDevice physicalDevice);
+
+		// presentWait: the device was created with the present id and present wait extensions and features
+		void init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, vk::Format preferredFormat, PresentPolicy policy, std::optional<vk::PresentModeKHR> requestedPresentMode, bool presentWait);
+		// Builds a swapchain for the window's current size. Returns false, changing nothing, while the
+		// window has no area (minimized). retired gets the previous swapchain, empty the first time.
+		bool recreate(vk::Extent2D windowExtent, RetiredSwapchain& retired);
+		void destroyRetired(RetiredSwapchain& retired);
+		void destroy();
+
+		// eSuccess once the present tagged with presentId (vk::PresentIdKHR) has reached the screen,
+		// eTimeout before that. Without present wait support nothing is ever reported.
+		vk::Result waitForPresent(uint64_t presentId, uint64_t timeout) const;
+
+		bool presentWait() const { return _waitForPresent != nullptr; }
+		vk::SwapchainKHR handle() const { return _swapchain; }
+		const std::vector<vk::Image>& images() const { return _images; }
+		const std::vector<vk::ImageView>& imageViews() const { return _imageViews; }
+		uint32_t imageCount() const { return static_cast<uint32_t>(_images.size()); }
+		vk::Format format() const { return _surfaceFormat.format; }
+		vk::Extent2D extent() const { return _extent; }
+		vk::PresentModeKHR presentMode() const { return _presentMode; }
+		uint32_t recreateCount() const { return _recreateCount; }
+
+	private:
+		vk::PhysicalDevice _physicalDevice;
+		vk::Device _device;
+		vk::SurfaceKHR _surface;
+		vk::SurfaceFormatKHR _surfaceFormat;
+		vk::PresentModeKHR _presentMode = vk::PresentModeKHR::eFifo;
+		vk::SwapchainKHR _swapchain;
+		std::vector<vk::Image> _images;
+		std::vector<vk::ImageView> _imageViews;
+		vk::Extent2D _extent;
+		uint32_t _recreateCount = 0;	// not counting the first swapchain
+		PFN_vkWaitForPresentKHR _waitForPresent = nullptr;	// not exported by the loader
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// CPU zones are appended to a buffer owned by the recording thread, so TRACE_SCOPE takes no lock and
+// costs two clock reads while tracing and one relaxed load otherwise. Zone names are not copied, they
+// have to outlive the trace: string literals, __func__ or names owned by a long lived object.
+// Configure with -DENABLE_TRACING=OFF to compile the macros out entirely.
+
+struct TraceEvent {
+	const char* name = nullptr;
+	uint64_t beginNs = 0;	// traceNow() clock
+	uint64_t endNs = 0;
+};
+
+inline std::atomic<bool> g_tracingEnabled{ false };
+
+inline bool tracingEnabled() {
+	return g_tracingEnabled.load(std::memory_order_relaxed);
+}
+
+// nanoseconds on the clock every zone is measured on
+inline uint64_t traceNow() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void startTracing();
+void stopTracing();
+// names the calling thread's track in the trace, before its first zone
+void setTraceThreadName(const std::string& name);
+// a zone on the calling thread's track
+void addTraceEvent(const char* name, uint64_t beginNs, uint64_t endNs);
+// a zone on the GPU track, already converted to the traceNow() clock. Called from one thread at a time.
+void addGpuTraceEvent(const char* name, uint64_t beginNs, uint64_t endNs);
+// events recorded so far and events dropped because a thread's buffer was full
+uint64_t traceEventCount();
+uint64_t droppedTraceEventCount();
+
+// Chrome trace event JSON, opens in chrome://tracing and ui.perfetto.dev. One track per thread that
+// recorded a zone and one for the GPU. Threads may still be recording, what they add meanwhile may be left out.
+void writeTrace(std::ostream& out);
+// throws if the file cannot be written
+void writeTrace(const std::string& path);
+// text for inside a JSON string: quotes and backslashes escaped, control characters replaced by spaces
+std::string escapeJson(const std::string& text);
+
+class TraceZone {
+	public:
+		explicit TraceZone(const char* name) : _name(name), _beginNs(tracingEnabled() ? traceNow() : 0) {}
+		~TraceZone() {
+			if (_beginNs != 0) {
+				addTraceEvent(_name, _beginNs, traceNow());
+			}
+		}
+		TraceZone(const TraceZone&) = delete;
+		TraceZone& operator=(const TraceZone&) = delete;
+
+	private:
+		const char* _name;
+		uint64_t _beginNs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_TRACING
+#define TRACE_SCOPE(name) ((void)0)
+#else
+// CPU zone from here to the end of the enclosing scope
+#define TRACE_SCOPE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#endif
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
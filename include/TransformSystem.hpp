@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// Transform hierarchy stored as structure-of-arrays.
+// Local-to-world matrices are rebuilt in SIMD batches (8 lanes with AVX, 4 with SSE), only for
+// nodes that changed and their descendants. Parents must be added before their children, so a
+// single pass in index order always sees a parent's world matrix before the child needs it.
+class TransformSystem {
+	public:
+		static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+		void reserve(uint32_t count);
+		uint32_t add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, uint32_t parent = NO_PARENT);
+
+		void setPosition(uint32_t node, const glm::vec3& position);
+		void setRotation(uint32_t node, const glm::quat& rotation);
+		void setScale(uint32_t node, const glm::vec3& scale);
+
+		// Recomputes the world matrices of dirty subtrees, returns how many nodes were recomputed
+		uint32_t update();
+		// Writes the world matrix of every node in [first, last) that changed after update number
+		// sinceUpdate as a column-major mat4 to output + node * stride. Pass 0 to write all of them.
+		// Lets each region of a per-frame ring catch up on what changed since it was last written.
+		void write(void* output, size_t stride, uint64_t sinceUpdate, uint32_t first, uint32_t last) const;
+
+		glm::mat4 worldMatrix(uint32_t node) const;
+		uint32_t size() const { return static_cast<uint32_t>(_parents.size()); }
+		// number of update() calls so far
+		uint64_t updateCount() const { return _updateCount; }
+
+	private:
+		//local transform, padded to a whole batch so kernels never read past the end
+		std::vector<float> _positionX, _positionY, _positionZ;
+		std::vector<float> _rotationX, _rotationY, _rotationZ, _rotationW;
+		std::vector<float> _scaleX, _scaleY, _scaleZ;
+		std::vector<uint32_t> _parents;
+		std::vector<uint8_t> _dirty;
+
+		//world 3x4 affine, _world[row * 4 + column][node]
+		std::vector<float> _world[12];
+		std::vector<uint64_t> _changedUpdate;
+		uint64_t _updateCount = 0;
+
+		void resizeArrays(size_t count);
+		void updateBatch(uint32_t first);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+
+#include "vulkan/vulkan.hpp"
+#include "MemoryAllocator.hpp"
+
+struct UniformAllocation {
+	uint32_t offset = 0;	// dynamic offset into UniformAllocator::buffer()
+	void* data = nullptr;	// mapped, host coherent
+};
+
+// Linear allocator for uniform data that changes every frame, in one persistently mapped buffer
+// with a region per frame in flight. Allocations are bound as eUniformBufferDynamic descriptors at
+// their offset, so a frame's uniforms need no buffer creation and no descriptor writes; the
+// descriptor is written once at init. allocate() may be called from the recorder threads,
+// beginFrame() only once the frame's fence has signaled.
+class UniformAllocator {
+	public:
+		// queueFamilyIndices: every family reading the uniforms, shared concurrently when more than one
+		void init(vk::PhysicalDevice physicalDevice, vk::Device device, MemoryAllocator& allocator, vk::DeviceSize regionSize, uint32_t frameCount, const std::vector<uint32_t>& queueFamilyIndices = {});
+		void destroy();
+
+		// rewinds the frame's region, whatever was allocated from it frameCount frames ago is gone
+		void beginFrame(uint32_t frame);
+		// size bytes in the current frame's region, aligned for a dynamic offset. Throws when the region is full.
+		UniformAllocation allocate(vk::DeviceSize size);
+		template<typename T>
+		UniformAllocation push(const T& value) {
+			UniformAllocation allocation = allocate(sizeof(T));
+			memcpy(allocation.data, &value, sizeof(T));
+			return allocation;
+		}
+
+		vk::Buffer buffer() const { return _buffer; }
+		vk::DeviceSize regionSize() const { return _regionSize; }
+		// bytes handed out from the current frame's region so far
+		vk::DeviceSize usedBytes() const { return _cursor; }
+
+	private:
+		vk::Device _device;
+		MemoryAllocator* _allocator = nullptr;
+		vk::Buffer _buffer;
+		Allocation _allocation;
+		vk::DeviceSize _alignment = 1;
+		vk::DeviceSize _regionSize = 0;
+		vk::DeviceSize _regionOffset = 0;	// start of the current frame's region
+		std::atomic<vk::DeviceSize> _cursor = 0;	// relative to _regionOffset
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+#include "MemoryAllocator.hpp"
+
+// Timeline value the upload's batch signals once its copies have executed
+using UploadTicket = uint64_t;
+
+// Batches buffer uploads through a persistently mapped staging ring.
+// Copies are recorded into one command buffer until flush() submits them together;
+// completion is tracked with a timeline semaphore so callers can poll or wait on a ticket
+// instead of stalling the whole queue.
+class UploadManager {
+	public:
+		static constexpr vk::DeviceSize DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+
+		void init(vk::Device device, MemoryAllocator& allocator, uint32_t queueFamilyIndex, vk::Queue queue, vk::DeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+		void destroy();
+
+		// Copies data into the staging ring and records a copy into dstBuffer.
+		// The returned ticket completes once the batch containing it has been flushed and executed.
+		UploadTicket upload(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+		// Submits all recorded copies in one batch, returns the ticket of that batch
+		UploadTicket flush();
+
+		bool isComplete(UploadTicket ticket);
+		// newest ticket whose batch has executed
+		UploadTicket completedTicket();
+		void wait(UploadTicket ticket);
+
+		vk::Semaphore timelineSemaphore() const { return _timelineSemaphore; }
+		uint32_t queueFamilyIndex() const { return _queueFamilyIndex; }
+		uint32_t submitCount() const { return _submitCount; }
+		uint32_t copyCount() const { return _copyCount; }
+
+	private:
+		struct Batch {
+			vk::CommandBuffer commandBuffer;
+			UploadTicket ticket = 0;
+			vk::DeviceSize ringBytes = 0;
+		};
+
+		vk::Device _device;
+		MemoryAllocator* _allocator = nullptr;
+		vk::Queue _queue;
+		uint32_t _queueFamilyIndex = 0;
+		vk::CommandPool _commandPool;
+		vk::Semaphore _timelineSemaphore;
+
+		vk::Buffer _stagingBuffer;
+		Allocation _stagingAllocation;
+		vk::DeviceSize _stagingSize = 0;
+		vk::DeviceSize _ringHead = 0;
+		vk::DeviceSize _ringUsed = 0;
+
+		Batch _recording;
+		std::deque<Batch> _inFlight;
+		std::vector<vk::CommandBuffer> _freeCommandBuffers;
+		UploadTicket _nextTicket = 1;
+		UploadTicket _completedTicket = 0;
+		uint32_t _submitCount = 0;
+		uint32_t _copyCount = 0;
+
+		vk::DeviceSize reserve(vk::DeviceSize size, vk::DeviceSize alignment);
+		void beginRecording();
+		void retireCompleted();
+		void retireOldest();
+};
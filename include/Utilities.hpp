@@ -1,13 +1,21 @@
 #pragma once
 #include <iostream>
 #include "vulkan/vulkan.hpp"
-
-extern vk::PhysicalDevice selectPhysicalDevice(vk::Instance& instance);
+#include "MemoryAllocator.hpp"
+#include "VertexLayout.hpp"
 
 std::vector<uint32_t> readShader(const std::string& filename);
 
-uint32_t findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+void createBuffer(MemoryAllocator& allocator, vk::Device& device, vk::DeviceSize bufferSize, vk::BufferUsageFlags bufferUsageFlags, vk::MemoryPropertyFlags memoryPropertyFlags, vk::Buffer& buffer, Allocation& allocation, AllocationStrategy allocationStrategy = AllocationStrategy::eBuddy, const std::vector<uint32_t>& queueFamilyIndices = {});
+
+void destroyBuffer(MemoryAllocator& allocator, vk::Device& device, vk::Buffer& buffer, Allocation& allocation);
+
+
+void createImage(MemoryAllocator& allocator, vk::Device& device, const vk::ImageCreateInfo& imageCreateInfo, vk::MemoryPropertyFlags memoryPropertyFlags, vk::Image& image, Allocation& allocation);
+
+void destroyImage(MemoryAllocator& allocator, vk::Device& device, vk::Image& image, Allocation& allocation);
 
-void createBuffer(vk::PhysicalDevice& physicalDevice, vk::Device& device, vk::DeviceSize bufferSize, vk::BufferUsageFlags bufferUsageFlags, vk::MemoryPropertyFlags memoryPropertyFlags, vk::Buffer& buffer, vk::DeviceMemory& deviceMemory);
+// Binding 0 and locations 0 position, 1 color, 2 normal (only when the layout has normals)
+vk::VertexInputBindingDescription vertexBindingDescription(const VertexLayout& layout);
 
-void copyBuffer(vk::Device device, vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize deviceSize, vk::CommandPool commandPool, vk::Queue queue);
+std::vector<vk::VertexInputAttributeDescription> vertexAttributeDescriptions(const VertexLayout& layout);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Per-mesh vertex attribute encodings. Attributes are interleaved as position (location 0),
+// color (location 1), normal (location 2), the stride is padded to 4 bytes.
+enum class PositionEncoding : uint8_t {
+	eFloat32,	// R32G32B32Sfloat, 12 bytes
+	eHalf,	// R16G16B16A16Sfloat, 8 bytes, through the position decode
+	eSnorm16,	// R16G16B16A16Snorm, 8 bytes, through the position decode
+};
+
+enum class ColorEncoding : uint8_t {
+	eFloat32,	// R32G32B32Sfloat, 12 bytes
+	eUnorm8,	// R8G8B8A8Unorm, 4 bytes
+	eUnorm10,	// A2B10G10R10UnormPack32, 4 bytes
+};
+
+enum class NormalEncoding : uint8_t {
+	eNone,
+	eOctahedral16,	// R16G16Snorm, 4 bytes
+	eOctahedral8,	// R8G8Snorm, 2 bytes
+};
+
+struct VertexLayout {
+	PositionEncoding position = PositionEncoding::eFloat32;
+	ColorEncoding color = ColorEncoding::eFloat32;
+	NormalEncoding normal = NormalEncoding::eNone;
+
+	uint32_t colorOffset() const;
+	uint32_t normalOffset() const;
+	uint32_t stride() const;
+
+	// Stored in MeshRecord::vertexLayout, 0 is the all-float layout of the built-in quad
+	uint32_t key() const { return static_cast<uint32_t>(position) | static_cast<uint32_t>(color) << 8 | static_cast<uint32_t>(normal) << 16; }
+	// throws for keys written by a newer converter
+	static VertexLayout fromKey(uint32_t key);
+	// e.g. "snorm16/unorm8/oct16"
+	std::string name() const;
+
+	bool operator==(const VertexLayout&) const = default;
+};
+
+// Source attributes as xyz / rgb floats per vertex. normals may be null when the layout has none.
+struct VertexStreams {
+	const float* positions = nullptr;
+	const float* colors = nullptr;
+	const float* normals = nullptr;
+	uint32_t count = 0;
+};
+
+// Mesh space position = offset + stored position * scale. The 16-bit encodings store positions
+// relative to the bounding box center, divided by its largest half extent, so they use the full range.
+struct PositionDecode {
+	float offset[3] = { 0.0f, 0.0f, 0.0f };
+	float scale = 1.0f;
+};
+PositionDecode computePositionDecode(const VertexLayout& layout, const VertexStreams& streams);
+
+// Encodes and interleaves streams into output, count * stride bytes. Works on four vertices at
+// a time with SSE2 (F16C for half positions), scalar otherwise.
+void encodeVertices(const VertexLayout& layout, const VertexStreams& streams, const PositionDecode& decode, void* output);
+// Reads one encoded vertex back into mesh space floats, normal is left alone without normals
+void decodeVertex(const VertexLayout& layout, const void* vertex, const PositionDecode& decode, float position[3], float color[3], float normal[3]);
+
+struct VertexEncodingError {
+	float maxPosition = 0.0f;	// mesh space distance
+	float rmsPosition = 0.0f;
+	float maxColor = 0.0f;	// per channel
+	float maxNormalDegrees = 0.0f;
+};
+// Decodes every vertex of encoded and compares it with the source streams
+VertexEncodingError measureEncodingError(const VertexLayout& layout, const VertexStreams& streams, const PositionDecode& decode, const void* encoded);
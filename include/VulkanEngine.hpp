@@ -1,6 +1,10 @@
 // VulkanFromScratch.cpp : Defines the entry point for the application.
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <vector>
 
@@ -8,63 +12,284 @@
 #include "vulkan/vulkan.hpp"
 
 #include "Utilities.hpp"
+#include "MemoryAllocator.hpp"
+#include "UploadManager.hpp"
+#include "PipelineCache.hpp"
+#include "FrameStats.hpp"
+#include "JobSystem.hpp"
+#include "CommandRecorder.hpp"
+#include "CullingPass.hpp"
+#include "TransformSystem.hpp"
+#include "MeshFile.hpp"
+#include "LodSelection.hpp"
+#include "RenderQueue.hpp"
+#include "BindlessDescriptors.hpp"
+#include "UniformAllocator.hpp"
+#include "Swapchain.hpp"
+#include "ResourceRegistry.hpp"
+#include "RenderGraph.hpp"
+#include "DeviceQueues.hpp"
+#include "DeviceSelection.hpp"
+#include "Tracing.hpp"
+#include "GpuTrace.hpp"
+
+struct SDL_Window;
+
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+struct EngineConfig {
+	// render into offscreen images without a window or swapchain (CI / software Vulkan)
+	bool headless = false;
+	// frames to render before run() returns, 0 = until the window is closed (headless picks a default)
+	uint32_t frameCount = 0;
+	// leading frames excluded from frameStats()
+	uint32_t warmupFrameCount = 0;
+	// frames the CPU may record ahead of the GPU, 1 to MAX_FRAMES_IN_FLIGHT
+	uint32_t framesInFlight = 2;
+	// job system worker threads, 0 = one per hardware thread besides the main thread
+	uint32_t workerThreadCount = 0;
+	// instanced quads laid out on a grid around the origin
+	uint32_t objectCount = 1;
+	// frustum cull on the GPU and draw with drawIndexedIndirectCount, otherwise one instanced drawIndexed
+	bool gpuCulling = true;
+	// read back every frame's cull result and compare it with the CPU reference, throws on mismatch
+	bool validateCulling = false;
+	// with gpuCulling and a mesh file that has meshlets: cull every meshlet (frustum and backface cone)
+	// and draw the survivors one by one. Turns on backface culling in the graphics pipeline.
+	bool clusterCulling = true;
+	// largest projected simplification error in pixels of the LOD picked per object every frame,
+	// 0 = always LOD 0
+	float lodErrorPixels = 1.0f;
+	// one update-after-bind descriptor set for every buffer and image, indexed by slots in push constants,
+	// otherwise one descriptor set per frame. Needs Vulkan 1.2 descriptor indexing, falls back without it.
+	bool bindless = true;
+	// with gpuCulling: cull on a compute-only queue when the device has one, overlapping the previous
+	// frame's rendering. Uploads always use a transfer-only queue when there is one.
+	bool asyncCompute = true;
+	// windowed: picks the present mode among the ones the surface supports, see PresentPolicy
+	PresentPolicy presentPolicy = PresentPolicy::eLowPower;
+	// windowed: use this present mode instead of the policy's when the surface supports it
+	std::optional<vk::PresentModeKHR> presentMode;
+	// pins the physical device by index, type or part of its name, see selectPhysicalDevice().
+	// Empty = $VFS_DEVICE, or the highest scoring device without it
+	std::string device;
+	// .mesh file written by MeshConverter, objects are spread evenly over its meshes. Empty = the built-in quad
+	std::string meshPath;
+	// Chrome trace JSON of CPU and GPU zones from construction to destroy(), see Tracing.hpp. Empty = no tracing
+	std::string tracePath;
+};
+
+// Mirrors DrawConstants in shaders/shader.hlsl, bindless slots pushed once per command buffer
+struct DrawConstants {
+	uint32_t instanceSlot = 0;	// this frame's region of the instance ring
+};
+
+struct DrawCommand {
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+};
+
+// What one frame in flight owns, reused once the frame timeline semaphore reaches timelineValue.
+// Its uniforms and instances live in region currentFrame of the UniformAllocator and the instance ring.
+struct FrameContext {
+	vk::CommandPool commandPool;	// reset as a whole when the frame is reused
+	vk::CommandBuffer commandBuffer;
+	vk::CommandPool computeCommandPool;	// async compute only, reset together with commandPool
+	vk::CommandBuffer computeCommandBuffer;
+	vk::Semaphore imageAvailableSemaphore;	// windowed only
+	uint64_t timelineValue = 0;	// signaled by the frame's submit, 0 = never submitted
+};
+
+// A present tagged with a VK_KHR_present_id, waiting for VK_KHR_present_wait to report it on screen
+struct PendingPresent {
+	uint64_t presentId = 0;
+	std::chrono::high_resolution_clock::time_point inputTime;	// when the frame sampled input and scene state
+};
+
+// A mesh inside the shared vertex and index buffers
+struct Mesh {
+	glm::vec4 boundingSphere;	// xyz center in mesh space, w radius
+	glm::vec4 positionDecode = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);	// PositionDecode of the stored positions
+	int32_t vertexOffset = 0;
+	uint32_t firstIndex = 0;
+	std::vector<MeshLod> lods;	// firstIndex relative to the mesh's firstIndex
+	uint32_t firstLod = 0;	// range in VulkanEngine::_lods, one entry per lod
+	uint32_t firstMeshlet = 0;	// range in VulkanEngine::_meshlets
+	uint32_t meshletCount = 0;
+};
 
 class VulkanEngine {
 	public: 
-		VulkanEngine();
+		VulkanEngine(const EngineConfig& config = EngineConfig());
 		void run();
 		void destroy();
 
+		const FrameStats& frameStats() const { return _frameStats; }
+		std::string deviceName() const;
+
 	private:
+		EngineConfig _config;
+		SDL_Window* _window = nullptr;
 		vk::PhysicalDevice _physicalDevice;
+		DeviceCapabilities _capabilities;	// of _physicalDevice, every optional path checks these
 		vk::Device _device;
-		vk::Queue _graphicsQueue;
+		DeviceQueues _queues;
+		std::vector<uint32_t> _sceneQueueFamilyIndices;	// share the scene buffers: uploads, culling and rendering
+		std::vector<uint32_t> _frameQueueFamilyIndices;	// share the host written per-frame buffers: culling and rendering
+		bool _asyncCompute = false;	// culling submitted to a compute queue of its own
 		vk::Instance _instance;
 		vk::SurfaceKHR _surface;
-		vk::SwapchainKHR _swapchain;
+		Swapchain _swapchain;	// windowed only
+		bool _presentWait = false;	// VK_KHR_present_wait, measures input latency
+		bool _swapchainDirty = false;	// resized, or reported out of date or suboptimal, rebuilt before the next acquire
+		uint64_t _presentId = 0;
+		std::deque<PendingPresent> _pendingPresents;	// oldest first
+		//headless render targets
+		std::vector<vk::Image> _swapchainImages;
+		std::vector<Allocation> _offscreenImageAllocations;
 		std::vector<vk::ImageView> _imageViews;
-		std::vector<vk::Framebuffer> _frameBuffers;
+		std::vector<vk::Framebuffer> _frameBuffers;	// one per swapchain or offscreen image
+		std::vector<vk::Semaphore> _presentSemaphores;	// windowed only, one per swapchain image as a present may outlive its frame
 		vk::ShaderModule _fragmentShaderModule;
 		vk::ShaderModule _vertexShaderModule;
 		vk::DescriptorPool _descriptorPool;
-		std::vector<vk::DescriptorSet> _descriptorSets;
+		vk::DescriptorSet _descriptorSet;	// frame uniforms and, without bindless, the instance ring, both at dynamic offsets
 		vk::DescriptorSetLayout _descriptorSetLayout;		
+		bool _bindless = false;
+		BindlessDescriptors _bindlessDescriptors;
+		std::vector<DrawConstants> _drawConstants;	// per frame in flight
 		vk::PipelineLayout _pipelineLayout;
 		vk::RenderPass _renderPass;
 		vk::Pipeline _graphicsPipeline;
-		vk::CommandPool _commandPool;
+		PipelineCache _pipelineCache;
+		JobSystem _jobSystem;
+		CommandRecorder _commandRecorder;
+		std::vector<DrawCommand> _drawCommands;
+		RenderQueue _renderQueue;	// _drawCommands in record order
+		std::atomic<uint32_t> _bindCount = 0;	// binds recorded and dropped as redundant this frame, over all recorder threads
+		std::atomic<uint32_t> _skippedBindCount = 0;
+		std::vector<Mesh> _meshes;
+		std::vector<ObjectData> _objects;
+		std::vector<uint32_t> _objectMeshes;
+		std::vector<LodData> _lods;
+		//LOD state, _objectLodChanges holds the frame number + 1 each object last changed its LOD at
+		std::vector<uint8_t> _objectLods;
+		std::vector<uint64_t> _objectLodChanges;
+		std::vector<uint64_t> _instanceRegionLodFrames;	// frame number + 1 each region's LODs were last written at
+		uint64_t _lodTriangles = 0;	// triangles of every object's current LOD
+		float _projectionScale = 1.0f;	// pixels per scene unit at distance 1
+		TransformSystem _transformSystem;
+		std::vector<glm::vec4> _instanceColors;
+		std::vector<glm::vec4> _instancePositionDecodes;
+		bool _gpuCulling = false;
+		bool _clusterCulling = false;
+		CullingPass _cullingPass;
+		RenderGraph _renderGraph;	// culling, the main render pass and the culling readback
+		RenderGraph::ResourceId _colorTarget = 0;	// this frame's swapchain or offscreen image
+		glm::mat4 _cullMatrix = glm::mat4(1.0f);	// this frame's, for the culling pass
+		std::vector<MeshletData> _meshlets;
+		std::vector<ClusterData> _clusters;
+		glm::vec3 _cameraPosition = glm::vec3(0.0f);
+		MemoryAllocator _allocator;
+		UploadManager _uploadManager;
+		UploadTicket _uploadTicket = 0;
+		//vertex, index, object, LOD, meshlet and cluster buffers are owned by _resources
+		DeletionQueue _deletionQueue;	// keyed by _frameSemaphore values and upload tickets
+		ResourceRegistry _resources;
+		std::vector<ResourceHandle> _frameResources;	// read by every frame, marked used at each submit
 		vk::Buffer _vertexBuffer;
 		vk::Buffer _indexBuffer;
-		vk::DeviceMemory _deviceMemory;
-		std::vector<vk::Buffer> _uniformBuffers;
-		std::vector<vk::DeviceMemory> _uniformBufferDeviceMemories;
-		std::vector<void*> _uniformBuffersMapped;
-		std::vector<vk::CommandBuffer> _commandBuffers;
-		std::vector<vk::Semaphore> _imageAvailableSemaphores;
-		std::vector<vk::Semaphore> _renderFinishedSemaphores;
-		std::vector<vk::Fence> _inflightFences;
+		ResourceHandle _vertexResource;
+		ResourceHandle _indexResource;
+		VertexLayout _vertexLayout;
+		vk::IndexType _indexType = vk::IndexType::eUint16;
+		vk::Buffer _objectBuffer;
+		vk::Buffer _lodBuffer;
+		vk::Buffer _meshletBuffer;
+		vk::Buffer _clusterBuffer;
+		ResourceHandle _objectResource;
+		ResourceHandle _lodResource;
+		ResourceHandle _meshletResource;
+		ResourceHandle _clusterResource;
+		vk::Buffer _instanceBuffer;
+		Allocation _instanceBufferAllocation;
+		vk::DeviceSize _instanceRegionSize = 0;
+		std::vector<uint64_t> _instanceRegionUpdates;	// transform update each region was last written at
+		UniformAllocator _uniformAllocator;
+		UniformAllocation _frameUniforms;	// this frame's UniformBufferObject
+		std::vector<FrameContext> _frames;
+		vk::Semaphore _frameSemaphore;	// timeline, each submit signals its frame number + 1
+		vk::Semaphore _computeSemaphore;	// timeline, each async culling submit signals its frame number + 1
 		vk::Extent2D _windowExtent;
 		uint32_t currentFrame = 0;
+		uint32_t _imageIndex = 0;	// this frame's swapchain image
+		uint64_t _frameNumber = 0;
+
+		//timing
+		FrameStats _frameStats;
+		bool _timestampsSupported = false;
+		float _timestampPeriod = 1.0f;
+		uint64_t _timestampMask = UINT64_MAX;
+		vk::QueryPool _timestampQueryPool;
+		std::vector<uint64_t> _timestampFrameNumbers;
+		uint64_t _lastTimestampFrameNumber = UINT64_MAX;	// last frame whose timestamps were collected
+		uint64_t _lastGpuEndTimestamp = 0;
+		GpuTrace _gpuTrace;	// zones around the graph's passes, with tracePath only
 
 		//init
+		void initJobSystem();
 		void initDevice();
+		void initAllocator();
+		void initUploadManager();
+		void initPipelineCache();
 		void initSwapchain();
+		void initOffscreenImages();
 		void initImageViews();
 		void initRenderPass();
 		void initFramebuffers();
-		void initCommandPool();
-		void initVertexBuffer();
-		void initIndexBuffer();
+		void initCommandRecorder();
+		void initMeshes();
+		void initGeometryBuffers(vk::DeviceSize vertexBufferSize, vk::DeviceSize indexBufferSize);
+		void initObjectBuffer();
+		void initClusters();
+		void initInstanceBuffer();
 		void initUniformBuffers();
 		void initDescriptorPool();
 		void initDescriptorSets();
-		void initCommandBuffers();
 		void initDescriptorSetLayout();
 		void initGraphicsPipeline();
-		void initSemaphores();
+		void initCullingPass();
+		void initRenderGraph();
+		void initFrames();
+		void initPresentSemaphores();
+		void initTimestampQueries();
 
 		//draw
 		void draw();
-		void updateUniformBuffers();
+		// acquires the next swapchain image, rebuilding the swapchain first if needed. false while minimized.
+		bool acquireImage(FrameContext& frame, uint32_t& imageIndex);
+		bool recreateSwapchain();
+		// records the input latency of every pending present that reached the screen
+		void collectPresentLatencies(uint64_t timeout);
+		glm::mat4 updateUniformBuffers();
+		void updateInstances();
+		void selectLods(InstanceData* instances, uint64_t regionFrame, uint32_t first, uint32_t last, std::atomic<uint32_t>& changeCount, std::atomic<int64_t>& triangleDelta);
+		void buildDrawCommands();
+		void buildRenderQueue();
+		InstanceData* instanceRegion(uint32_t frame);
+		// the render pass with the secondary command buffers of every recorder thread
+		void recordMainPass(vk::CommandBuffer commandBuffer);
+		void recordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t first, uint32_t last);
+		void collectTimestamps(uint32_t frame);
+		// waits for the GPU and collects what every frame in flight left behind
+		void finishFrames();
+		// destroys an object once the frame being recorded, and with it every earlier one, has finished.
+		// Keyed by timeline value, so a frame that is skipped before its submit delays the deletion instead of running it early.
+		void deferDeletion(std::function<void()>&& deletion);
+		// device local buffer filled by uploads through _resources and read by every frame, owned by _resources
+		ResourceHandle createSceneBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::Buffer& buffer);
 
 };
@@ -1,4 +1,13 @@
-C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T vs_6_0 -E VS_main -spirv -Fo v_shader.spv shader.hlsl
-C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T ps_6_0 -E FS_main -spirv -Fo f_shader.spv shader.hlsl
+@echo off
+rem Compiles the shaders into the shaders folder of a build directory, the first argument, where the executables load them from.
+rem CMake does the same on every build, this is for iterating on shaders without it.
+set OUT=%~1
+if "%OUT%"=="" set OUT=..\out\build\x64-debug\shaders
+if not exist "%OUT%" mkdir "%OUT%"
+C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T vs_6_0 -E VS_main -spirv -Fo %OUT%/v_shader.spv shader.hlsl
+C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T vs_6_0 -E VS_main -D BINDLESS -spirv -Fo %OUT%/v_shader_bindless.spv shader.hlsl
+C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T ps_6_0 -E FS_main -spirv -Fo %OUT%/f_shader.spv shader.hlsl
+C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T cs_6_0 -E CS_main -spirv -Fo %OUT%/cull_shader.spv cull.hlsl
+C:/VulkanSDK/1.3.268.0/Bin/dxc.exe -T cs_6_0 -E CS_clusters -spirv -Fo %OUT%/cluster_cull_shader.spv cull.hlsl
 
-pause
\ No newline at end of file
+pause
@@ -0,0 +1,200 @@
+struct UniformBufferControl
+{
+    float4x4 projection;
+    float4x4 view;
+};
+
+[[vk::binding(0, 0)]]
+cbuffer ubo
+{
+    UniformBufferControl ubo;
+}
+
+// Mirrors ObjectData in include/CullingPass.hpp
+struct ObjectData
+{
+    float4 BoundingSphere;
+    uint IndexCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstMeshlet;
+    uint MeshletCount;
+    uint FirstLod;
+    uint LodCount;
+    uint Padding;
+};
+
+// Mirrors LodData in include/CullingPass.hpp
+struct LodData
+{
+    uint FirstIndex;
+    uint IndexCount;
+};
+
+// Mirrors InstanceData in include/CullingPass.hpp
+struct InstanceData
+{
+    float4x4 Model;
+    float4 Color;
+    float4 PositionDecode;
+    uint Lod;
+    uint3 Padding;
+};
+
+// Mirrors MeshletData in include/CullingPass.hpp
+struct MeshletData
+{
+    float4 BoundingSphere;
+    float4 Cone;
+    uint FirstIndex;
+    uint IndexCount;
+    uint2 Padding;
+};
+
+// Mirrors ClusterData in include/CullingPass.hpp
+struct ClusterData
+{
+    uint Object;
+    uint Meshlet;
+};
+
+// Mirrors VkDrawIndexedIndirectCommand
+struct DrawIndexedIndirectCommand
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
+
+// Mirrors CullConstants in src/CullingPass.cpp
+struct CullConstants
+{
+    uint ItemCount;
+    uint DispatchWidth;
+    uint2 Padding;
+    float4 CameraPosition;
+};
+
+[[vk::binding(1, 0)]] StructuredBuffer<ObjectData> objects;
+[[vk::binding(2, 0)]] RWStructuredBuffer<DrawIndexedIndirectCommand> drawCommands;
+[[vk::binding(3, 0)]] RWStructuredBuffer<uint> drawCount;
+[[vk::binding(4, 0)]] StructuredBuffer<InstanceData> instances;
+[[vk::binding(5, 0)]] StructuredBuffer<LodData> lods;
+[[vk::binding(6, 0)]] StructuredBuffer<MeshletData> meshlets;
+[[vk::binding(7, 0)]] StructuredBuffer<ClusterData> clusters;
+[[vk::push_constant]] CullConstants constants;
+
+// Flat item index, dispatches wider than the x limit continue in y
+uint itemIndex(uint3 GroupID, uint GroupIndex)
+{
+    return (GroupID.y * constants.DispatchWidth + GroupID.x) * 64 + GroupIndex;
+}
+
+// Same as worldBoundingSphere
+float4 worldSphere(float4 sphere, float4x4 model)
+{
+    float3 center = mul(model, float4(sphere.xyz, 1.0)).xyz;
+    float scale = max(length(float3(model[0][0], model[1][0], model[2][0])), max(length(float3(model[0][1], model[1][1], model[2][1])), length(float3(model[0][2], model[1][2], model[2][2]))));
+    return float4(center, sphere.w * scale);
+}
+
+// Same as Frustum::sphereMargin >= 0, the planes are the rows of the scene-to-clip matrix like Frustum::fromMatrix
+bool insideFrustum(float4 sphere)
+{
+    float4x4 m = mul(ubo.projection, ubo.view);
+    float4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+    for (uint i = 0; i < 6; i++)
+    {
+        float4 plane = planes[i] / length(planes[i].xyz);
+        if (dot(plane.xyz, sphere.xyz) + plane.w + sphere.w < 0.0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendDraw(uint indexCount, uint firstIndex, int vertexOffset, uint objectIndex)
+{
+    uint slot;
+    InterlockedAdd(drawCount[0], 1, slot);
+
+    DrawIndexedIndirectCommand command;
+    command.IndexCount = indexCount;
+    command.InstanceCount = 1;
+    command.FirstIndex = firstIndex;
+    command.VertexOffset = vertexOffset;
+    command.FirstInstance = objectIndex;
+    drawCommands[slot] = command;
+}
+
+[numthreads(64, 1, 1)]
+void CS_main(uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    uint objectIndex = itemIndex(GroupID, GroupIndex);
+    if (objectIndex >= constants.ItemCount)
+    {
+        return;
+    }
+
+    ObjectData object = objects[objectIndex];
+    InstanceData instance = instances[objectIndex];
+    if (insideFrustum(worldSphere(object.BoundingSphere, instance.Model)))
+    {
+        LodData lod = lods[object.FirstLod + instance.Lod];
+        appendDraw(lod.IndexCount, lod.FirstIndex, object.VertexOffset, objectIndex);
+    }
+}
+
+// One thread per meshlet of every object, same tests as cullClusters
+[numthreads(64, 1, 1)]
+void CS_clusters(uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    uint clusterIndex = itemIndex(GroupID, GroupIndex);
+    if (clusterIndex >= constants.ItemCount)
+    {
+        return;
+    }
+
+    ClusterData cluster = clusters[clusterIndex];
+    ObjectData object = objects[cluster.Object];
+    InstanceData instance = instances[cluster.Object];
+    float4x4 model = instance.Model;
+    if (!insideFrustum(worldSphere(object.BoundingSphere, model)))
+    {
+        return;
+    }
+
+    // Meshlets only cover LOD 0, coarser LODs are drawn whole by the object's first cluster
+    if (instance.Lod > 0)
+    {
+        if (cluster.Meshlet == object.FirstMeshlet)
+        {
+            LodData lod = lods[object.FirstLod + instance.Lod];
+            appendDraw(lod.IndexCount, lod.FirstIndex, object.VertexOffset, cluster.Object);
+        }
+        return;
+    }
+
+    MeshletData meshlet = meshlets[cluster.Meshlet];
+    float4 sphere = worldSphere(meshlet.BoundingSphere, model);
+    if (!insideFrustum(sphere))
+    {
+        return;
+    }
+
+    // Same as meshletConeMargin, every triangle faces away from the camera
+    if (meshlet.Cone.w < 1.0)
+    {
+        float3 axis = normalize(mul(model, float4(meshlet.Cone.xyz, 0.0)).xyz);
+        float3 toCenter = sphere.xyz - constants.CameraPosition.xyz;
+        if (dot(toCenter, axis) - meshlet.Cone.w * length(toCenter) - sphere.w >= 0.0)
+        {
+            return;
+        }
+    }
+
+    appendDraw(meshlet.IndexCount, meshlet.FirstIndex, object.VertexOffset, cluster.Object);
+}
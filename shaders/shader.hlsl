@@ -1,18 +1,51 @@
 struct UniformBufferControl
 {
     float4x4 projection;
-    float4x4 model;
     float4x4 view;
 };
 
+// Mirrors InstanceData in include/CullingPass.hpp
+struct InstanceData
+{
+    float4x4 Model;
+    float4 Color;
+    float4 PositionDecode; // mesh position = xyz + stored position * w
+    uint Lod;
+    uint3 Padding;
+};
+
+#ifdef BINDLESS
+// Mirrors DrawConstants in include/VulkanEngine.hpp, the slot in the bindless buffer array
+struct DrawConstants
+{
+    uint InstanceSlot;
+};
+[[vk::push_constant]] DrawConstants drawConstants;
+
+// Binding 0 of BindlessDescriptors, instanceBuffers[drawConstants.InstanceSlot] is this frame's region
+[[vk::binding(0, 0)]] StructuredBuffer<InstanceData> instanceBuffers[];
+
+// Dynamic descriptors can't live in the update-after-bind set, the frame uniforms get their own
+[[vk::binding(0, 1)]]
+cbuffer ubo 
+{
+    UniformBufferControl ubo;
+}
+#else
+[[vk::binding(0, 0)]]
 cbuffer ubo 
 {
     UniformBufferControl ubo;
 }
 
+// This frame's region of the instance ring
+[[vk::binding(1, 0)]] StructuredBuffer<InstanceData> instances;
+#endif
+
 struct VSInput
 {
-    [[vk::location(0)]] float2 Position : POSTION0;
+    // 16 bit encodings are normalized, PositionDecode maps them back to mesh space
+    [[vk::location(0)]] float3 Position : POSTION0;
     [[vk::location(1)]] float3 Color : COLOR0;
 };
 
@@ -22,11 +55,18 @@ struct VSOutput
     [[vk::location(1)]] float3 Color : COLOR0;
 };
 
-VSOutput VS_main(VSInput input, uint VertexIndex : SV_VertexID)
+// SV_InstanceID maps to InstanceIndex, which includes firstInstance (the object index of culled draws)
+VSOutput VS_main(VSInput input, uint VertexIndex : SV_VertexID, uint InstanceIndex : SV_InstanceID)
 {
     VSOutput output = (VSOutput) 0;
-    output.Position = mul(ubo.projection, mul(ubo.view, mul(ubo.model, float4(input.Position, 0.0, 1.0))));
-    output.Color = input.Color;
+#ifdef BINDLESS
+    InstanceData instance = instanceBuffers[drawConstants.InstanceSlot][InstanceIndex];
+#else
+    InstanceData instance = instances[InstanceIndex];
+#endif
+    float3 position = instance.PositionDecode.xyz + input.Position * instance.PositionDecode.w;
+    output.Position = mul(ubo.projection, mul(ubo.view, mul(instance.Model, float4(position, 1.0))));
+    output.Color = input.Color * instance.Color.rgb;
     return output;
 }
 
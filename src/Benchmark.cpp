@@ -0,0 +1,119 @@
+#include <fstream>
+
+#include "../include/VulkanEngine.hpp"
+
+// Runs a fixed number of warm-up and measured frames and writes frame time and triangle count percentiles as JSON
+int main(int argc, char* argv[]) {
+	uint32_t warmupFrames = 100;
+	uint32_t measuredFrames = 1000;
+	std::string outputPath;
+	bool windowed = false;
+	uint32_t workerThreads = 0;
+	uint32_t objectCount = 100000;
+	bool gpuCulling = true;
+	bool clusterCulling = true;
+	uint32_t framesInFlight = EngineConfig().framesInFlight;
+	bool bindless = true;
+	bool asyncCompute = true;
+	std::string device;
+	float lodErrorPixels = EngineConfig().lodErrorPixels;
+	std::string meshPath;
+	std::string tracePath;
+	PresentPolicy presentPolicy = EngineConfig().presentPolicy;
+	std::optional<vk::PresentModeKHR> presentMode;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--warmup" && i + 1 < argc) {
+			warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--frames" && i + 1 < argc) {
+			measuredFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--output" && i + 1 < argc) {
+			outputPath = argv[++i];
+		} else if (arg == "--threads" && i + 1 < argc) {
+			workerThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--objects" && i + 1 < argc) {
+			objectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--cpu-draws") {
+			gpuCulling = false;
+		} else if (arg == "--no-cluster-culling") {
+			clusterCulling = false;
+		} else if (arg == "--frames-in-flight" && i + 1 < argc) {
+			framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--no-bindless") {
+			bindless = false;
+		} else if (arg == "--no-async-compute") {
+			asyncCompute = false;
+		} else if (arg == "--device" && i + 1 < argc) {
+			device = argv[++i];
+		} else if (arg == "--lod-error" && i + 1 < argc) {
+			lodErrorPixels = std::stof(argv[++i]);
+		} else if (arg == "--mesh" && i + 1 < argc) {
+			meshPath = argv[++i];
+		} else if (arg == "--trace" && i + 1 < argc) {
+			tracePath = argv[++i];
+		} else if (arg == "--windowed") {
+			windowed = true;
+		} else if (arg == "--present" && i + 1 < argc && parsePresentOption(argv[i + 1], presentPolicy, presentMode)) {
+			i++;
+		} else {
+			std::cout << "usage: " << argv[0] << " [--warmup N] [--frames M] [--output results.json] [--threads T] [--objects N] [--cpu-draws] [--no-cluster-culling] [--frames-in-flight 1-4] [--no-bindless] [--no-async-compute] [--device INDEX|TYPE|NAME] [--lod-error PIXELS] [--mesh scene.mesh] [--trace trace.json] [--windowed] [--present latency|power|mailbox|immediate|fifo|fifo-relaxed]" << std::endl;
+			return 1;
+		}
+	}
+
+	EngineConfig config;
+	config.headless = !windowed;
+	config.warmupFrameCount = warmupFrames;
+	config.frameCount = warmupFrames + measuredFrames;
+	config.workerThreadCount = workerThreads;
+	config.objectCount = objectCount;
+	config.gpuCulling = gpuCulling;
+	config.clusterCulling = clusterCulling;
+	config.framesInFlight = framesInFlight;
+	config.bindless = bindless;
+	config.asyncCompute = asyncCompute;
+	config.device = device;
+	config.lodErrorPixels = lodErrorPixels;
+	config.meshPath = meshPath;
+	config.tracePath = tracePath;
+	config.presentPolicy = presentPolicy;
+	config.presentMode = presentMode;
+
+	//without --output stdout carries nothing but the JSON, so CI can pipe it. Everything the engine
+	//prints goes to stderr instead.
+	std::streambuf* stdoutBuffer = std::cout.rdbuf();
+	std::ostream resultOut(stdoutBuffer);
+	if (outputPath.empty()) {
+		std::cout.rdbuf(std::cerr.rdbuf());
+	}
+
+	int result = 0;
+	try {
+		VulkanEngine vulkanEngine(config);
+		vulkanEngine.run();
+
+		if (outputPath.empty()) {
+			vulkanEngine.frameStats().writeJson(resultOut, vulkanEngine.deviceName(), config.headless);
+		} else {
+			std::ofstream file(outputPath, std::ios::trunc);
+			if (!file.is_open()) {
+				throw std::runtime_error("Failed to open benchmark output " + outputPath);
+			}
+			vulkanEngine.frameStats().writeJson(file, vulkanEngine.deviceName(), config.headless);
+			std::cout << "Benchmark results written to " << outputPath << std::endl;
+		}
+
+		vulkanEngine.destroy();
+	} catch (vk::SystemError& err) {
+		std::cerr << "vk::SystemError: " << err.what() << std::endl;
+		result = 1;
+	}
+	catch (std::exception& err) {
+		std::cerr << "std::Exception: " << err.what() << std::endl;
+		result = 1;
+	}
+
+	std::cout.rdbuf(stdoutBuffer);
+	return result;
+}
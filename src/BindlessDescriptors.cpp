@@ -0,0 +1,122 @@
+#include "../include/BindlessDescriptors.hpp"
+#include <algorithm>
+#include <array>
+#include <format>
+
+void DescriptorSlotAllocator::init(uint32_t capacity) {
+	_used.assign(capacity, false);
+	_freeSlots.resize(capacity);
+	for (uint32_t i = 0; i < capacity; i++) {
+		_freeSlots[i] = capacity - 1 - i;
+	}
+}
+
+uint32_t DescriptorSlotAllocator::allocate() {
+	if (_freeSlots.empty()) {
+		throw std::runtime_error(std::format("descriptor array full, all {} slots in use", capacity()));
+	}
+	uint32_t slot = _freeSlots.back();
+	_freeSlots.pop_back();
+	_used[slot] = true;
+	return slot;
+}
+
+void DescriptorSlotAllocator::free(uint32_t slot) {
+	if (slot >= capacity() || !_used[slot]) {
+		throw std::runtime_error(std::format("freeing descriptor slot {} which is not in use", slot));
+	}
+	_used[slot] = false;
+	_freeSlots.push_back(slot);
+}
+
+bool BindlessDescriptors::supported(const vk::PhysicalDeviceVulkan12Features& features) {
+	return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending
+		&& features.descriptorBindingStorageBufferUpdateAfterBind && features.descriptorBindingSampledImageUpdateAfterBind;
+}
+
+void BindlessDescriptors::enableFeatures(vk::PhysicalDeviceVulkan12Features& features) {
+	features.setRuntimeDescriptorArray(VK_TRUE);
+	features.setDescriptorBindingPartiallyBound(VK_TRUE);
+	features.setDescriptorBindingUpdateUnusedWhilePending(VK_TRUE);
+	features.setDescriptorBindingStorageBufferUpdateAfterBind(VK_TRUE);
+	features.setDescriptorBindingSampledImageUpdateAfterBind(VK_TRUE);
+}
+
+void BindlessDescriptors::init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::ShaderStageFlags stageFlags) {
+	_device = device;
+
+	//both arrays count against the per stage limit on update-after-bind resources
+	vk::PhysicalDeviceVulkan12Properties vulkan12Properties({});
+	vk::PhysicalDeviceProperties2 properties2({});
+	properties2.setPNext(&vulkan12Properties);
+	physicalDevice.getProperties2(&properties2);
+	uint32_t bufferCount = std::min({ MAX_BUFFERS, vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+		vulkan12Properties.maxPerStageUpdateAfterBindResources / 2 });
+	uint32_t imageCount = std::min({ MAX_IMAGES, vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		vulkan12Properties.maxPerStageUpdateAfterBindResources - bufferCount });
+	_bufferSlots.init(bufferCount);
+	_imageSlots.init(imageCount);
+
+	std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+		vk::DescriptorSetLayoutBinding(BUFFER_BINDING, vk::DescriptorType::eStorageBuffer, bufferCount, stageFlags),
+		vk::DescriptorSetLayoutBinding(IMAGE_BINDING, vk::DescriptorType::eSampledImage, imageCount, stageFlags)
+	};
+	//unwritten slots are never read, written ones may change while the set is bound as long as no pending draw reads them
+	vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+	std::array<vk::DescriptorBindingFlags, 2> bindingFlagsArray = { bindingFlags, bindingFlags };
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo({});
+	bindingFlagsCreateInfo.setBindingFlags(bindingFlagsArray);
+
+	vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo({});
+	descriptorSetLayoutCreateInfo.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool);
+	descriptorSetLayoutCreateInfo.setBindings(bindings);
+	descriptorSetLayoutCreateInfo.setPNext(&bindingFlagsCreateInfo);
+	_descriptorSetLayout = _device.createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
+
+	std::array<vk::DescriptorPoolSize, 2> descriptorPoolSizes = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, bufferCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, imageCount)
+	};
+	vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo({});
+	descriptorPoolCreateInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind);
+	descriptorPoolCreateInfo.setPoolSizes(descriptorPoolSizes);
+	descriptorPoolCreateInfo.setMaxSets(1);
+	_descriptorPool = _device.createDescriptorPool(descriptorPoolCreateInfo);
+
+	vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo({});
+	descriptorSetAllocateInfo.setDescriptorPool(_descriptorPool);
+	descriptorSetAllocateInfo.setSetLayouts(_descriptorSetLayout);
+	vk::resultCheck(_device.allocateDescriptorSets(&descriptorSetAllocateInfo, &_descriptorSet), "failed to allocate bindless descriptor set");
+}
+
+void BindlessDescriptors::destroy() {
+	//freeing the pool frees the set
+	_device.destroyDescriptorPool(_descriptorPool);
+	_device.destroyDescriptorSetLayout(_descriptorSetLayout);
+}
+
+uint32_t BindlessDescriptors::addBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+	uint32_t slot = _bufferSlots.allocate();
+	vk::DescriptorBufferInfo bufferInfo(buffer, offset, range);
+	vk::WriteDescriptorSet writeDescriptorSet({});
+	writeDescriptorSet.setDstSet(_descriptorSet);
+	writeDescriptorSet.setDstBinding(BUFFER_BINDING);
+	writeDescriptorSet.setDstArrayElement(slot);
+	writeDescriptorSet.setDescriptorType(vk::DescriptorType::eStorageBuffer);
+	writeDescriptorSet.setBufferInfo(bufferInfo);
+	_device.updateDescriptorSets(writeDescriptorSet, nullptr);
+	return slot;
+}
+
+uint32_t BindlessDescriptors::addImage(vk::ImageView imageView, vk::ImageLayout imageLayout) {
+	uint32_t slot = _imageSlots.allocate();
+	vk::DescriptorImageInfo imageInfo({}, imageView, imageLayout);
+	vk::WriteDescriptorSet writeDescriptorSet({});
+	writeDescriptorSet.setDstSet(_descriptorSet);
+	writeDescriptorSet.setDstBinding(IMAGE_BINDING);
+	writeDescriptorSet.setDstArrayElement(slot);
+	writeDescriptorSet.setDescriptorType(vk::DescriptorType::eSampledImage);
+	writeDescriptorSet.setImageInfo(imageInfo);
+	_device.updateDescriptorSets(writeDescriptorSet, nullptr);
+	return slot;
+}
@@ -0,0 +1,121 @@
+#include "../include/CommandRecorder.hpp"
+#include "../include/Tracing.hpp"
+#include <algorithm>
+#include <cassert>
+
+void CommandRecorder::init(vk::Device device, JobSystem& jobSystem, uint32_t queueFamilyIndex, uint32_t frameCount) {
+	_device = device;
+	_jobSystem = &jobSystem;
+
+	//one chunk per thread is enough, more chunks than threads would only add pools
+	_threadFrames.resize(_jobSystem->threadCount());
+	for (std::vector<ThreadFrame>& threadFrames : _threadFrames) {
+		threadFrames.resize(frameCount);
+		for (ThreadFrame& threadFrame : threadFrames) {
+			vk::CommandPoolCreateInfo commandPoolCreateInfo({});
+			commandPoolCreateInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+			commandPoolCreateInfo.setQueueFamilyIndex(queueFamilyIndex);
+			threadFrame.commandPool = _device.createCommandPool(commandPoolCreateInfo);
+
+			vk::CommandBufferAllocateInfo commandBufferAllocateInfo({});
+			commandBufferAllocateInfo.setCommandPool(threadFrame.commandPool);
+			commandBufferAllocateInfo.setLevel(vk::CommandBufferLevel::eSecondary);
+			commandBufferAllocateInfo.setCommandBufferCount(1);
+			threadFrame.commandBuffer = _device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+		}
+	}
+}
+
+void CommandRecorder::destroy() {
+	for (std::vector<ThreadFrame>& threadFrames : _threadFrames) {
+		for (ThreadFrame& threadFrame : threadFrames) {
+			_device.destroyCommandPool(threadFrame.commandPool);
+		}
+	}
+	_threadFrames.clear();
+}
+
+std::vector<vk::CommandBuffer> CommandRecorder::record(uint32_t frame, const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t itemCount, const RecordRange& recordRange) {
+	uint32_t usefulChunks = std::max((itemCount + MIN_ITEMS_PER_THREAD - 1) / MIN_ITEMS_PER_THREAD, 1u);
+	uint32_t chunkCount = std::min(threadCount(), usefulChunks);
+
+	JobCounter counter;
+	for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+		_jobSystem->schedule([=, this, &inheritanceInfo, &recordRange] { recordChunk(chunk, chunkCount, frame, inheritanceInfo, itemCount, recordRange); }, &counter);
+	}
+	recordChunk(0, chunkCount, frame, inheritanceInfo, itemCount, recordRange);
+	_jobSystem->wait(counter);
+
+	std::vector<vk::CommandBuffer> commandBuffers(chunkCount);
+	for (uint32_t i = 0; i < chunkCount; i++) {
+		commandBuffers[i] = _threadFrames[i][frame].commandBuffer;
+	}
+	return commandBuffers;
+}
+
+void CommandRecorder::recordChunk(uint32_t chunk, uint32_t chunkCount, uint32_t frame, const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t itemCount, const RecordRange& recordRange) {
+	TRACE_FUNCTION();
+	ThreadFrame& threadFrame = _threadFrames[chunk][frame];
+	uint32_t first = static_cast<uint32_t>(uint64_t(itemCount) * chunk / chunkCount);
+	uint32_t last = static_cast<uint32_t>(uint64_t(itemCount) * (chunk + 1) / chunkCount);
+
+	//the frame's fence has signaled, nothing recorded from this pool is still executing
+	_device.resetCommandPool(threadFrame.commandPool);
+
+	vk::CommandBufferBeginInfo commandBufferBeginInfo({});
+	commandBufferBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue);
+	commandBufferBeginInfo.setPInheritanceInfo(&inheritanceInfo);
+	threadFrame.commandBuffer.begin(commandBufferBeginInfo);
+
+	recordRange(threadFrame.commandBuffer, first, last);
+
+	threadFrame.commandBuffer.end();
+}
+
+bool BindCache::changes(bool redundant) {
+	_bindCount += !redundant;
+	_skippedCount += redundant;
+	return !redundant;
+}
+
+void BindCache::bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline) {
+	if (changes(pipeline == _pipeline)) {
+		_commandBuffer.bindPipeline(bindPoint, pipeline);
+		_pipeline = pipeline;
+	}
+}
+
+void BindCache::bindDescriptorSet(vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout, uint32_t setIndex, vk::DescriptorSet descriptorSet, vk::ArrayProxy<const uint32_t> dynamicOffsets) {
+	assert(setIndex < MAX_SETS && dynamicOffsets.size() <= MAX_DYNAMIC_OFFSETS);
+	if (layout != _pipelineLayout) {
+		_sets = {};
+		_pipelineLayout = layout;
+	}
+
+	BoundSet& bound = _sets[setIndex];
+	bool redundant = descriptorSet == bound.descriptorSet && dynamicOffsets.size() == bound.dynamicOffsetCount
+		&& std::equal(dynamicOffsets.begin(), dynamicOffsets.end(), bound.dynamicOffsets.begin());
+	if (changes(redundant)) {
+		_commandBuffer.bindDescriptorSets(bindPoint, layout, setIndex, descriptorSet, dynamicOffsets);
+		bound.descriptorSet = descriptorSet;
+		bound.dynamicOffsetCount = dynamicOffsets.size();
+		std::copy(dynamicOffsets.begin(), dynamicOffsets.end(), bound.dynamicOffsets.begin());
+	}
+}
+
+void BindCache::bindVertexBuffer(vk::Buffer buffer, vk::DeviceSize offset) {
+	if (changes(buffer == _vertexBuffer && offset == _vertexOffset)) {
+		_commandBuffer.bindVertexBuffers(0, buffer, offset);
+		_vertexBuffer = buffer;
+		_vertexOffset = offset;
+	}
+}
+
+void BindCache::bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::IndexType indexType) {
+	if (changes(buffer == _indexBuffer && offset == _indexOffset && indexType == _indexType)) {
+		_commandBuffer.bindIndexBuffer(buffer, offset, indexType);
+		_indexBuffer = buffer;
+		_indexOffset = offset;
+		_indexType = indexType;
+	}
+}
@@ -0,0 +1,330 @@
+#include "../include/CullingPass.hpp"
+#include "../include/Utilities.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <format>
+
+// Mirrors CullConstants in shaders/cull.hlsl
+struct CullConstants {
+	uint32_t itemCount = 0;
+	uint32_t dispatchWidth = 1;	// workgroups along x, the item index wraps into y after that
+	uint32_t padding[2] = {};
+	glm::vec4 cameraPosition;
+};
+
+//GPU and CPU evaluate the planes with different rounding, objects this close to a plane may go either way
+static float cullTolerance(const glm::vec4& sphere) {
+	return 1e-3f * (1.0f + glm::length(glm::vec3(sphere)));
+}
+
+glm::vec4 worldBoundingSphere(const glm::vec4& sphere, const glm::mat4& model) {
+	glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+	float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+	return glm::vec4(center, sphere.w * scale);
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& matrix) {
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++) {
+		row[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+	}
+
+	//glm::perspective produces OpenGL depth (-w..w), the near plane is the looser w + z
+	Frustum frustum;
+	frustum.planes = { row[3] + row[0], row[3] - row[0], row[3] + row[1], row[3] - row[1], row[3] + row[2], row[3] - row[2] };
+	for (glm::vec4& plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return frustum;
+}
+
+float Frustum::sphereMargin(const glm::vec4& sphere) const {
+	float margin = FLT_MAX;
+	for (const glm::vec4& plane : planes) {
+		margin = std::min(margin, glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w + sphere.w);
+	}
+	return margin;
+}
+
+float meshletConeMargin(const MeshletData& meshlet, const InstanceData& instance, const glm::vec3& cameraPosition) {
+	if (meshlet.cone.w >= 1.0f) {
+		return -FLT_MAX;
+	}
+	glm::vec4 sphere = worldBoundingSphere(meshlet.boundingSphere, instance.model);
+	glm::vec3 axis = glm::normalize(glm::vec3(instance.model * glm::vec4(glm::vec3(meshlet.cone), 0.0f)));
+	glm::vec3 toCenter = glm::vec3(sphere) - cameraPosition;
+	return glm::dot(toCenter, axis) - meshlet.cone.w * glm::length(toCenter) - sphere.w;
+}
+
+void cullObjects(const std::vector<ObjectData>& objects, const std::vector<LodData>& lods, const InstanceData* instances, const Frustum& frustum, std::vector<vk::DrawIndexedIndirectCommand>& drawCommands) {
+	drawCommands.clear();
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		const ObjectData& object = objects[i];
+		if (frustum.sphereMargin(worldBoundingSphere(object.boundingSphere, instances[i].model)) >= 0.0f) {
+			const LodData& lod = lods[object.firstLod + instances[i].lod];
+			drawCommands.push_back(vk::DrawIndexedIndirectCommand(lod.indexCount, 1, lod.firstIndex, object.vertexOffset, i));
+		}
+	}
+}
+
+void cullClusters(const std::vector<ObjectData>& objects, const std::vector<LodData>& lods, const std::vector<MeshletData>& meshlets, const std::vector<ClusterData>& clusters, const InstanceData* instances, const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<vk::DrawIndexedIndirectCommand>& drawCommands) {
+	drawCommands.clear();
+	for (const ClusterData& cluster : clusters) {
+		const ObjectData& object = objects[cluster.object];
+		const MeshletData& meshlet = meshlets[cluster.meshlet];
+		const InstanceData& instance = instances[cluster.object];
+		if (frustum.sphereMargin(worldBoundingSphere(object.boundingSphere, instance.model)) < 0.0f) {
+			continue;
+		}
+		if (instance.lod > 0) {
+			if (cluster.meshlet == object.firstMeshlet) {
+				const LodData& lod = lods[object.firstLod + instance.lod];
+				drawCommands.push_back(vk::DrawIndexedIndirectCommand(lod.indexCount, 1, lod.firstIndex, object.vertexOffset, cluster.object));
+			}
+			continue;
+		}
+		if (frustum.sphereMargin(worldBoundingSphere(meshlet.boundingSphere, instance.model)) >= 0.0f && meshletConeMargin(meshlet, instance, cameraPosition) < 0.0f) {
+			drawCommands.push_back(vk::DrawIndexedIndirectCommand(meshlet.indexCount, 1, meshlet.firstIndex, object.vertexOffset, cluster.object));
+		}
+	}
+}
+
+void CullingPass::init(vk::Device device, MemoryAllocator& allocator, vk::PipelineCache pipelineCache, const std::vector<ObjectData>& objects, vk::Buffer objectBuffer, const std::vector<LodData>& lods, vk::Buffer lodBuffer, vk::Buffer instanceBuffer, vk::DeviceSize instanceRegionSize, uint32_t frameCount, vk::Buffer uniformBuffer, vk::DeviceSize uniformBufferSize,
+	const std::vector<MeshletData>& meshlets, vk::Buffer meshletBuffer, const std::vector<ClusterData>& clusters, vk::Buffer clusterBuffer, bool validate) {
+	_device = device;
+	_allocator = &allocator;
+	_validate = validate;
+	_objects = objects;
+	_lods = lods;
+	_meshlets = clusters.empty() ? std::vector<MeshletData>() : meshlets;
+	_clusters = clusters;
+
+	//binding 0 ubo, 1 objects, 2 indirect draws, 3 draw count, 4 instances, 5 LODs, cluster culling adds 6 meshlets, 7 clusters
+	std::vector<vk::DescriptorSetLayoutBinding> descriptorSetLayoutBindings(_clusters.empty() ? 6 : 8);
+	for (uint32_t i = 0; i < descriptorSetLayoutBindings.size(); i++) {
+		descriptorSetLayoutBindings[i].setBinding(i);
+		descriptorSetLayoutBindings[i].setDescriptorType(i == 0 ? vk::DescriptorType::eUniformBufferDynamic : vk::DescriptorType::eStorageBuffer);
+		descriptorSetLayoutBindings[i].setDescriptorCount(1);
+		descriptorSetLayoutBindings[i].setStageFlags(vk::ShaderStageFlagBits::eCompute);
+	}
+	vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo({});
+	descriptorSetLayoutCreateInfo.setBindings(descriptorSetLayoutBindings);
+	_descriptorSetLayout = _device.createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
+
+	std::array<vk::DescriptorPoolSize, 2> descriptorPoolSizes = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, frameCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(descriptorSetLayoutBindings.size() - 1) * frameCount)
+	};
+	vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo({});
+	descriptorPoolCreateInfo.setPoolSizes(descriptorPoolSizes);
+	descriptorPoolCreateInfo.setMaxSets(frameCount);
+	_descriptorPool = _device.createDescriptorPool(descriptorPoolCreateInfo);
+
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants));
+	vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({});
+	pipelineLayoutCreateInfo.setSetLayouts(_descriptorSetLayout);
+	pipelineLayoutCreateInfo.setPushConstantRanges(pushConstantRange);
+	_pipelineLayout = _device.createPipelineLayout(pipelineLayoutCreateInfo);
+
+	vk::ShaderModuleCreateInfo shaderModuleCreateInfo({});
+	std::vector<uint32_t> shaderCode = readShader(_clusters.empty() ? "shaders/cull_shader.spv" : "shaders/cluster_cull_shader.spv");
+	shaderModuleCreateInfo.setCode(shaderCode);
+	_shaderModule = _device.createShaderModule(shaderModuleCreateInfo);
+
+	vk::ComputePipelineCreateInfo computePipelineCreateInfo({});
+	computePipelineCreateInfo.setStage(vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, _shaderModule, _clusters.empty() ? "CS_main" : "CS_clusters"));
+	computePipelineCreateInfo.setLayout(_pipelineLayout);
+	vk::ResultValue<vk::Pipeline> pipeline = _device.createComputePipeline(pipelineCache, computePipelineCreateInfo);
+	if (pipeline.result != vk::Result::eSuccess) {
+		throw std::runtime_error(std::format("cull pipeline creation failure: {}", vk::to_string(pipeline.result)));
+	}
+	_pipeline = pipeline.value;
+
+	vk::DeviceSize indirectBufferSize = std::max<vk::DeviceSize>(itemCount(), 1) * sizeof(vk::DrawIndexedIndirectCommand);
+	_frames.resize(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++) {
+		Frame& frame = _frames[i];
+		createBuffer(allocator, _device, indirectBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eDeviceLocal, frame.indirectBuffer, frame.indirectAllocation);
+		createBuffer(allocator, _device, sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, frame.countBuffer, frame.countAllocation);
+		if (_validate) {
+			//count first, then the commands
+			createBuffer(allocator, _device, sizeof(uint32_t) + indirectBufferSize, vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, frame.readbackBuffer, frame.readbackAllocation);
+		}
+
+		vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo({});
+		descriptorSetAllocateInfo.setDescriptorPool(_descriptorPool);
+		descriptorSetAllocateInfo.setSetLayouts(_descriptorSetLayout);
+		frame.descriptorSet = _device.allocateDescriptorSets(descriptorSetAllocateInfo).front();
+
+		std::array<vk::DescriptorBufferInfo, 8> descriptorBufferInfos = {
+			vk::DescriptorBufferInfo(uniformBuffer, 0, uniformBufferSize),
+			vk::DescriptorBufferInfo(objectBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(frame.indirectBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(frame.countBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(instanceBuffer, i * instanceRegionSize, instanceRegionSize),
+			vk::DescriptorBufferInfo(lodBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(meshletBuffer, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(clusterBuffer, 0, VK_WHOLE_SIZE)
+		};
+		std::vector<vk::WriteDescriptorSet> writeDescriptorSets(descriptorSetLayoutBindings.size());
+		for (uint32_t binding = 0; binding < writeDescriptorSets.size(); binding++) {
+			writeDescriptorSets[binding].setDstSet(frame.descriptorSet);
+			writeDescriptorSets[binding].setDstBinding(binding);
+			writeDescriptorSets[binding].setDescriptorType(descriptorSetLayoutBindings[binding].descriptorType);
+			writeDescriptorSets[binding].setBufferInfo(descriptorBufferInfos[binding]);
+		}
+		_device.updateDescriptorSets(writeDescriptorSets, nullptr);
+	}
+}
+
+void CullingPass::destroy() {
+	for (Frame& frame : _frames) {
+		destroyBuffer(*_allocator, _device, frame.indirectBuffer, frame.indirectAllocation);
+		destroyBuffer(*_allocator, _device, frame.countBuffer, frame.countAllocation);
+		if (frame.readbackBuffer) {
+			destroyBuffer(*_allocator, _device, frame.readbackBuffer, frame.readbackAllocation);
+		}
+	}
+	_frames.clear();
+
+	_device.destroyPipeline(_pipeline);
+	_device.destroyPipelineLayout(_pipelineLayout);
+	_device.destroyShaderModule(_shaderModule);
+	_device.destroyDescriptorPool(_descriptorPool);
+	_device.destroyDescriptorSetLayout(_descriptorSetLayout);
+}
+
+void CullingPass::record(vk::CommandBuffer commandBuffer, uint32_t frame, uint32_t uniformOffset, const glm::mat4& cullMatrix, const glm::vec3& cameraPosition) {
+	Frame& currentFrame = _frames[frame];
+	currentFrame.cullMatrix = cullMatrix;
+	currentFrame.cameraPosition = cameraPosition;
+
+	commandBuffer.fillBuffer(currentFrame.countBuffer, 0, sizeof(uint32_t), 0);
+
+	vk::MemoryBarrier clearBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, clearBarrier, nullptr, nullptr);
+
+	//clusters easily outgrow the x limit of a dispatch, the shader rebuilds the flat index from x and y
+	uint32_t workgroupCount = (itemCount() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+	uint32_t workgroupsX = std::min(workgroupCount, MAX_WORKGROUPS_X);
+	CullConstants constants;
+	constants.itemCount = itemCount();
+	constants.dispatchWidth = std::max(workgroupsX, 1u);
+	constants.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _pipelineLayout, 0, currentFrame.descriptorSet, uniformOffset);
+	commandBuffer.pushConstants(_pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+	commandBuffer.dispatch(workgroupsX, (workgroupCount + constants.dispatchWidth - 1) / constants.dispatchWidth, 1);
+}
+
+void CullingPass::recordReadback(vk::CommandBuffer commandBuffer, uint32_t frame) {
+	if (!_validate) {
+		return;
+	}
+	Frame& currentFrame = _frames[frame];
+
+	commandBuffer.copyBuffer(currentFrame.countBuffer, currentFrame.readbackBuffer, vk::BufferCopy(0, 0, sizeof(uint32_t)));
+	commandBuffer.copyBuffer(currentFrame.indirectBuffer, currentFrame.readbackBuffer, vk::BufferCopy(0, sizeof(uint32_t), itemCount() * sizeof(vk::DrawIndexedIndirectCommand)));
+
+	vk::MemoryBarrier hostBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, hostBarrier, nullptr, nullptr);
+	currentFrame.pendingReadback = true;
+}
+
+void CullingPass::validate(uint32_t frame, const InstanceData* instances) {
+	Frame& currentFrame = _frames[frame];
+	if (!currentFrame.pendingReadback) {
+		return;
+	}
+	currentFrame.pendingReadback = false;
+
+	const uint8_t* readback = static_cast<const uint8_t*>(currentFrame.readbackAllocation.mapped);
+	uint32_t drawCount = 0;
+	memcpy(&drawCount, readback, sizeof(uint32_t));
+	if (drawCount > itemCount()) {
+		throw std::runtime_error(std::format("cull validation failure: draw count {} exceeds {} items", drawCount, itemCount()));
+	}
+
+	//the shader appends with an atomic, so the order is arbitrary
+	std::vector<vk::DrawIndexedIndirectCommand> gpuDrawCommands(drawCount);
+	memcpy(gpuDrawCommands.data(), readback + sizeof(uint32_t), drawCount * sizeof(vk::DrawIndexedIndirectCommand));
+	std::vector<std::pair<uint32_t, vk::DrawIndexedIndirectCommand>> gpuDraws;
+	for (const vk::DrawIndexedIndirectCommand& drawCommand : gpuDrawCommands) {
+		gpuDraws.emplace_back(drawItem(drawCommand), drawCommand);
+	}
+	std::sort(gpuDraws.begin(), gpuDraws.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	Frustum frustum = Frustum::fromMatrix(currentFrame.cullMatrix);
+	std::vector<vk::DrawIndexedIndirectCommand> cpuDrawCommands;
+	if (_clusters.empty()) {
+		cullObjects(_objects, _lods, instances, frustum, cpuDrawCommands);
+	} else {
+		cullClusters(_objects, _lods, _meshlets, _clusters, instances, frustum, currentFrame.cameraPosition, cpuDrawCommands);
+	}
+
+	//walk both lists in item order, a difference is only allowed for items on a plane within tolerance
+	size_t gpuIndex = 0, cpuIndex = 0;
+	while (gpuIndex < gpuDraws.size() || cpuIndex < cpuDrawCommands.size()) {
+		uint32_t gpuItem = gpuIndex < gpuDraws.size() ? gpuDraws[gpuIndex].first : UINT32_MAX;
+		uint32_t cpuItem = cpuIndex < cpuDrawCommands.size() ? drawItem(cpuDrawCommands[cpuIndex]) : UINT32_MAX;
+		uint32_t item = std::min(gpuItem, cpuItem);
+		if (item >= itemCount()) {
+			throw std::runtime_error(std::format("cull validation failure: draw for item {} of {}", item, itemCount()));
+		}
+
+		if (gpuItem == cpuItem) {
+			if (gpuDraws[gpuIndex].second != cpuDrawCommands[cpuIndex]) {
+				throw std::runtime_error(std::format("cull validation failure: draw parameters of item {} differ", item));
+			}
+		} else {
+			float margin = itemMargin(item, instances, frustum, currentFrame.cameraPosition);
+			uint32_t object = _clusters.empty() ? item : _clusters[item].object;
+			if (std::abs(margin) > cullTolerance(worldBoundingSphere(_objects[object].boundingSphere, instances[object].model))) {
+				throw std::runtime_error(std::format("cull validation failure: item {} {} on the GPU only (margin {})", item, gpuItem < cpuItem ? "visible" : "culled", margin));
+			}
+		}
+		gpuIndex += gpuItem == item;
+		cpuIndex += cpuItem == item;
+	}
+	_validatedFrameCount++;
+}
+
+uint32_t CullingPass::drawItem(const vk::DrawIndexedIndirectCommand& drawCommand) const {
+	if (drawCommand.firstInstance >= _objects.size()) {
+		return UINT32_MAX;
+	}
+	if (_clusters.empty()) {
+		return drawCommand.firstInstance;
+	}
+
+	//an object's clusters are consecutive and its meshlets ordered by firstIndex, coarser LODs start past all of them
+	const ObjectData& object = _objects[drawCommand.firstInstance];
+	auto cluster = std::lower_bound(_clusters.begin(), _clusters.end(), drawCommand.firstInstance, [](const ClusterData& candidate, uint32_t objectIndex) { return candidate.object < objectIndex; });
+	for (uint32_t lod = 1; lod < object.lodCount; lod++) {
+		if (_lods[object.firstLod + lod].firstIndex == drawCommand.firstIndex) {
+			return static_cast<uint32_t>(cluster - _clusters.begin());
+		}
+	}
+	auto first = _meshlets.begin() + object.firstMeshlet, last = first + object.meshletCount;
+	auto meshlet = std::lower_bound(first, last, drawCommand.firstIndex, [](const MeshletData& candidate, uint32_t firstIndex) { return candidate.firstIndex < firstIndex; });
+	if (meshlet == last || meshlet->firstIndex != drawCommand.firstIndex) {
+		return UINT32_MAX;
+	}
+	return static_cast<uint32_t>((cluster - _clusters.begin()) + (meshlet - first));
+}
+
+float CullingPass::itemMargin(uint32_t item, const InstanceData* instances, const Frustum& frustum, const glm::vec3& cameraPosition) const {
+	if (_clusters.empty()) {
+		return frustum.sphereMargin(worldBoundingSphere(_objects[item].boundingSphere, instances[item].model));
+	}
+	const ClusterData& cluster = _clusters[item];
+	const MeshletData& meshlet = _meshlets[cluster.meshlet];
+	const InstanceData& instance = instances[cluster.object];
+	float objectMargin = frustum.sphereMargin(worldBoundingSphere(_objects[cluster.object].boundingSphere, instance.model));
+	if (instance.lod > 0) {
+		return objectMargin;
+	}
+	return std::min({ objectMargin, frustum.sphereMargin(worldBoundingSphere(meshlet.boundingSphere, instance.model)), -meshletConeMargin(meshlet, instance, cameraPosition) });
+}
@@ -0,0 +1,118 @@
+#include "../include/DeviceQueues.hpp"
+#include "../include/Tracing.hpp"
+#include <algorithm>
+
+void DeviceQueues::selectFamilies(vk::PhysicalDevice physicalDevice, bool asyncCompute, bool asyncTransfer) {
+	auto queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
+	auto findFamily = [&](vk::QueueFlags required, vk::QueueFlags excluded) {
+		for (uint32_t i = 0; i < queueFamilyProperties.size(); ++i) {
+			vk::QueueFlags queueFlags = queueFamilyProperties[i].queueFlags;
+			if ((queueFlags & required) == required && !(queueFlags & excluded)) {
+				return i;
+			}
+		}
+		return UINT32_MAX;
+	};
+
+	//a graphics family with compute always exists, the culling fallback runs there
+	uint32_t graphics = findFamily(vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute, {});
+	if (graphics == UINT32_MAX) {
+		throw std::runtime_error("no graphics queue family");
+	}
+	uint32_t compute = asyncCompute ? findFamily(vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics) : UINT32_MAX;
+	uint32_t transfer = asyncTransfer ? findFamily(vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute) : UINT32_MAX;
+	_families[index(QueueType::eGraphics)] = graphics;
+	_families[index(QueueType::eCompute)] = compute == UINT32_MAX ? graphics : compute;
+	_families[index(QueueType::eTransfer)] = transfer == UINT32_MAX ? graphics : transfer;
+}
+
+std::vector<vk::DeviceQueueCreateInfo> DeviceQueues::queueCreateInfos() const {
+	static const float queuePriority = 1.0f;
+	std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos;
+	for (uint32_t family : sharingFamilies({ QueueType::eGraphics, QueueType::eCompute, QueueType::eTransfer })) {
+		deviceQueueCreateInfos.push_back(vk::DeviceQueueCreateInfo({}, family, 1, &queuePriority));
+	}
+	if (deviceQueueCreateInfos.empty()) {
+		deviceQueueCreateInfos.push_back(vk::DeviceQueueCreateInfo({}, family(QueueType::eGraphics), 1, &queuePriority));
+	}
+	return deviceQueueCreateInfos;
+}
+
+void DeviceQueues::init(vk::Device device) {
+	for (size_t i = 0; i < _queues.size(); i++) {
+		_queues[i] = device.getQueue(_families[i], 0);
+	}
+}
+
+std::vector<uint32_t> DeviceQueues::sharingFamilies(std::initializer_list<QueueType> types) const {
+	std::vector<uint32_t> families;
+	for (QueueType type : types) {
+		if (std::find(families.begin(), families.end(), family(type)) == families.end()) {
+			families.push_back(family(type));
+		}
+	}
+	if (families.size() < 2) {
+		families.clear();
+	}
+	return families;
+}
+
+void DeviceQueues::submit(QueueType type, const std::vector<vk::CommandBuffer>& commandBuffers, const std::vector<SemaphoreWait>& waits, const std::vector<SemaphoreSignal>& signals) const {
+	TRACE_FUNCTION();
+	//binary semaphores sit in the same arrays as timeline ones, their values are ignored
+	std::vector<vk::Semaphore> waitSemaphores;
+	std::vector<uint64_t> waitValues;
+	std::vector<vk::PipelineStageFlags> waitStages;
+	for (const SemaphoreWait& wait : waits) {
+		waitSemaphores.push_back(wait.semaphore);
+		waitValues.push_back(wait.value);
+		waitStages.push_back(wait.stages);
+	}
+	std::vector<vk::Semaphore> signalSemaphores;
+	std::vector<uint64_t> signalValues;
+	for (const SemaphoreSignal& signal : signals) {
+		signalSemaphores.push_back(signal.semaphore);
+		signalValues.push_back(signal.value);
+	}
+
+	vk::TimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo({});
+	timelineSemaphoreSubmitInfo.setWaitSemaphoreValues(waitValues);
+	timelineSemaphoreSubmitInfo.setSignalSemaphoreValues(signalValues);
+
+	vk::SubmitInfo submitInfo({});
+	submitInfo.setWaitSemaphores(waitSemaphores);
+	submitInfo.setWaitDstStageMask(waitStages);
+	submitInfo.setSignalSemaphores(signalSemaphores);
+	submitInfo.setCommandBuffers(commandBuffers);
+	submitInfo.setPNext(&timelineSemaphoreSubmitInfo);
+	queue(type).submit(submitInfo, nullptr);
+}
+
+void DeviceQueues::releaseBuffer(vk::CommandBuffer commandBuffer, vk::Buffer buffer, QueueType src, QueueType dst, vk::PipelineStageFlags2 srcStages, vk::AccessFlags2 srcAccess) const {
+	if (family(src) == family(dst)) {
+		return;
+	}
+	//the destination half of a release is ignored, the semaphore orders it with the acquire
+	vk::BufferMemoryBarrier2 bufferMemoryBarrier(srcStages, srcAccess, vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone, family(src), family(dst), buffer, 0, VK_WHOLE_SIZE);
+	vk::DependencyInfo dependencyInfo({});
+	dependencyInfo.setBufferMemoryBarriers(bufferMemoryBarrier);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+void DeviceQueues::acquireBuffer(vk::CommandBuffer commandBuffer, vk::Buffer buffer, QueueType src, QueueType dst, vk::PipelineStageFlags2 dstStages, vk::AccessFlags2 dstAccess) const {
+	if (family(src) == family(dst)) {
+		return;
+	}
+	//the source half of an acquire is ignored, the semaphore wait already covers the release
+	vk::BufferMemoryBarrier2 bufferMemoryBarrier(vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone, dstStages, dstAccess, family(src), family(dst), buffer, 0, VK_WHOLE_SIZE);
+	vk::DependencyInfo dependencyInfo({});
+	dependencyInfo.setBufferMemoryBarriers(bufferMemoryBarrier);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+vk::Semaphore createTimelineSemaphore(vk::Device device, uint64_t initialValue) {
+	vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, initialValue);
+	vk::SemaphoreCreateInfo semaphoreCreateInfo({});
+	semaphoreCreateInfo.setPNext(&semaphoreTypeCreateInfo);
+	return device.createSemaphore(semaphoreCreateInfo);
+}
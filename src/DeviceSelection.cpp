@@ -0,0 +1,180 @@
+#include "../include/DeviceSelection.hpp"
+#include "../include/DeviceQueues.hpp"
+#include "../include/BindlessDescriptors.hpp"
+#include "../include/Swapchain.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+static std::string lowercase(std::string text) {
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return text;
+}
+
+static const char* typeName(vk::PhysicalDeviceType type) {
+	switch (type) {
+	case vk::PhysicalDeviceType::eDiscreteGpu:
+		return "discrete";
+	case vk::PhysicalDeviceType::eIntegratedGpu:
+		return "integrated";
+	case vk::PhysicalDeviceType::eVirtualGpu:
+		return "virtual";
+	case vk::PhysicalDeviceType::eCpu:
+		return "cpu";
+	default:
+		return "other";
+	}
+}
+
+static DeviceCapabilities queryCapabilities(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface) {
+	DeviceCapabilities capabilities;
+	vk::PhysicalDeviceVulkan13Features vulkan13Features({});
+	vk::PhysicalDeviceVulkan12Features vulkan12Features({});
+	vulkan12Features.setPNext(&vulkan13Features);
+	vk::PhysicalDeviceFeatures2 features2({});
+	features2.setPNext(&vulkan12Features);
+	physicalDevice.getFeatures2(&features2);
+	capabilities.timelineSemaphore = vulkan12Features.timelineSemaphore;
+	capabilities.synchronization2 = vulkan13Features.synchronization2;
+	capabilities.drawIndirectCount = vulkan12Features.drawIndirectCount && features2.features.multiDrawIndirect && features2.features.drawIndirectFirstInstance;
+	capabilities.descriptorIndexing = BindlessDescriptors::supported(vulkan12Features);
+
+	DeviceQueues queues;
+	queues.selectFamilies(physicalDevice, true, true);
+	capabilities.dedicatedCompute = queues.dedicated(QueueType::eCompute);
+	capabilities.dedicatedTransfer = queues.dedicated(QueueType::eTransfer);
+
+	if (surface) {
+		for (const vk::ExtensionProperties& extension : physicalDevice.enumerateDeviceExtensionProperties()) {
+			capabilities.swapchain |= strcmp(extension.extensionName.data(), VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+		}
+		capabilities.present = physicalDevice.getSurfaceSupportKHR(queues.family(QueueType::eGraphics), surface);
+		capabilities.presentWait = Swapchain::presentWaitSupported(physicalDevice);
+	}
+
+	vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+		if (memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+			capabilities.deviceLocalBytes = std::max(capabilities.deviceLocalBytes, memoryProperties.memoryHeaps[i].size);
+		}
+	}
+	return capabilities;
+}
+
+static int64_t score(const DeviceCandidate& candidate) {
+	int64_t score = 0;
+	switch (candidate.type) {
+	case vk::PhysicalDeviceType::eDiscreteGpu:
+		score += 10000;
+		break;
+	case vk::PhysicalDeviceType::eIntegratedGpu:
+		score += 5000;
+		break;
+	case vk::PhysicalDeviceType::eVirtualGpu:
+		score += 2000;
+		break;
+	default:
+		break;
+	}
+	//fast paths weigh less than the device type, they only break ties between similar devices
+	const DeviceCapabilities& capabilities = candidate.capabilities;
+	score += capabilities.drawIndirectCount ? 800 : 0;
+	score += capabilities.descriptorIndexing ? 400 : 0;
+	score += capabilities.dedicatedCompute ? 200 : 0;
+	score += capabilities.dedicatedTransfer ? 100 : 0;
+	score += capabilities.presentWait ? 50 : 0;
+	//integrated GPUs report shared system memory, cap it so it never outweighs a discrete device
+	score += static_cast<int64_t>(std::min<vk::DeviceSize>(capabilities.deviceLocalBytes >> 30, 32)) * 10;
+	return score;
+}
+
+std::vector<DeviceCandidate> enumerateDevices(vk::Instance instance, vk::SurfaceKHR surface) {
+	std::vector<DeviceCandidate> candidates;
+	for (vk::PhysicalDevice physicalDevice : instance.enumeratePhysicalDevices()) {
+		DeviceCandidate candidate;
+		vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+		candidate.physicalDevice = physicalDevice;
+		candidate.index = static_cast<uint32_t>(candidates.size());
+		candidate.name = properties.deviceName.data();
+		candidate.type = properties.deviceType;
+		candidate.apiVersion = properties.apiVersion;
+
+		//below 1.3 the feature structs queried for the capabilities are not valid to chain
+		if (candidate.apiVersion < vk::ApiVersion13) {
+			candidate.rejection = "Vulkan 1.3 not supported";
+			candidates.push_back(candidate);
+			continue;
+		}
+		try {
+			candidate.capabilities = queryCapabilities(physicalDevice, surface);
+		} catch (std::runtime_error& error) {
+			candidate.rejection = error.what();
+			candidates.push_back(candidate);
+			continue;
+		}
+		const DeviceCapabilities& capabilities = candidate.capabilities;
+		if (!capabilities.timelineSemaphore) {
+			candidate.rejection = "timeline semaphores not supported";
+		} else if (!capabilities.synchronization2) {
+			candidate.rejection = "synchronization2 not supported";
+		} else if (surface && !capabilities.swapchain) {
+			candidate.rejection = "VK_KHR_swapchain not supported";
+		} else if (surface && !capabilities.present) {
+			candidate.rejection = "graphics queue cannot present to the window";
+		}
+		candidate.score = candidate.rejection.empty() ? score(candidate) : 0;
+		candidates.push_back(candidate);
+	}
+	return candidates;
+}
+
+static bool matchesOverride(const DeviceCandidate& candidate, const std::string& overrideName) {
+	if (std::all_of(overrideName.begin(), overrideName.end(), [](unsigned char c) { return std::isdigit(c); })) {
+		return std::stoul(overrideName) == candidate.index;
+	}
+	std::string name = lowercase(overrideName);
+	return name == typeName(candidate.type) || lowercase(candidate.name).find(name) != std::string::npos;
+}
+
+DeviceCandidate selectPhysicalDevice(vk::Instance instance, vk::SurfaceKHR surface, const std::string& overrideName) {
+	std::string pinned = overrideName;
+	const char* environment = std::getenv(DEVICE_OVERRIDE_ENV);
+	if (pinned.empty() && environment) {
+		pinned = environment;
+	}
+
+	std::vector<DeviceCandidate> candidates = enumerateDevices(instance, surface);
+	std::cout << "Available Devices: " << std::endl;
+	const DeviceCandidate* selected = nullptr;
+	for (const DeviceCandidate& candidate : candidates) {
+		if (candidate.rejection.empty()) {
+			std::cout << std::format("  [{}] {} ({}), score {}", candidate.index, candidate.name, typeName(candidate.type), candidate.score) << std::endl;
+		} else {
+			std::cout << std::format("  [{}] {} ({}), unsuitable: {}", candidate.index, candidate.name, typeName(candidate.type), candidate.rejection) << std::endl;
+			continue;
+		}
+		if (!pinned.empty() && !matchesOverride(candidate, pinned)) {
+			continue;
+		}
+		//ties keep the first in enumeration order
+		if (!selected || candidate.score > selected->score) {
+			selected = &candidate;
+		}
+	}
+	std::cout << std::endl;
+
+	if (!selected) {
+		throw std::runtime_error(pinned.empty() ? "no suitable Vulkan 1.3 device" : std::format("no suitable device matches \"{}\"", pinned));
+	}
+	const DeviceCapabilities& capabilities = selected->capabilities;
+	std::cout << "Selected Device: " << selected->name << (pinned.empty() ? "" : std::format(" (pinned by \"{}\")", pinned)) << std::endl;
+	std::cout << "driverVersion: " << selected->physicalDevice.getProperties().driverVersion << std::endl;
+	std::cout << std::format("drawIndirectCount {}, descriptor indexing {}, present wait {}, dedicated compute {}, dedicated transfer {}, {:.1f} GB device local",
+		capabilities.drawIndirectCount, capabilities.descriptorIndexing, capabilities.presentWait, capabilities.dedicatedCompute, capabilities.dedicatedTransfer,
+		capabilities.deviceLocalBytes / (1024.0 * 1024.0 * 1024.0)) << std::endl;
+	std::cout << std::endl;
+	return *selected;
+}
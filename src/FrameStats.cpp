@@ -0,0 +1,68 @@
+#include "../include/FrameStats.hpp"
+#include "../include/Tracing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// nearest-rank percentile on already sorted samples
+static double percentile(const std::vector<double>& sortedSamples, double fraction) {
+	size_t rank = static_cast<size_t>(std::ceil(fraction * sortedSamples.size()));
+	return sortedSamples[std::clamp<size_t>(rank, 1, sortedSamples.size()) - 1];
+}
+
+MetricSummary FrameStats::summarize(std::vector<double> samples) {
+	MetricSummary summary;
+	summary.count = samples.size();
+	if (samples.empty()) {
+		return summary;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+	summary.p50 = percentile(samples, 0.50);
+	summary.p95 = percentile(samples, 0.95);
+	summary.p99 = percentile(samples, 0.99);
+	summary.max = samples.back();
+	return summary;
+}
+
+static void writeMetric(std::ostream& out, const char* name, const std::vector<double>& samples, bool last) {
+	MetricSummary summary = FrameStats::summarize(samples);
+	out << "\t\t\"" << name << "\": { "
+		<< "\"count\": " << summary.count << ", "
+		<< "\"mean\": " << summary.mean << ", "
+		<< "\"p50\": " << summary.p50 << ", "
+		<< "\"p95\": " << summary.p95 << ", "
+		<< "\"p99\": " << summary.p99 << ", "
+		<< "\"max\": " << summary.max << " }"
+		<< (last ? "" : ",") << std::endl;
+}
+
+void FrameStats::writeJson(std::ostream& out, const std::string& deviceName, bool headless) const {
+	out << "{" << std::endl;
+	out << "\t\"device\": \"" << escapeJson(deviceName) << "\"," << std::endl;
+	out << "\t\"headless\": " << (headless ? "true" : "false") << "," << std::endl;
+	out << "\t\"frames\": " << cpuFrameMs.size() << "," << std::endl;
+	out << "\t\"framesInFlight\": " << framesInFlight << "," << std::endl;
+	out << "\t\"presentMode\": \"" << escapeJson(presentMode) << "\"," << std::endl;
+	out << "\t\"swapchainRecreates\": " << swapchainRecreates << "," << std::endl;
+	out << "\t\"unit\": \"ms\"," << std::endl;
+	out << "\t\"metrics\": {" << std::endl;
+	writeMetric(out, "cpuFrame", cpuFrameMs, false);
+	writeMetric(out, "frameWait", frameWaitMs, false);
+	writeMetric(out, "acquire", acquireMs, false);
+	writeMetric(out, "present", presentMs, false);
+	writeMetric(out, "gpu", gpuMs, false);
+	writeMetric(out, "gpuIdle", gpuIdleMs, false);
+	writeMetric(out, "inputLatency", inputLatencyMs, true);
+	out << "\t}," << std::endl;
+	out << "\t\"counters\": {" << std::endl;
+	writeMetric(out, "triangles", triangles, false);
+	writeMetric(out, "binds", binds, false);
+	writeMetric(out, "bindsSkipped", bindsSkipped, false);
+	writeMetric(out, "framesQueued", framesQueued, false);
+	writeMetric(out, "pendingDeletions", pendingDeletions, false);
+	writeMetric(out, "pendingDeletionBytes", pendingDeletionBytes, true);
+	out << "\t}" << std::endl;
+	out << "}" << std::endl;
+}
@@ -0,0 +1,97 @@
+#include "../include/GpuTrace.hpp"
+#include "../include/Tracing.hpp"
+#include <algorithm>
+
+void GpuTrace::init(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount) {
+	_device = device;
+	_frames.assign(frameCount, {});
+	uint32_t timestampValidBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+	float timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+	if (!tracingEnabled() || timestampValidBits == 0 || timestampPeriod <= 0.0f) {
+		return;
+	}
+	_timestampPeriod = timestampPeriod;
+	_timestampMask = timestampValidBits >= 64 ? UINT64_MAX : ((1ull << timestampValidBits) - 1);
+
+	//a begin and an end query per zone and frame in flight
+	vk::QueryPoolCreateInfo queryPoolCreateInfo({});
+	queryPoolCreateInfo.setQueryType(vk::QueryType::eTimestamp);
+	queryPoolCreateInfo.setQueryCount(2 * MAX_ZONES * frameCount);
+	_queryPool = _device.createQueryPool(queryPoolCreateInfo);
+}
+
+void GpuTrace::destroy() {
+	if (_queryPool) {
+		_device.destroyQueryPool(_queryPool);
+		_queryPool = nullptr;
+	}
+}
+
+void GpuTrace::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frame) {
+	_frame = frame;
+	Frame& frameZones = _frames[frame];
+	frameZones.zones.clear();
+	frameZones.openZones.clear();
+	frameZones.submitNs = 0;
+	if (enabled()) {
+		commandBuffer.resetQueryPool(_queryPool, 2 * MAX_ZONES * frame, 2 * MAX_ZONES);
+	}
+}
+
+void GpuTrace::begin(vk::CommandBuffer commandBuffer, const char* name) {
+	Frame& frameZones = _frames[_frame];
+	if (!enabled() || frameZones.zones.size() >= MAX_ZONES) {
+		frameZones.openZones.push_back(UINT32_MAX);
+		return;
+	}
+	Zone zone;
+	zone.name = name;
+	zone.query = 2 * (MAX_ZONES * _frame + static_cast<uint32_t>(frameZones.zones.size()));
+	//bottom of pipe waits for the commands before it, zones then line up back to back instead of overlapping
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, _queryPool, zone.query);
+	frameZones.openZones.push_back(static_cast<uint32_t>(frameZones.zones.size()));
+	frameZones.zones.push_back(zone);
+}
+
+void GpuTrace::end(vk::CommandBuffer commandBuffer) {
+	Frame& frameZones = _frames[_frame];
+	uint32_t zone = frameZones.openZones.back();
+	frameZones.openZones.pop_back();
+	if (zone != UINT32_MAX) {
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, _queryPool, frameZones.zones[zone].query + 1);
+	}
+}
+
+void GpuTrace::submitted(uint32_t frame) {
+	_frames[frame].submitNs = traceNow();
+}
+
+void GpuTrace::collect(uint32_t frame) {
+	Frame& frameZones = _frames[frame];
+	if (!enabled() || frameZones.zones.empty() || frameZones.submitNs == 0) {
+		return;
+	}
+
+	//the frame's submit has finished, so its queries are available without waiting
+	uint32_t queryCount = 2 * static_cast<uint32_t>(frameZones.zones.size());
+	vk::ResultValue<std::vector<uint64_t>> timestamps = _device.getQueryPoolResults<uint64_t>(_queryPool, 2 * MAX_ZONES * frame, queryCount, queryCount * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	if (timestamps.result == vk::Result::eSuccess) {
+		size_t firstZone = _collected.size();
+		for (uint32_t i = 0; i < frameZones.zones.size(); i++) {
+			Zone zone = frameZones.zones[i];
+			zone.beginNs = static_cast<uint64_t>((timestamps.value[2 * i] & _timestampMask) * _timestampPeriod);
+			zone.endNs = static_cast<uint64_t>((timestamps.value[2 * i + 1] & _timestampMask) * _timestampPeriod);
+			_collected.push_back(zone);
+		}
+		//the first zone opens the command buffer, it cannot have started before the submit
+		_clockOffset = std::min(_clockOffset, static_cast<int64_t>(_collected[firstZone].beginNs) - static_cast<int64_t>(frameZones.submitNs));
+	}
+	frameZones.zones.clear();
+}
+
+void GpuTrace::flush() {
+	for (const Zone& zone : _collected) {
+		addGpuTraceEvent(zone.name, static_cast<uint64_t>(static_cast<int64_t>(zone.beginNs) - _clockOffset), static_cast<uint64_t>(static_cast<int64_t>(zone.endNs) - _clockOffset));
+	}
+	_collected.clear();
+}
@@ -0,0 +1,184 @@
+#include "../include/JobSystem.hpp"
+#include "../include/Tracing.hpp"
+#include <algorithm>
+#include <format>
+
+static thread_local uint32_t t_threadIndex = 0;
+
+uint32_t JobSystem::threadIndex() {
+	return t_threadIndex;
+}
+
+void JobSystem::init(uint32_t workerCount) {
+	if (workerCount == 0) {
+		workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	_quit = false;
+	for (uint32_t i = 0; i <= workerCount; i++) {
+		_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	t_threadIndex = 0;
+	for (uint32_t i = 1; i <= workerCount; i++) {
+		_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+void JobSystem::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_quit = true;
+	}
+	_workAvailable.notify_all();
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+	_workers.clear();
+	_queues.clear();
+}
+
+void JobSystem::schedule(Job job, JobCounter* counter) {
+	if (counter) {
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	push(Task{ std::move(job), counter });
+}
+
+void JobSystem::scheduleAfter(JobCounter& dependency, Job job, JobCounter* counter) {
+	if (counter) {
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		//finish() drains continuations and releases the count under the same lock,
+		//so a continuation is either queued here or picked up there, never lost
+		std::lock_guard<std::mutex> lock(_continuationMutex);
+		if (!dependency.isDone()) {
+			dependency._continuations.push_back(JobCounter::Continuation{ std::move(job), counter });
+			return;
+		}
+	}
+	push(Task{ std::move(job), counter });
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t first, uint32_t last)>& rangeJob, JobCounter& counter) {
+	grainSize = std::max(grainSize, 1u);
+	for (uint32_t first = 0; first < count; first += grainSize) {
+		uint32_t last = std::min(first + grainSize, count);
+		schedule([&rangeJob, first, last] { rangeJob(first, last); }, &counter);
+	}
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	uint32_t index = threadIndex();
+	while (!counter.isDone()) {
+		if (!runOneTask(index)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::push(Task task) {
+	//counted before it becomes visible so a thief can never take the count below zero,
+	//seq_cst pairs with the worker's increment of _sleepingWorkers before it re-checks _queuedTasks
+	_queuedTasks.fetch_add(1);
+
+	WorkQueue& queue = *_queues[threadIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	if (_sleepingWorkers.load() > 0) {
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+		}
+		_workAvailable.notify_one();
+	}
+}
+
+bool JobSystem::pop(uint32_t queueIndex, Task& task) {
+	WorkQueue& queue = *_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool JobSystem::steal(uint32_t thiefIndex, Task& task) {
+	uint32_t queueCount = static_cast<uint32_t>(_queues.size());
+	for (uint32_t i = 1; i < queueCount; i++) {
+		WorkQueue& queue = *_queues[(thiefIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::runOneTask(uint32_t threadIndex) {
+	Task task;
+	if (!pop(threadIndex, task) && !steal(threadIndex, task)) {
+		return false;
+	}
+	_queuedTasks.fetch_sub(1);
+
+	task.job();
+	finish(task.counter);
+	return true;
+}
+
+void JobSystem::finish(JobCounter* counter) {
+	if (!counter) {
+		return;
+	}
+
+	std::vector<JobCounter::Continuation> continuations;
+	uint32_t pending = counter->_pending.load(std::memory_order_acquire);
+	for (;;) {
+		if (pending > 1) {
+			if (counter->_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel)) {
+				return;
+			}
+			continue;
+		}
+
+		//last job: take the continuations first, then publish zero as the final access to the counter,
+		//a waiter may destroy it as soon as it observes zero
+		std::lock_guard<std::mutex> lock(_continuationMutex);
+		continuations.swap(counter->_continuations);
+		if (counter->_pending.compare_exchange_strong(pending, 0, std::memory_order_acq_rel)) {
+			break;
+		}
+		//more work was scheduled against the counter in the meantime, it is not done yet
+		counter->_continuations.swap(continuations);
+	}
+
+	for (JobCounter::Continuation& continuation : continuations) {
+		push(Task{ std::move(continuation.job), continuation.counter });
+	}
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex) {
+	t_threadIndex = threadIndex;
+	if (tracingEnabled()) {
+		setTraceThreadName(std::format("worker {}", threadIndex));
+	}
+	while (!_quit.load(std::memory_order_relaxed)) {
+		if (runOneTask(threadIndex)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_sleepingWorkers.fetch_add(1);
+		_workAvailable.wait(lock, [this] { return _quit.load() || _queuedTasks.load() > 0; });
+		_sleepingWorkers.fetch_sub(1);
+	}
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "../include/JobSystem.hpp"
+
+// Measures scheduling overhead of the job system with empty and near-empty jobs
+static double nanosecondsPerJob(std::chrono::high_resolution_clock::time_point startTime, uint32_t jobCount) {
+	return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - startTime).count() / jobCount;
+}
+
+int main(int argc, char* argv[]) {
+	uint32_t jobCount = 1000000;
+	uint32_t workerCount = 0;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--jobs" && i + 1 < argc) {
+			jobCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--workers" && i + 1 < argc) {
+			workerCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else {
+			std::cout << "usage: " << argv[0] << " [--jobs N] [--workers W]" << std::endl;
+			return 1;
+		}
+	}
+
+	JobSystem jobSystem;
+	jobSystem.init(workerCount);
+	std::cout << "Job system: " << jobSystem.workerCount() << " workers, " << jobCount << " jobs per test" << std::endl;
+
+	std::atomic<uint64_t> sum{ 0 };
+
+	//every job scheduled from the owner thread, workers have to steal all of them
+	{
+		JobCounter counter;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < jobCount; i++) {
+			jobSystem.schedule([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		}
+		jobSystem.wait(counter);
+		std::cout << "schedule + steal: " << nanosecondsPerJob(startTime, jobCount) << " ns/job" << std::endl;
+	}
+
+	//jobs that spawn jobs: most work stays on the spawning worker's own deque
+	{
+		JobCounter counter;
+		const uint32_t fanOut = 64;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < jobCount / fanOut; i++) {
+			jobSystem.schedule([&jobSystem, &sum, &counter] {
+				for (uint32_t j = 0; j < fanOut; j++) {
+					jobSystem.schedule([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				}
+			}, &counter);
+		}
+		jobSystem.wait(counter);
+		std::cout << "nested spawn: " << nanosecondsPerJob(startTime, jobCount / fanOut * (fanOut + 1)) << " ns/job" << std::endl;
+	}
+
+	//parallelFor with one element per chunk
+	{
+		JobCounter counter;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		jobSystem.parallelFor(jobCount, 1, [&sum](uint32_t first, uint32_t last) { sum.fetch_add(last - first, std::memory_order_relaxed); }, counter);
+		jobSystem.wait(counter);
+		std::cout << "parallelFor (grain 1): " << nanosecondsPerJob(startTime, jobCount) << " ns/job" << std::endl;
+	}
+
+	//a chain of dependent jobs, measures continuation release latency
+	{
+		const uint32_t chainLength = std::min(jobCount, 100000u);
+		std::vector<JobCounter> counters(chainLength);
+		auto startTime = std::chrono::high_resolution_clock::now();
+		jobSystem.schedule([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, &counters[0]);
+		for (uint32_t i = 1; i < chainLength; i++) {
+			jobSystem.scheduleAfter(counters[i - 1], [&sum] { sum.fetch_add(1, std::memory_order_relaxed); }, &counters[i]);
+		}
+		jobSystem.wait(counters[chainLength - 1]);
+		std::cout << "dependency chain: " << nanosecondsPerJob(startTime, chainLength) << " ns/job" << std::endl;
+	}
+
+	jobSystem.destroy();
+	std::cout << "executed " << sum.load() << " increments" << std::endl;
+	return 0;
+}
@@ -0,0 +1,21 @@
+#include "../include/LodSelection.hpp"
+#include <algorithm>
+
+float meshPixelsPerUnit(const glm::vec4& boundingSphere, const glm::mat4& model, const glm::vec3& cameraPosition, float projectionScale, float nearPlane) {
+	glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+	float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+	float distance = std::max(glm::length(center - cameraPosition) - boundingSphere.w * scale, nearPlane);
+	return projectionScale * scale / distance;
+}
+
+uint32_t selectLod(const MeshLod* lods, uint32_t lodCount, float pixelsPerUnit, uint32_t currentLod, float errorPixels, float hysteresis) {
+	uint32_t lod = 0;
+	for (uint32_t candidate = 1; candidate < lodCount; candidate++) {
+		float limit = candidate > currentLod ? errorPixels * (1.0f - hysteresis) : errorPixels;
+		if (lods[candidate].error * pixelsPerUnit > limit) {
+			break;
+		}
+		lod = candidate;
+	}
+	return lod;
+}
@@ -0,0 +1,348 @@
+#include "../include/MemoryAllocator.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+float AllocatorStats::internalFragmentation() const {
+	if (allocatedBytes == 0) {
+		return 0.0f;
+	}
+	return static_cast<float>(allocatedBytes - requestedBytes) / static_cast<float>(allocatedBytes);
+}
+
+float AllocatorStats::externalFragmentation() const {
+	if (freeBytes == 0) {
+		return 0.0f;
+	}
+	return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+}
+
+void MemoryAllocator::init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize) {
+	if (!std::has_single_bit(blockSize) || blockSize < MIN_BUDDY_SIZE) {
+		throw std::runtime_error("MemoryAllocator block size must be a power of two");
+	}
+
+	_physicalDevice = physicalDevice;
+	_device = device;
+	_blockSize = blockSize;
+	_memoryProperties = physicalDevice.getMemoryProperties();
+
+	vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+	_bufferImageGranularity = limits.bufferImageGranularity;
+	_maxMemoryAllocationCount = limits.maxMemoryAllocationCount;
+
+	_pools.resize(_memoryProperties.memoryTypeCount);
+}
+
+void MemoryAllocator::destroy() {
+	for (MemoryPool& pool : _pools) {
+		for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+			if (block) {
+				destroyBlock(*block);
+			}
+		}
+		pool.blocks.clear();
+	}
+	for (std::unique_ptr<MemoryBlock>& block : _dedicatedBlocks) {
+		if (block) {
+			destroyBlock(*block);
+		}
+	}
+	_dedicatedBlocks.clear();
+}
+
+uint32_t MemoryAllocator::findMemoryTypeIndex(uint32_t typeFilter, vk::MemoryPropertyFlags memoryPropertyFlags) const {
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags) {
+			return i;
+		}
+	}
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+uint32_t MemoryAllocator::orderCount(vk::DeviceSize blockSize) const {
+	return static_cast<uint32_t>(std::countr_zero(blockSize / MIN_BUDDY_SIZE)) + 1;
+}
+
+std::unique_ptr<MemoryAllocator::MemoryBlock> MemoryAllocator::createBlock(uint32_t memoryTypeIndex, vk::DeviceSize size, AllocationStrategy strategy) {
+	if (_deviceMemoryCount >= _maxMemoryAllocationCount) {
+		throw std::runtime_error("MemoryAllocator exceeded maxMemoryAllocationCount");
+	}
+
+	vk::MemoryAllocateInfo memoryAllocateInfo({});
+	memoryAllocateInfo.setAllocationSize(size);
+	memoryAllocateInfo.setMemoryTypeIndex(memoryTypeIndex);
+
+	std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+	block->deviceMemory = _device.allocateMemory(memoryAllocateInfo);
+	block->size = size;
+	block->strategy = strategy;
+	_deviceMemoryCount++;
+
+	if (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+		block->mapped = _device.mapMemory(block->deviceMemory, 0, VK_WHOLE_SIZE);
+	}
+
+	if (strategy == AllocationStrategy::eBuddy) {
+		block->freeLists.resize(orderCount(size));
+		block->freeLists.back().insert(0);
+	}
+	return block;
+}
+
+void MemoryAllocator::destroyBlock(MemoryBlock& block) {
+	if (block.mapped) {
+		_device.unmapMemory(block.deviceMemory);
+		block.mapped = nullptr;
+	}
+	_device.freeMemory(block.deviceMemory);
+	block.deviceMemory = nullptr;
+	_deviceMemoryCount--;
+}
+
+bool MemoryAllocator::allocateBuddy(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset, vk::DeviceSize& allocatedSize) {
+	//every node is aligned to its own size, so rounding up to the alignment is enough
+	vk::DeviceSize nodeSize = std::bit_ceil(std::max({ size, alignment, MIN_BUDDY_SIZE }));
+	if (nodeSize > block.size) {
+		return false;
+	}
+	uint32_t order = static_cast<uint32_t>(std::countr_zero(nodeSize / MIN_BUDDY_SIZE));
+
+	uint32_t freeOrder = order;
+	while (freeOrder < block.freeLists.size() && block.freeLists[freeOrder].empty()) {
+		freeOrder++;
+	}
+	if (freeOrder == block.freeLists.size()) {
+		return false;
+	}
+
+	vk::DeviceSize nodeOffset = *block.freeLists[freeOrder].begin();
+	block.freeLists[freeOrder].erase(block.freeLists[freeOrder].begin());
+
+	//split down, returning the upper halves to the free lists
+	while (freeOrder > order) {
+		freeOrder--;
+		block.freeLists[freeOrder].insert(nodeOffset + (MIN_BUDDY_SIZE << freeOrder));
+	}
+
+	offset = nodeOffset;
+	allocatedSize = nodeSize;
+	return true;
+}
+
+void MemoryAllocator::freeBuddy(MemoryBlock& block, vk::DeviceSize offset, vk::DeviceSize allocatedSize) {
+	uint32_t order = static_cast<uint32_t>(std::countr_zero(allocatedSize / MIN_BUDDY_SIZE));
+	uint32_t topOrder = static_cast<uint32_t>(block.freeLists.size()) - 1;
+
+	while (order < topOrder) {
+		vk::DeviceSize buddyOffset = offset ^ (MIN_BUDDY_SIZE << order);
+		auto buddy = block.freeLists[order].find(buddyOffset);
+		if (buddy == block.freeLists[order].end()) {
+			break;
+		}
+		block.freeLists[order].erase(buddy);
+		offset = std::min(offset, buddyOffset);
+		order++;
+	}
+	block.freeLists[order].insert(offset);
+}
+
+bool MemoryAllocator::allocateLinear(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset, vk::DeviceSize& allocatedSize) {
+	vk::DeviceSize alignedOffset = alignUp(block.head, alignment);
+	if (alignedOffset + size > block.size) {
+		return false;
+	}
+	offset = alignedOffset;
+	allocatedSize = alignedOffset + size - block.head;
+	block.head = alignedOffset + size;
+	return true;
+}
+
+Allocation MemoryAllocator::allocate(const vk::MemoryRequirements& memoryRequirements, vk::MemoryPropertyFlags memoryPropertyFlags, AllocationStrategy strategy, bool optimalTilingImage) {
+	vk::DeviceSize size = memoryRequirements.size;
+	vk::DeviceSize alignment = std::max<vk::DeviceSize>(memoryRequirements.alignment, 1);
+
+	//keep optimal images on their own bufferImageGranularity pages so they never share one with a buffer
+	if (optimalTilingImage && _bufferImageGranularity > 1) {
+		alignment = std::max(alignment, _bufferImageGranularity);
+		size = alignUp(size, _bufferImageGranularity);
+	}
+
+	Allocation allocation;
+	allocation.memoryTypeIndex = findMemoryTypeIndex(memoryRequirements.memoryTypeBits, memoryPropertyFlags);
+	allocation.size = memoryRequirements.size;
+	allocation.strategy = strategy;
+
+	vk::MemoryHeap heap = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex];
+	//small heaps (e.g. 256MB BAR) get smaller blocks so one block cannot exhaust them
+	vk::DeviceSize blockSize = std::min(_blockSize, std::bit_floor(std::max(heap.size / 8, MIN_BUDDY_SIZE)));
+
+	//anything bigger than half a block gets its own vk::DeviceMemory
+	if (size > blockSize / 2) {
+		std::unique_ptr<MemoryBlock> block = createBlock(allocation.memoryTypeIndex, size, AllocationStrategy::eLinear);
+		block->head = size;
+		block->liveAllocations = 1;
+		block->requestedBytes = memoryRequirements.size;
+		block->allocatedBytes = size;
+
+		allocation.deviceMemory = block->deviceMemory;
+		allocation.offset = 0;
+		allocation.allocatedSize = size;
+		allocation.mapped = block->mapped;
+		allocation.dedicated = true;
+
+		auto freeSlot = std::find(_dedicatedBlocks.begin(), _dedicatedBlocks.end(), nullptr);
+		if (freeSlot != _dedicatedBlocks.end()) {
+			*freeSlot = std::move(block);
+			allocation.blockIndex = static_cast<uint32_t>(freeSlot - _dedicatedBlocks.begin());
+		} else {
+			_dedicatedBlocks.push_back(std::move(block));
+			allocation.blockIndex = static_cast<uint32_t>(_dedicatedBlocks.size() - 1);
+		}
+		return allocation;
+	}
+
+	MemoryPool& pool = _pools[allocation.memoryTypeIndex];
+	auto tryBlock = [&](MemoryBlock& block, uint32_t blockIndex) {
+		if (block.strategy != strategy) {
+			return false;
+		}
+		bool success = strategy == AllocationStrategy::eBuddy
+			? allocateBuddy(block, size, alignment, allocation.offset, allocation.allocatedSize)
+			: allocateLinear(block, size, alignment, allocation.offset, allocation.allocatedSize);
+		if (!success) {
+			return false;
+		}
+		block.liveAllocations++;
+		block.requestedBytes += memoryRequirements.size;
+		block.allocatedBytes += allocation.allocatedSize;
+		allocation.deviceMemory = block.deviceMemory;
+		allocation.blockIndex = blockIndex;
+		allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+		return true;
+	};
+
+	for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+		if (pool.blocks[i] && tryBlock(*pool.blocks[i], i)) {
+			return allocation;
+		}
+	}
+
+	std::unique_ptr<MemoryBlock> block = createBlock(allocation.memoryTypeIndex, blockSize, strategy);
+	uint32_t blockIndex;
+	auto freeSlot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+	if (freeSlot != pool.blocks.end()) {
+		*freeSlot = std::move(block);
+		blockIndex = static_cast<uint32_t>(freeSlot - pool.blocks.begin());
+	} else {
+		pool.blocks.push_back(std::move(block));
+		blockIndex = static_cast<uint32_t>(pool.blocks.size() - 1);
+	}
+
+	if (!tryBlock(*pool.blocks[blockIndex], blockIndex)) {
+		throw std::runtime_error("MemoryAllocator failed to allocate " + std::to_string(size) + " bytes from a fresh block");
+	}
+	return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+	if (!allocation.deviceMemory) {
+		return;
+	}
+
+	if (allocation.dedicated) {
+		destroyBlock(*_dedicatedBlocks[allocation.blockIndex]);
+		_dedicatedBlocks[allocation.blockIndex].reset();
+		allocation = Allocation();
+		return;
+	}
+
+	MemoryPool& pool = _pools[allocation.memoryTypeIndex];
+	MemoryBlock& block = *pool.blocks[allocation.blockIndex];
+
+	if (block.strategy == AllocationStrategy::eBuddy) {
+		freeBuddy(block, allocation.offset, allocation.allocatedSize);
+	}
+	block.liveAllocations--;
+	block.requestedBytes -= allocation.size;
+	block.allocatedBytes -= allocation.allocatedSize;
+
+	if (block.liveAllocations == 0) {
+		//linear blocks rewind once everything in them is released
+		block.head = 0;
+
+		//give empty blocks back to the driver, but keep one per strategy around to avoid churn
+		bool otherEmptyBlock = false;
+		for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+			if (i != allocation.blockIndex && pool.blocks[i] && pool.blocks[i]->strategy == block.strategy && pool.blocks[i]->liveAllocations == 0) {
+				otherEmptyBlock = true;
+				break;
+			}
+		}
+		if (otherEmptyBlock) {
+			destroyBlock(block);
+			pool.blocks[allocation.blockIndex].reset();
+		}
+	}
+	allocation = Allocation();
+}
+
+AllocatorStats MemoryAllocator::getStats() const {
+	AllocatorStats stats;
+	stats.deviceMemoryCount = _deviceMemoryCount;
+
+	auto accumulate = [&stats](const MemoryBlock& block) {
+		stats.allocationCount += block.liveAllocations;
+		stats.reservedBytes += block.size;
+		stats.requestedBytes += block.requestedBytes;
+		stats.allocatedBytes += block.allocatedBytes;
+	};
+
+	for (const MemoryPool& pool : _pools) {
+		for (const std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+			if (!block) {
+				continue;
+			}
+			accumulate(*block);
+
+			if (block->strategy == AllocationStrategy::eBuddy) {
+				for (uint32_t order = 0; order < block->freeLists.size(); order++) {
+					vk::DeviceSize nodeSize = MIN_BUDDY_SIZE << order;
+					stats.freeBytes += nodeSize * block->freeLists[order].size();
+					if (!block->freeLists[order].empty()) {
+						stats.largestFreeRange = std::max(stats.largestFreeRange, nodeSize);
+					}
+				}
+			} else {
+				vk::DeviceSize tail = block->size - block->head;
+				stats.freeBytes += tail;
+				stats.largestFreeRange = std::max(stats.largestFreeRange, tail);
+			}
+		}
+	}
+	for (const std::unique_ptr<MemoryBlock>& block : _dedicatedBlocks) {
+		if (block) {
+			accumulate(*block);
+		}
+	}
+	return stats;
+}
+
+void MemoryAllocator::printStats(std::ostream& out) const {
+	AllocatorStats stats = getStats();
+	out << "Memory Allocator:" << std::endl;
+	out << "deviceMemoryCount: " << stats.deviceMemoryCount << " / " << _maxMemoryAllocationCount << std::endl;
+	out << "allocationCount: " << stats.allocationCount << std::endl;
+	out << "reservedBytes: " << stats.reservedBytes << std::endl;
+	out << "requestedBytes: " << stats.requestedBytes << std::endl;
+	out << "allocatedBytes: " << stats.allocatedBytes << std::endl;
+	out << "freeBytes: " << stats.freeBytes << " (largest range " << stats.largestFreeRange << ")" << std::endl;
+	out << "internalFragmentation: " << stats.internalFragmentation() << std::endl;
+	out << "externalFragmentation: " << stats.externalFragmentation() << std::endl;
+	out << std::endl;
+}
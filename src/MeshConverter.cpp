@@ -0,0 +1,521 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../include/MeshFile.hpp"
+#include "../include/MeshOptimizer.hpp"
+#include "../include/MeshletBuilder.hpp"
+#include "../include/VertexLayout.hpp"
+
+// Offline converter to the binary .mesh format: one mesh per OBJ file, or a synthetic scene
+// of tessellated grids for load time benchmarks. --position/--color/--normal pick the vertex
+// layout of every mesh that follows them on the command line, --optimize off keeps their
+// triangle and vertex order, --lods sets how many simplified LODs follow the full mesh in its index
+// buffer. Indices are stored as 16 bit whenever the vertex count allows, LOD 0 of every mesh is
+// split into meshlets for cluster culling.
+struct MeshData {
+	std::vector<float> positions;	// xyz per vertex
+	std::vector<float> colors;	// rgb
+	std::vector<float> normals;	// xyz, unit length
+	std::vector<uint32_t> indices;	// every LOD, LOD 0 first
+	std::vector<MeshLod> lods;	// empty until buildLods()
+
+	uint32_t vertexCount() const { return static_cast<uint32_t>(positions.size() / 3); }
+	VertexStreams streams() const { return { positions.data(), colors.data(), normals.data(), vertexCount() }; }
+};
+
+const uint32_t DEFAULT_LOD_COUNT = 4;
+const float LOD_REDUCTION = 0.5f;	// every LOD aims at this fraction of the triangles of the one before
+const float LOD_MIN_REDUCTION = 0.85f;	// the chain ends once simplification keeps more than this fraction
+const float LOD_MAX_ERROR = 0.1f;	// relative to the mesh's bounding box half diagonal
+
+struct EncodedMesh {
+	VertexLayout layout;
+	PositionDecode decode;
+	std::vector<uint8_t> vertices;
+	std::vector<uint8_t> indices;
+	uint32_t indexSize = 4;
+	std::vector<MeshletRecord> meshlets;
+	VertexEncodingError error;
+	double encodeMs = 0.0;
+};
+
+struct OptimizationResult {
+	bool optimized = false;
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+	uint32_t droppedVertices = 0;
+	double optimizeMs = 0.0;
+};
+
+struct LodResult {
+	double simplifyMs = 0.0;
+};
+
+struct Input {
+	std::string path;	// empty for the synthetic grids
+	VertexLayout layout;
+	bool optimize = true;
+	uint32_t lodCount = DEFAULT_LOD_COUNT;
+};
+
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+	return std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// Area weighted face normals summed per vertex, unless the OBJ brought its own
+static void computeNormals(MeshData& mesh) {
+	mesh.normals.assign(mesh.positions.size(), 0.0f);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		const float* a = &mesh.positions[mesh.indices[i] * 3];
+		const float* b = &mesh.positions[mesh.indices[i + 1] * 3];
+		const float* c = &mesh.positions[mesh.indices[i + 2] * 3];
+		float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		for (size_t corner = 0; corner < 3; corner++) {
+			for (int axis = 0; axis < 3; axis++) {
+				mesh.normals[mesh.indices[i + corner] * 3 + axis] += normal[axis];
+			}
+		}
+	}
+}
+
+static void normalizeNormals(MeshData& mesh) {
+	for (size_t i = 0; i < mesh.normals.size(); i += 3) {
+		float* normal = &mesh.normals[i];
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0.0f) {
+			normal[0] /= length;
+			normal[1] /= length;
+			normal[2] /= length;
+		} else {
+			normal[0] = 0.0f;
+			normal[1] = 0.0f;
+			normal[2] = 1.0f;
+		}
+	}
+}
+
+// Positions and optional per vertex colours ("v x y z r g b"), polygons are fanned into triangles.
+// Vertices are the OBJ positions as they are, normals referenced by faces are averaged per position
+// and texture coordinates are ignored.
+static MeshData loadObj(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + path);
+	}
+
+	MeshData mesh;
+	std::vector<float> objNormals;
+	bool hasColors = false, hasNormals = false;
+	std::string line;
+	std::vector<uint32_t> polygon;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+		if (keyword == "v") {
+			float position[3] = {}, color[3] = { 1.0f, 1.0f, 1.0f };
+			stream >> position[0] >> position[1] >> position[2];
+			if (stream >> color[0] >> color[1] >> color[2]) {
+				hasColors = true;
+			}
+			mesh.positions.insert(mesh.positions.end(), position, position + 3);
+			mesh.colors.insert(mesh.colors.end(), color, color + 3);
+			mesh.normals.insert(mesh.normals.end(), { 0.0f, 0.0f, 0.0f });
+		} else if (keyword == "vn") {
+			float normal[3] = {};
+			stream >> normal[0] >> normal[1] >> normal[2];
+			objNormals.insert(objNormals.end(), normal, normal + 3);
+		} else if (keyword == "f") {
+			polygon.clear();
+			std::string corner;
+			while (stream >> corner) {
+				//"v", "v/vt", "v//vn" or "v/vt/vn", negative indices count back from the last element
+				long index = std::stol(corner.substr(0, corner.find('/')));
+				long vertexCount = static_cast<long>(mesh.vertexCount());
+				index = index < 0 ? vertexCount + index : index - 1;
+				if (index < 0 || index >= vertexCount) {
+					throw std::runtime_error(path + ": face references a missing vertex");
+				}
+				polygon.push_back(static_cast<uint32_t>(index));
+
+				size_t normalSlash = corner.rfind('/');
+				if (std::count(corner.begin(), corner.end(), '/') == 2 && normalSlash + 1 < corner.size()) {
+					long normalIndex = std::stol(corner.substr(normalSlash + 1));
+					long normalCount = static_cast<long>(objNormals.size() / 3);
+					normalIndex = normalIndex < 0 ? normalCount + normalIndex : normalIndex - 1;
+					if (normalIndex < 0 || normalIndex >= normalCount) {
+						throw std::runtime_error(path + ": face references a missing normal");
+					}
+					for (int axis = 0; axis < 3; axis++) {
+						mesh.normals[index * 3 + axis] += objNormals[normalIndex * 3 + axis];
+					}
+					hasNormals = true;
+				}
+			}
+			for (size_t i = 2; i < polygon.size(); i++) {
+				mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+			}
+		}
+	}
+	if (mesh.indices.empty()) {
+		throw std::runtime_error(path + ": no triangles");
+	}
+
+	if (!hasNormals) {
+		computeNormals(mesh);
+	}
+	normalizeNormals(mesh);
+
+	//without colours the position inside the bounding box is used, so the shape stays readable
+	if (!hasColors && mesh.vertexCount() > 0) {
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t i = 0; i < mesh.positions.size(); i++) {
+			minimum[i % 3] = std::min(minimum[i % 3], mesh.positions[i]);
+			maximum[i % 3] = std::max(maximum[i % 3], mesh.positions[i]);
+		}
+		for (size_t i = 0; i < mesh.positions.size(); i++) {
+			float extent = maximum[i % 3] - minimum[i % 3];
+			mesh.colors[i] = extent > 0.0f ? 0.25f + 0.75f * (mesh.positions[i] - minimum[i % 3]) / extent : 1.0f;
+		}
+	}
+	return mesh;
+}
+
+// size x size quads in the z = 0 plane, one unit across like the built-in quad
+static MeshData createGrid(uint32_t size) {
+	MeshData mesh;
+	for (uint32_t y = 0; y <= size; y++) {
+		for (uint32_t x = 0; x <= size; x++) {
+			float u = static_cast<float>(x) / size, v = static_cast<float>(y) / size;
+			mesh.positions.insert(mesh.positions.end(), { u - 0.5f, v - 0.5f, 0.0f });
+			mesh.colors.insert(mesh.colors.end(), { u, v, 1.0f - 0.5f * (u + v) });
+			mesh.normals.insert(mesh.normals.end(), { 0.0f, 0.0f, 1.0f });
+		}
+	}
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			uint32_t corner = y * (size + 1) + x;
+			mesh.indices.insert(mesh.indices.end(), { corner, corner + 1, corner + size + 2, corner + size + 2, corner + size + 1, corner });
+		}
+	}
+	return mesh;
+}
+
+// Vertex cache order, then overdraw order within the cache budget, then vertices in first use order
+static OptimizationResult optimize(MeshData& mesh, bool enabled) {
+	OptimizationResult result;
+	result.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+	if (!enabled) {
+		result.after = result.before;
+		return result;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<uint32_t> cacheOrder(mesh.indices.size());
+	optimizeVertexCache(cacheOrder.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+	optimizeOverdraw(mesh.indices.data(), cacheOrder.data(), cacheOrder.size(), mesh.positions.data(), mesh.vertexCount());
+
+	std::vector<uint32_t> remap;
+	uint32_t vertexCount = mesh.vertexCount();
+	uint32_t keptVertexCount = optimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), vertexCount, remap);
+	remapVertexStream(mesh.positions, 3, remap, keptVertexCount);
+	remapVertexStream(mesh.colors, 3, remap, keptVertexCount);
+	remapVertexStream(mesh.normals, 3, remap, keptVertexCount);
+	result.optimizeMs = millisecondsSince(startTime);
+
+	result.optimized = true;
+	result.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+	result.droppedVertices = vertexCount - keptVertexCount;
+	return result;
+}
+
+// Simplified copies of LOD 0 appended to the index buffer, each simplified from LOD 0 so its error is
+// measured against the full mesh, then put in vertex cache order. The vertex order stays LOD 0's.
+static LodResult buildLods(MeshData& mesh, uint32_t lodCount) {
+	LodResult result;
+	MeshLod fullLod;
+	fullLod.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	mesh.lods = { fullLod };
+
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < mesh.positions.size(); i++) {
+		minimum[i % 3] = std::min(minimum[i % 3], mesh.positions[i]);
+		maximum[i % 3] = std::max(maximum[i % 3], mesh.positions[i]);
+	}
+	float halfDiagonal = mesh.positions.empty() ? 0.0f : 0.5f * std::sqrt((maximum[0] - minimum[0]) * (maximum[0] - minimum[0]) + (maximum[1] - minimum[1]) * (maximum[1] - minimum[1]) + (maximum[2] - minimum[2]) * (maximum[2] - minimum[2]));
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<uint32_t> simplified(fullLod.indexCount), cacheOrder(fullLod.indexCount);
+	while (mesh.lods.size() < lodCount) {
+		const MeshLod& previous = mesh.lods.back();
+		size_t target = static_cast<size_t>(previous.indexCount / 3 * LOD_REDUCTION) * 3;
+		float error = 0.0f;
+		size_t indexCount = simplifyMesh(simplified.data(), mesh.indices.data(), fullLod.indexCount, mesh.positions.data(), mesh.vertexCount(), target, LOD_MAX_ERROR * halfDiagonal, &error);
+		if (indexCount == 0 || indexCount > previous.indexCount * LOD_MIN_REDUCTION) {
+			break;
+		}
+
+		optimizeVertexCache(cacheOrder.data(), simplified.data(), indexCount, mesh.vertexCount());
+		MeshLod lod;
+		lod.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+		lod.indexCount = static_cast<uint32_t>(indexCount);
+		lod.error = std::max(error, previous.error);
+		mesh.indices.insert(mesh.indices.end(), cacheOrder.begin(), cacheOrder.begin() + indexCount);
+		mesh.lods.push_back(lod);
+	}
+	result.simplifyMs = millisecondsSince(startTime);
+	return result;
+}
+
+static EncodedMesh encode(const MeshData& mesh, const VertexLayout& layout) {
+	EncodedMesh encoded;
+	encoded.layout = layout;
+	encoded.decode = computePositionDecode(layout, mesh.streams());
+	encoded.vertices.resize(static_cast<size_t>(mesh.vertexCount()) * layout.stride());
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	encodeVertices(layout, mesh.streams(), encoded.decode, encoded.vertices.data());
+	encoded.encodeMs = millisecondsSince(startTime);
+	encoded.error = measureEncodingError(layout, mesh.streams(), encoded.decode, encoded.vertices.data());
+
+	//primitive restart is off, so all 65536 values of a 16 bit index are usable
+	encoded.indexSize = mesh.vertexCount() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+	encoded.indices.resize(mesh.indices.size() * encoded.indexSize);
+	if (encoded.indexSize == sizeof(uint16_t)) {
+		uint16_t* shortIndices = reinterpret_cast<uint16_t*>(encoded.indices.data());
+		for (size_t i = 0; i < mesh.indices.size(); i++) {
+			shortIndices[i] = static_cast<uint16_t>(mesh.indices[i]);
+		}
+	} else {
+		memcpy(encoded.indices.data(), mesh.indices.data(), encoded.indices.size());
+	}
+
+	//bounds grow by the encoding error, like the mesh's own
+	size_t fullIndexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+	encoded.meshlets = buildMeshlets(mesh.indices.data(), fullIndexCount, mesh.positions.data(), mesh.vertexCount(), encoded.error.maxPosition);
+	return encoded;
+}
+
+static MeshSource describe(const MeshData& mesh, const EncodedMesh& encoded) {
+	MeshSource source;
+	source.vertices = encoded.vertices.data();
+	source.vertexCount = mesh.vertexCount();
+	source.vertexStride = encoded.layout.stride();
+	source.vertexLayout = encoded.layout.key();
+	memcpy(source.positionDecode, encoded.decode.offset, sizeof(encoded.decode.offset));
+	source.positionDecode[3] = encoded.decode.scale;
+	source.indices = encoded.indices.data();
+	source.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	source.indexSize = encoded.indexSize;
+	source.lods = mesh.lods;
+	source.meshlets = encoded.meshlets;
+
+	//bounds of the source positions, so they do not depend on the encoding
+	//sphere around the box center, not minimal but tight enough for culling
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < mesh.positions.size(); i++) {
+		minimum[i % 3] = std::min(minimum[i % 3], mesh.positions[i]);
+		maximum[i % 3] = std::max(maximum[i % 3], mesh.positions[i]);
+	}
+	for (int axis = 0; axis < 3; axis++) {
+		source.aabbMin[axis] = mesh.positions.empty() ? 0.0f : minimum[axis];
+		source.aabbMax[axis] = mesh.positions.empty() ? 0.0f : maximum[axis];
+		source.boundingSphere[axis] = 0.5f * (source.aabbMin[axis] + source.aabbMax[axis]);
+	}
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < mesh.positions.size(); i += 3) {
+		float dx = mesh.positions[i] - source.boundingSphere[0], dy = mesh.positions[i + 1] - source.boundingSphere[1], dz = mesh.positions[i + 2] - source.boundingSphere[2];
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	//the decoded positions may land up to the encoding error outside the source bounds
+	source.boundingSphere[3] = std::sqrt(radiusSquared) + encoded.error.maxPosition;
+	return source;
+}
+
+// Float positions and colours (plus float normals when the layout has any) for comparison
+static uint32_t uncompressedStride(const VertexLayout& layout) {
+	return layout.normal == NormalEncoding::eNone ? 24 : 36;
+}
+
+static void report(const std::string& name, const MeshData& mesh, const OptimizationResult& optimization, const LodResult& lodResult, const EncodedMesh& encoded) {
+	uint32_t stride = encoded.layout.stride(), floatStride = uncompressedStride(encoded.layout);
+	size_t triangleCount = (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+	std::cout << std::format("{}: {} vertices, {} triangles, {} {} -> {} bytes per vertex ({:.0f}% smaller)", name, mesh.vertexCount(), triangleCount,
+		encoded.layout.name(), floatStride, stride, 100.0 * (1.0 - static_cast<double>(stride) / floatStride)) << std::endl;
+	std::cout << std::format("  position error max {:.6f} rms {:.6f}", encoded.error.maxPosition, encoded.error.rmsPosition);
+	if (encoded.layout.position != PositionEncoding::eFloat32) {
+		std::cout << std::format(" (decode scale {:.3f})", encoded.decode.scale);
+	}
+	std::cout << std::format(", colour max {:.5f}", encoded.error.maxColor);
+	if (encoded.layout.normal != NormalEncoding::eNone) {
+		std::cout << std::format(", normal max {:.3f} degrees", encoded.error.maxNormalDegrees);
+	}
+	if (encoded.encodeMs > 0.0) {
+		std::cout << std::format(", encoded at {:.1f} M vertices/s", mesh.vertexCount() / encoded.encodeMs / 1000.0);
+	}
+	std::cout << std::endl;
+
+	//ACMR = transformed vertices per triangle, ATVR = transformed vertices per vertex, for a FIFO cache
+	std::cout << std::format("  {} bit indices, vertex cache ({} entries) ACMR {:.3f}", encoded.indexSize * 8, VERTEX_CACHE_SIZE, optimization.before.acmr);
+	if (optimization.optimized) {
+		std::cout << std::format(" -> {:.3f}, ATVR {:.3f} -> {:.3f}", optimization.after.acmr, optimization.before.atvr, optimization.after.atvr);
+		if (optimization.droppedVertices > 0) {
+			std::cout << std::format(", {} unused vertices dropped", optimization.droppedVertices);
+		}
+		std::cout << std::format(", optimized in {:.1f} ms", optimization.optimizeMs);
+	} else {
+		std::cout << std::format(", ATVR {:.3f}, not optimized", optimization.before.atvr);
+	}
+	std::cout << std::endl;
+
+	if (!encoded.meshlets.empty()) {
+		uint64_t meshletVertices = 0;
+		size_t coneCount = 0;
+		for (const MeshletRecord& meshlet : encoded.meshlets) {
+			meshletVertices += meshlet.vertexCount;
+			coneCount += meshlet.coneCutoff < 1.0f;
+		}
+		double meshletCount = static_cast<double>(encoded.meshlets.size());
+		std::cout << std::format("  {} meshlets, {:.1f} vertices and {:.1f} triangles on average, {:.0f}% can be backface culled", encoded.meshlets.size(),
+			meshletVertices / meshletCount, triangleCount / meshletCount, 100.0 * coneCount / meshletCount) << std::endl;
+	}
+
+	if (mesh.lods.size() > 1) {
+		std::cout << std::format("  {} LODs, triangles (error)", mesh.lods.size());
+		for (const MeshLod& lod : mesh.lods) {
+			std::cout << std::format(" {} ({:.5f})", lod.indexCount / 3, lod.error);
+		}
+		std::cout << std::format(", simplified in {:.1f} ms", lodResult.simplifyMs) << std::endl;
+	}
+}
+
+const std::pair<const char*, PositionEncoding> POSITION_OPTIONS[] = { { "float", PositionEncoding::eFloat32 }, { "half", PositionEncoding::eHalf }, { "snorm16", PositionEncoding::eSnorm16 } };
+const std::pair<const char*, ColorEncoding> COLOR_OPTIONS[] = { { "float", ColorEncoding::eFloat32 }, { "unorm8", ColorEncoding::eUnorm8 }, { "unorm10", ColorEncoding::eUnorm10 } };
+const std::pair<const char*, NormalEncoding> NORMAL_OPTIONS[] = { { "none", NormalEncoding::eNone }, { "oct16", NormalEncoding::eOctahedral16 }, { "oct8", NormalEncoding::eOctahedral8 } };
+
+template<typename T, size_t N>
+static bool parseEncoding(const std::string& value, const std::pair<const char*, T> (&options)[N], T& encoding) {
+	for (const auto& [name, option] : options) {
+		if (value == name) {
+			encoding = option;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool parseLayoutOption(const std::string& option, const std::string& value, VertexLayout& layout) {
+	if (option == "--position") {
+		return parseEncoding(value, POSITION_OPTIONS, layout.position);
+	} else if (option == "--color") {
+		return parseEncoding(value, COLOR_OPTIONS, layout.color);
+	} else if (option == "--normal") {
+		return parseEncoding(value, NORMAL_OPTIONS, layout.normal);
+	}
+	return false;
+}
+
+int main(int argc, char* argv[]) {
+	std::string outputPath;
+	std::vector<Input> inputs;
+	VertexLayout layout;
+	bool optimizeInputs = true;
+	uint32_t lodCount = DEFAULT_LOD_COUNT;
+	Input syntheticInput;
+	uint32_t syntheticMeshCount = 0;
+	uint32_t syntheticGridSize = 0;
+	bool validArguments = true;
+
+	for (int i = 1; i < argc && validArguments; i++) {
+		std::string arg = argv[i];
+		if (arg == "--synthetic" && i + 2 < argc) {
+			syntheticMeshCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			syntheticGridSize = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+			syntheticInput.layout = layout;
+			syntheticInput.optimize = optimizeInputs;
+			syntheticInput.lodCount = lodCount;
+		} else if (arg == "--optimize" && i + 1 < argc) {
+			std::string value = argv[++i];
+			optimizeInputs = value == "on";
+			validArguments = value == "on" || value == "off";
+		} else if (arg == "--lods" && i + 1 < argc) {
+			lodCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			validArguments = lodCount >= 1 && lodCount <= MAX_MESH_LODS;
+		} else if (arg.starts_with("--")) {
+			validArguments = i + 1 < argc && parseLayoutOption(arg, argv[++i], layout);
+		} else if (outputPath.empty()) {
+			outputPath = arg;
+		} else {
+			inputs.push_back({ arg, layout, optimizeInputs, lodCount });
+		}
+	}
+	if (!validArguments || outputPath.empty() || (inputs.empty() && syntheticMeshCount == 0)) {
+		std::cout << "usage: " << argv[0] << " output.mesh [layout options] [input.obj ...] [--synthetic MESHES GRID_SIZE]" << std::endl;
+		std::cout << "  --position float|half|snorm16, --color float|unorm8|unorm10, --normal none|oct16|oct8" << std::endl;
+		std::cout << "  --optimize on|off, vertex cache, overdraw and vertex fetch order, on by default" << std::endl;
+		std::cout << std::format("  --lods 1-{}, LOD 0 plus simplified LODs at about half the triangles each, {} by default", MAX_MESH_LODS, DEFAULT_LOD_COUNT) << std::endl;
+		std::cout << "    apply to the inputs after them, the default is float/float/none" << std::endl;
+		std::cout << "  --synthetic writes MESHES grids of GRID_SIZE x GRID_SIZE quads, e.g. 1000 1024 for a ~50 GB file" << std::endl;
+		return 1;
+	}
+
+	try {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		MeshFileWriter writer;
+		writer.open(outputPath);
+		uint64_t vertexBytes = 0, floatVertexBytes = 0, indexBytes = 0, wideIndexBytes = 0;
+
+		for (const Input& input : inputs) {
+			MeshData mesh = loadObj(input.path);
+			OptimizationResult optimization = optimize(mesh, input.optimize);
+			LodResult lodResult = buildLods(mesh, input.lodCount);
+			EncodedMesh encoded = encode(mesh, input.layout);
+			writer.addMesh(describe(mesh, encoded));
+			report(input.path, mesh, optimization, lodResult, encoded);
+			vertexBytes += encoded.vertices.size();
+			floatVertexBytes += static_cast<uint64_t>(mesh.vertexCount()) * uncompressedStride(input.layout);
+			indexBytes += encoded.indices.size();
+			wideIndexBytes += mesh.indices.size() * sizeof(uint32_t);
+		}
+
+		//the same grid every time, only the file size matters for load benchmarks
+		if (syntheticMeshCount > 0) {
+			MeshData grid = createGrid(syntheticGridSize);
+			OptimizationResult optimization = optimize(grid, syntheticInput.optimize);
+			LodResult lodResult = buildLods(grid, syntheticInput.lodCount);
+			EncodedMesh encoded = encode(grid, syntheticInput.layout);
+			MeshSource source = describe(grid, encoded);
+			for (uint32_t i = 0; i < syntheticMeshCount; i++) {
+				writer.addMesh(source);
+			}
+			report(std::format("{} synthetic meshes", syntheticMeshCount), grid, optimization, lodResult, encoded);
+			vertexBytes += encoded.vertices.size() * syntheticMeshCount;
+			floatVertexBytes += static_cast<uint64_t>(grid.vertexCount()) * uncompressedStride(syntheticInput.layout) * syntheticMeshCount;
+			indexBytes += encoded.indices.size() * syntheticMeshCount;
+			wideIndexBytes += grid.indices.size() * sizeof(uint32_t) * syntheticMeshCount;
+		}
+
+		writer.close();
+		double megabyte = 1024.0 * 1024.0;
+		std::cout << std::format("Vertex data {:.1f} MB, {:.1f} MB as floats ({:.0f}% saved)", vertexBytes / megabyte, floatVertexBytes / megabyte,
+			floatVertexBytes > 0 ? 100.0 * (1.0 - static_cast<double>(vertexBytes) / floatVertexBytes) : 0.0) << std::endl;
+		std::cout << std::format("Index data {:.1f} MB, {:.1f} MB as 32 bit", indexBytes / megabyte, wideIndexBytes / megabyte) << std::endl;
+		std::cout << "Wrote " << outputPath << ": " << writer.bytesWritten() / megabyte << " MB in " << millisecondsSince(startTime) << " ms" << std::endl;
+	} catch (std::exception& err) {
+		std::cout << "std::Exception: " << err.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,243 @@
+#include "../include/MeshFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void MeshFile::open(const std::string& path) {
+	_path = path;
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error(std::format("Failed to open mesh file {}: error {}", path, GetLastError()));
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	_fileHandle = fileHandle;
+	_size = static_cast<uint64_t>(fileSize.QuadPart);
+
+	HANDLE mappingHandle = _size > 0 ? CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	if (mappingHandle) {
+		_mappingHandle = mappingHandle;
+		_data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	_fileDescriptor = ::open(path.c_str(), O_RDONLY);
+	if (_fileDescriptor < 0) {
+		throw std::runtime_error(std::format("Failed to open mesh file {}: {}", path, strerror(errno)));
+	}
+	struct stat fileStat;
+	fstat(_fileDescriptor, &fileStat);
+	_size = static_cast<uint64_t>(fileStat.st_size);
+
+	void* mapping = _size > 0 ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fileDescriptor, 0) : MAP_FAILED;
+	if (mapping != MAP_FAILED) {
+		//the blobs are read front to back exactly once on their way into staging memory
+		madvise(mapping, _size, MADV_SEQUENTIAL);
+		_data = static_cast<const uint8_t*>(mapping);
+	}
+#endif
+
+	if (!_data) {
+		close();
+		throw std::runtime_error(std::format("Failed to map mesh file {}", path));
+	}
+
+	try {
+		validate();
+	} catch (...) {
+		close();
+		throw;
+	}
+}
+
+void MeshFile::close() {
+#ifdef _WIN32
+	if (_data) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mappingHandle) {
+		CloseHandle(_mappingHandle);
+	}
+	if (_fileHandle) {
+		CloseHandle(_fileHandle);
+	}
+	_mappingHandle = nullptr;
+	_fileHandle = nullptr;
+#else
+	if (_data) {
+		munmap(const_cast<uint8_t*>(_data), _size);
+	}
+	if (_fileDescriptor >= 0) {
+		::close(_fileDescriptor);
+	}
+	_fileDescriptor = -1;
+#endif
+	_data = nullptr;
+	_size = 0;
+}
+
+void MeshFile::validate() const {
+	//everything is checked against the file size once, so accessors never need to
+	auto inFile = [&](uint64_t offset, uint64_t size) {
+		return offset <= _size && size <= _size - offset;
+	};
+
+	if (_size < sizeof(MeshFileHeader) || header().magic != MESH_FILE_MAGIC) {
+		throw std::runtime_error(std::format("{} is not a mesh file", _path));
+	}
+	if (header().version != MESH_FILE_VERSION) {
+		throw std::runtime_error(std::format("{}: unsupported mesh file version {}, expected {}", _path, header().version, MESH_FILE_VERSION));
+	}
+	if (header().meshTableOffset % alignof(MeshRecord) != 0 || !inFile(header().meshTableOffset, static_cast<uint64_t>(header().meshCount) * sizeof(MeshRecord))) {
+		throw std::runtime_error(std::format("{}: mesh table out of bounds", _path));
+	}
+
+	uint64_t vertexDataSize = 0, indexDataSize = 0, meshletDataSize = 0;
+	for (uint32_t i = 0; i < meshCount(); i++) {
+		const MeshRecord& record = mesh(i);
+		uint64_t vertexBytes = static_cast<uint64_t>(record.vertexCount) * record.vertexStride;
+		uint64_t indexBytes = static_cast<uint64_t>(record.indexCount) * record.indexSize;
+		uint64_t meshletBytes = static_cast<uint64_t>(record.meshletCount) * sizeof(MeshletRecord);
+		if (record.vertexStride == 0 || (record.indexSize != 2 && record.indexSize != 4)) {
+			throw std::runtime_error(std::format("{}: mesh {} has an invalid vertex stride {} or index size {}", _path, i, record.vertexStride, record.indexSize));
+		}
+		if (record.vertexCount == 0 || record.indexCount == 0) {
+			throw std::runtime_error(std::format("{}: mesh {} is empty, {} vertices and {} indices", _path, i, record.vertexCount, record.indexCount));
+		}
+		if (!inFile(record.vertexOffset, vertexBytes) || !inFile(record.indexOffset, indexBytes) || record.meshletOffset % alignof(MeshletRecord) != 0 || !inFile(record.meshletOffset, meshletBytes)) {
+			throw std::runtime_error(std::format("{}: mesh {} data out of bounds", _path, i));
+		}
+		//an index past the mesh's vertices would read another mesh's vertices or past the buffer
+		for (uint32_t index = 0; index < record.indexCount; index++) {
+			uint32_t vertex = 0;
+			memcpy(&vertex, _data + record.indexOffset + static_cast<uint64_t>(index) * record.indexSize, record.indexSize);
+			if (vertex >= record.vertexCount) {
+				throw std::runtime_error(std::format("{}: mesh {} index {} references vertex {} of {}", _path, i, index, vertex, record.vertexCount));
+			}
+		}
+		if (record.lodCount == 0 || record.lodCount > MAX_MESH_LODS) {
+			throw std::runtime_error(std::format("{}: mesh {} has {} LODs, expected 1 to {}", _path, i, record.lodCount, MAX_MESH_LODS));
+		}
+		for (uint32_t lod = 0; lod < record.lodCount; lod++) {
+			if (static_cast<uint64_t>(record.lods[lod].firstIndex) + record.lods[lod].indexCount > record.indexCount) {
+				throw std::runtime_error(std::format("{}: mesh {} LOD {} exceeds its index range", _path, i, lod));
+			}
+		}
+		const MeshletRecord* meshletRecords = meshlets(i);
+		for (uint32_t meshlet = 0; meshlet < record.meshletCount; meshlet++) {
+			const MeshletRecord& meshletRecord = meshletRecords[meshlet];
+			if (meshletRecord.firstIndex < record.lods[0].firstIndex || static_cast<uint64_t>(meshletRecord.firstIndex) + meshletRecord.indexCount > static_cast<uint64_t>(record.lods[0].firstIndex) + record.lods[0].indexCount) {
+				throw std::runtime_error(std::format("{}: mesh {} meshlet {} exceeds LOD 0", _path, i, meshlet));
+			}
+		}
+		vertexDataSize += vertexBytes;
+		indexDataSize += indexBytes;
+		meshletDataSize += meshletBytes;
+	}
+	if (vertexDataSize != header().vertexDataSize || indexDataSize != header().indexDataSize || meshletDataSize != header().meshletDataSize) {
+		throw std::runtime_error(std::format("{}: header data sizes do not match the mesh table", _path));
+	}
+}
+
+void MeshFileWriter::open(const std::string& path) {
+	_path = path;
+	_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!_file.is_open()) {
+		throw std::runtime_error("Failed to create mesh file " + path);
+	}
+	_offset = 0;
+	_header = MeshFileHeader();
+	_records.clear();
+
+	//placeholder, close() writes the real header once the table offset is known
+	write(&_header, sizeof(_header));
+}
+
+void MeshFileWriter::addMesh(const MeshSource& source) {
+	if (source.indexSize != 2 && source.indexSize != 4) {
+		throw std::runtime_error(std::format("Mesh index size must be 2 or 4 bytes, got {}", source.indexSize));
+	}
+	if (source.lods.size() > MAX_MESH_LODS) {
+		throw std::runtime_error(std::format("Mesh has {} LODs, at most {} are supported", source.lods.size(), MAX_MESH_LODS));
+	}
+
+	MeshRecord record;
+	memcpy(record.boundingSphere, source.boundingSphere, sizeof(record.boundingSphere));
+	memcpy(record.aabbMin, source.aabbMin, sizeof(source.aabbMin));
+	memcpy(record.aabbMax, source.aabbMax, sizeof(source.aabbMax));
+	record.vertexCount = source.vertexCount;
+	record.vertexStride = source.vertexStride;
+	record.vertexLayout = source.vertexLayout;
+	memcpy(record.positionDecode, source.positionDecode, sizeof(record.positionDecode));
+	record.indexCount = source.indexCount;
+	record.indexSize = source.indexSize;
+	if (source.lods.empty()) {
+		record.lodCount = 1;
+		record.lods[0].indexCount = source.indexCount;
+	} else {
+		record.lodCount = static_cast<uint32_t>(source.lods.size());
+		std::copy(source.lods.begin(), source.lods.end(), record.lods);
+	}
+
+	uint64_t vertexBytes = static_cast<uint64_t>(source.vertexCount) * source.vertexStride;
+	uint64_t indexBytes = static_cast<uint64_t>(source.indexCount) * source.indexSize;
+	uint64_t meshletBytes = source.meshlets.size() * sizeof(MeshletRecord);
+	record.meshletCount = static_cast<uint32_t>(source.meshlets.size());
+
+	align();
+	record.vertexOffset = _offset;
+	write(source.vertices, vertexBytes);
+	align();
+	record.indexOffset = _offset;
+	write(source.indices, indexBytes);
+	align();
+	record.meshletOffset = _offset;
+	write(source.meshlets.data(), meshletBytes);
+
+	_header.vertexDataSize += vertexBytes;
+	_header.indexDataSize += indexBytes;
+	_header.meshletDataSize += meshletBytes;
+	_records.push_back(record);
+}
+
+void MeshFileWriter::close() {
+	align();
+	_header.meshCount = static_cast<uint32_t>(_records.size());
+	_header.meshTableOffset = _offset;
+	write(_records.data(), _records.size() * sizeof(MeshRecord));
+
+	_file.seekp(0);
+	_file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+	_file.close();
+	if (_file.fail()) {
+		throw std::runtime_error("Failed to write mesh file " + _path);
+	}
+}
+
+void MeshFileWriter::write(const void* data, uint64_t size) {
+	_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	if (_file.fail()) {
+		throw std::runtime_error("Failed to write mesh file " + _path);
+	}
+	_offset += size;
+}
+
+void MeshFileWriter::align() {
+	static const char zeros[MESH_BLOB_ALIGNMENT] = {};
+	uint64_t padding = (MESH_BLOB_ALIGNMENT - _offset % MESH_BLOB_ALIGNMENT) % MESH_BLOB_ALIGNMENT;
+	write(zeros, padding);
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../include/MeshFile.hpp"
+
+// Load time of a .mesh file into a staging-ring-sized buffer, memory mapped (what the engine
+// does) against reading every blob into a std::vector first. Runs on the CPU only, the GPU side
+// of an upload is the same for both. Write large inputs with MeshConverter --synthetic.
+// The first pass may hit the disk, later ones usually come from the page cache.
+const size_t STAGING_SIZE = 32ull * 1024 * 1024;	// UploadManager::DEFAULT_STAGING_SIZE
+const size_t CHUNK_SIZE = STAGING_SIZE / 2;	// largest single copy UploadManager makes
+
+static double secondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// mirrors UploadManager::upload: chunks go into the ring back to back, wrapping at the end
+class StagingRing {
+	public:
+		StagingRing() : _memory(STAGING_SIZE) {}
+
+		void copy(const void* data, uint64_t size) {
+			const uint8_t* src = static_cast<const uint8_t*>(data);
+			while (size > 0) {
+				size_t chunkSize = static_cast<size_t>(std::min<uint64_t>(size, CHUNK_SIZE));
+				if (_head + chunkSize > STAGING_SIZE) {
+					_head = 0;
+				}
+				memcpy(_memory.data() + _head, src, chunkSize);
+				_head += chunkSize;
+				src += chunkSize;
+				size -= chunkSize;
+			}
+		}
+
+		// keeps the copies from being optimized away
+		uint8_t checksum() const { return _memory[0] ^ _memory[STAGING_SIZE - 1]; }
+
+	private:
+		std::vector<uint8_t> _memory;
+		size_t _head = 0;
+};
+
+static uint64_t loadMapped(const std::string& path, StagingRing& staging) {
+	MeshFile meshFile;
+	meshFile.open(path);
+	uint64_t bytes = 0;
+	for (uint32_t i = 0; i < meshFile.meshCount(); i++) {
+		const MeshRecord& record = meshFile.mesh(i);
+		uint64_t vertexBytes = static_cast<uint64_t>(record.vertexCount) * record.vertexStride;
+		uint64_t indexBytes = static_cast<uint64_t>(record.indexCount) * record.indexSize;
+		uint64_t meshletBytes = static_cast<uint64_t>(record.meshletCount) * sizeof(MeshletRecord);
+		staging.copy(meshFile.vertexData(i), vertexBytes);
+		staging.copy(meshFile.indexData(i), indexBytes);
+		staging.copy(meshFile.meshlets(i), meshletBytes);
+		bytes += vertexBytes + indexBytes + meshletBytes;
+	}
+	meshFile.close();
+	return bytes;
+}
+
+static uint64_t loadStreamed(const std::string& path, StagingRing& staging) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + path);
+	}
+	MeshFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	std::vector<MeshRecord> records(header.meshCount);
+	file.seekg(static_cast<std::streamoff>(header.meshTableOffset));
+	file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(MeshRecord));
+
+	uint64_t bytes = 0;
+	std::vector<uint8_t> blob;
+	for (const MeshRecord& record : records) {
+		for (auto [offset, size] : { std::pair<uint64_t, uint64_t>(record.vertexOffset, static_cast<uint64_t>(record.vertexCount) * record.vertexStride), std::pair<uint64_t, uint64_t>(record.indexOffset, static_cast<uint64_t>(record.indexCount) * record.indexSize),
+			std::pair<uint64_t, uint64_t>(record.meshletOffset, static_cast<uint64_t>(record.meshletCount) * sizeof(MeshletRecord)) }) {
+			blob.resize(static_cast<size_t>(size));
+			file.seekg(static_cast<std::streamoff>(offset));
+			file.read(reinterpret_cast<char*>(blob.data()), static_cast<std::streamsize>(size));
+			staging.copy(blob.data(), size);
+			bytes += size;
+		}
+	}
+	if (file.fail()) {
+		throw std::runtime_error("Failed to read " + path);
+	}
+	return bytes;
+}
+
+int main(int argc, char* argv[]) {
+	std::string path;
+	uint32_t iterations = 3;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--iterations" && i + 1 < argc) {
+			iterations = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+		} else if (!arg.starts_with("--") && path.empty()) {
+			path = arg;
+		} else {
+			path.clear();
+			break;
+		}
+	}
+	if (path.empty()) {
+		std::cout << "usage: " << argv[0] << " scene.mesh [--iterations N]" << std::endl;
+		return 1;
+	}
+
+	try {
+		StagingRing staging;
+		for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+			auto mappedStartTime = std::chrono::high_resolution_clock::now();
+			uint64_t mappedBytes = loadMapped(path, staging);
+			double mappedSeconds = secondsSince(mappedStartTime);
+
+			auto streamedStartTime = std::chrono::high_resolution_clock::now();
+			uint64_t streamedBytes = loadStreamed(path, staging);
+			double streamedSeconds = secondsSince(streamedStartTime);
+
+			double gigabyte = 1024.0 * 1024.0 * 1024.0;
+			std::cout << "pass " << iteration << ": " << mappedBytes / gigabyte << " GB, mapped " << mappedSeconds * 1000.0 << " ms (" << mappedBytes / gigabyte / mappedSeconds
+				<< " GB/s), read into vectors " << streamedSeconds * 1000.0 << " ms (" << streamedBytes / gigabyte / streamedSeconds << " GB/s)" << std::endl;
+		}
+		std::cout << "checksum " << static_cast<uint32_t>(staging.checksum()) << std::endl;
+	} catch (std::exception& err) {
+		std::cout << "std::Exception: " << err.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
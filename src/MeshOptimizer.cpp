@@ -0,0 +1,541 @@
+#include "../include/MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t INVALID_VERTEX = UINT32_MAX;
+
+// Triangles around every vertex, triangles[offsets[v] .. offsets[v + 1]] use vertex v
+struct TriangleAdjacency {
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+};
+
+TriangleAdjacency buildAdjacency(const uint32_t* indices, size_t indexCount, uint32_t vertexCount) {
+	TriangleAdjacency adjacency;
+	adjacency.offsets.assign(static_cast<size_t>(vertexCount) + 1, 0);
+	for (size_t i = 0; i < indexCount; i++) {
+		adjacency.offsets[indices[i] + 1]++;
+	}
+	std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+	adjacency.triangles.resize(indexCount);
+	std::vector<uint32_t> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (size_t i = 0; i < indexCount; i++) {
+		adjacency.triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+	return adjacency;
+}
+
+// FIFO post-transform cache, a vertex stays cached for the next cacheSize misses
+class VertexCache {
+	public:
+		VertexCache(uint32_t vertexCount, uint32_t cacheSize) : _insertedAt(vertexCount, 0), _cacheSize(cacheSize) {}
+
+		// returns true on a miss
+		bool access(uint32_t vertex) {
+			if (_insertedAt[vertex] > 0 && _insertedAt[vertex] + _cacheSize > _misses) {
+				return false;
+			}
+			_insertedAt[vertex] = ++_misses;
+			return true;
+		}
+
+		uint32_t accessTriangle(const uint32_t* triangle) {
+			return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+		}
+
+		// evicts everything, like starting a new draw
+		void flush() { _misses += _cacheSize; }
+
+		uint64_t misses() const { return _misses; }
+
+	private:
+		std::vector<uint64_t> _insertedAt;
+		uint64_t _misses = 0;
+		uint32_t _cacheSize;
+};
+
+// Tipsify's next fanning vertex: the candidate that stays in the cache while its remaining
+// triangles are emitted, the oldest such one first, else none
+uint32_t nextFanningVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& liveTriangles, const std::vector<uint64_t>& cacheTime, uint64_t time) {
+	uint32_t best = INVALID_VERTEX;
+	int64_t bestPriority = -1;
+	for (uint32_t vertex : candidates) {
+		if (liveTriangles[vertex] == 0) {
+			continue;
+		}
+		int64_t priority = 0;
+		int64_t age = static_cast<int64_t>(time - cacheTime[vertex]);
+		if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= VERTEX_CACHE_SIZE) {
+			priority = age;
+		}
+		if (priority > bestPriority) {
+			bestPriority = priority;
+			best = vertex;
+		}
+	}
+	return best;
+}
+
+// Most recently emitted vertex that still has triangles, then the lowest such vertex
+uint32_t skipDeadEnd(std::vector<uint32_t>& deadEnds, const std::vector<uint32_t>& liveTriangles, uint32_t& cursor, uint32_t vertexCount) {
+	while (!deadEnds.empty()) {
+		uint32_t vertex = deadEnds.back();
+		deadEnds.pop_back();
+		if (liveTriangles[vertex] > 0) {
+			return vertex;
+		}
+	}
+	for (; cursor < vertexCount; cursor++) {
+		if (liveTriangles[cursor] > 0) {
+			return cursor;
+		}
+	}
+	return INVALID_VERTEX;
+}
+
+}
+
+VertexCacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+	VertexCache cache(vertexCount, cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t referencedCount = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		cache.access(indices[i]);
+		if (!referenced[indices[i]]) {
+			referenced[indices[i]] = true;
+			referencedCount++;
+		}
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.verticesTransformed = static_cast<uint32_t>(cache.misses());
+	statistics.acmr = indexCount >= 3 ? static_cast<float>(statistics.verticesTransformed) / static_cast<float>(indexCount / 3) : 0.0f;
+	statistics.atvr = referencedCount > 0 ? static_cast<float>(statistics.verticesTransformed) / static_cast<float>(referencedCount) : 0.0f;
+	return statistics;
+}
+
+void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, uint32_t vertexCount) {
+	TriangleAdjacency adjacency = buildAdjacency(indices, indexCount, vertexCount);
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+		liveTriangles[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+	}
+
+	//cache times start old enough that every vertex misses
+	std::vector<uint64_t> cacheTime(vertexCount, 0);
+	uint64_t time = VERTEX_CACHE_SIZE + 1;
+	std::vector<bool> emitted(indexCount / 3, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	deadEnds.reserve(indexCount);
+	size_t outputCount = 0;
+	uint32_t cursor = 0;
+
+	uint32_t fanningVertex = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+	while (fanningVertex != INVALID_VERTEX) {
+		candidates.clear();
+		for (uint32_t i = adjacency.offsets[fanningVertex]; i < adjacency.offsets[fanningVertex + 1]; i++) {
+			uint32_t triangle = adjacency.triangles[i];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = true;
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				uint32_t vertex = indices[triangle * 3 + corner];
+				destination[outputCount++] = vertex;
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE) {
+					cacheTime[vertex] = time++;
+				}
+			}
+		}
+		fanningVertex = nextFanningVertex(candidates, liveTriangles, cacheTime, time);
+		if (fanningVertex == INVALID_VERTEX) {
+			fanningVertex = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+		}
+	}
+}
+
+void optimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount, float threshold) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//hard boundaries where a triangle misses on all three vertices, the cache order restarted there
+	VertexCache cache(vertexCount, VERTEX_CACHE_SIZE);
+	std::vector<size_t> hardBoundaries;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+		uint32_t misses = cache.accessTriangle(indices + triangle * 3);
+		if (triangle == 0 || misses == 3) {
+			hardBoundaries.push_back(triangle);
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	//soft boundaries inside those, as soon as a cluster is close to the ACMR of the whole hard cluster
+	std::vector<size_t> clusterStarts;
+	for (size_t hard = 0; hard + 1 < hardBoundaries.size(); hard++) {
+		size_t start = hardBoundaries[hard], end = hardBoundaries[hard + 1];
+		cache.flush();
+		uint64_t hardMisses = 0;
+		for (size_t triangle = start; triangle < end; triangle++) {
+			hardMisses += cache.accessTriangle(indices + triangle * 3);
+		}
+		float clusterThreshold = threshold * static_cast<float>(hardMisses) / static_cast<float>(end - start);
+
+		cache.flush();
+		size_t clusterStart = start;
+		uint64_t misses = 0;
+		for (size_t triangle = start; triangle < end; triangle++) {
+			misses += cache.accessTriangle(indices + triangle * 3);
+			if (triangle + 1 == end || static_cast<float>(misses) / static_cast<float>(triangle - clusterStart + 1) <= clusterThreshold) {
+				clusterStarts.push_back(clusterStart);
+				clusterStart = triangle + 1;
+				misses = 0;
+				cache.flush();
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	//area weighted centroid and normal per cluster and for the whole mesh
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> clusterCentroids(clusterCount * 3, 0.0f), clusterNormals(clusterCount * 3, 0.0f);
+	float meshCentroid[3] = {}, meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		float clusterArea = 0.0f;
+		for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++) {
+			const float* a = positions + indices[triangle * 3] * 3;
+			const float* b = positions + indices[triangle * 3 + 1] * 3;
+			const float* c = positions + indices[triangle * 3 + 2] * 3;
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for (int axis = 0; axis < 3; axis++) {
+				float centroid = (a[axis] + b[axis] + c[axis]) / 3.0f;
+				clusterCentroids[cluster * 3 + axis] += centroid * area;
+				clusterNormals[cluster * 3 + axis] += normal[axis];
+				meshCentroid[axis] += centroid * area;
+			}
+			clusterArea += area;
+		}
+		for (int axis = 0; axis < 3 && clusterArea > 0.0f; axis++) {
+			clusterCentroids[cluster * 3 + axis] /= clusterArea;
+		}
+		meshArea += clusterArea;
+	}
+	for (int axis = 0; axis < 3 && meshArea > 0.0f; axis++) {
+		meshCentroid[axis] /= meshArea;
+	}
+
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		const float* centroid = &clusterCentroids[cluster * 3];
+		const float* normal = &clusterNormals[cluster * 3];
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float dot = (centroid[0] - meshCentroid[0]) * normal[0] + (centroid[1] - meshCentroid[1]) * normal[1] + (centroid[2] - meshCentroid[2]) * normal[2];
+		sortKeys[cluster] = length > 0.0f ? dot / length : 0.0f;
+	}
+
+	std::vector<uint32_t> clusterOrder(clusterCount);
+	std::iota(clusterOrder.begin(), clusterOrder.end(), 0u);
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t left, uint32_t right) { return sortKeys[left] > sortKeys[right]; });
+
+	size_t outputCount = 0;
+	for (uint32_t cluster : clusterOrder) {
+		size_t start = clusterStarts[cluster] * 3, end = clusterStarts[cluster + 1] * 3;
+		std::copy(indices + start, indices + end, destination + outputCount);
+		outputCount += end - start;
+	}
+}
+
+uint32_t optimizeVertexFetch(uint32_t* indices, size_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap) {
+	remap.assign(vertexCount, INVALID_VERTEX);
+	uint32_t keptVertexCount = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t& newIndex = remap[indices[i]];
+		if (newIndex == INVALID_VERTEX) {
+			newIndex = keptVertexCount++;
+		}
+		indices[i] = newIndex;
+	}
+	return keptVertexCount;
+}
+
+namespace {
+
+// Symmetric 4x4 matrix of summed squared plane distances, weight is the area the planes came from
+struct Quadric {
+	double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+	double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+	double a22 = 0.0, a23 = 0.0;
+	double a33 = 0.0;
+	double weight = 0.0;
+
+	// plane n.p + d = 0, n unit length
+	void addPlane(const double* n, double d, double planeWeight) {
+		a00 += planeWeight * n[0] * n[0]; a01 += planeWeight * n[0] * n[1]; a02 += planeWeight * n[0] * n[2]; a03 += planeWeight * n[0] * d;
+		a11 += planeWeight * n[1] * n[1]; a12 += planeWeight * n[1] * n[2]; a13 += planeWeight * n[1] * d;
+		a22 += planeWeight * n[2] * n[2]; a23 += planeWeight * n[2] * d;
+		a33 += planeWeight * d * d;
+		weight += planeWeight;
+	}
+
+	void add(const Quadric& other) {
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+		a11 += other.a11; a12 += other.a12; a13 += other.a13;
+		a22 += other.a22; a23 += other.a23;
+		a33 += other.a33;
+		weight += other.weight;
+	}
+
+	// weighted mean squared distance of p to the planes
+	double evaluate(const float* p) const {
+		double x = p[0], y = p[1], z = p[2];
+		double sum = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0 * (a03 * x + a13 * y + a23 * z) + a33;
+		return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+	}
+};
+
+enum class VertexKind : uint8_t {
+	eManifold,	// may collapse onto any neighbour
+	eBorder,	// may only collapse along a border edge
+	eLocked	// never moves
+};
+
+struct Collapse {
+	uint32_t source;
+	uint32_t target;
+	float error;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+	return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+void triangleNormal(const float* a, const float* b, const float* c, double* normal) {
+	double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+	normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+	normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+std::vector<VertexKind> classifyVertices(const float* positions, uint32_t vertexCount, const std::unordered_map<uint64_t, uint32_t>& edgeUses) {
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::eManifold);
+	for (const auto& [key, uses] : edgeUses) {
+		uint32_t a = static_cast<uint32_t>(key >> 32), b = static_cast<uint32_t>(key);
+		if (uses > 2) {
+			kinds[a] = kinds[b] = VertexKind::eLocked;
+		} else if (uses == 1) {
+			kinds[a] = kinds[a] == VertexKind::eLocked ? VertexKind::eLocked : VertexKind::eBorder;
+			kinds[b] = kinds[b] == VertexKind::eLocked ? VertexKind::eLocked : VertexKind::eBorder;
+		}
+	}
+
+	//vertices with the same position but different attributes, moving one would tear the seam open
+	std::vector<uint32_t> order(vertexCount);
+	std::iota(order.begin(), order.end(), 0u);
+	auto samePosition = [positions](uint32_t left, uint32_t right) {
+		return std::equal(positions + left * 3, positions + left * 3 + 3, positions + right * 3);
+	};
+	std::sort(order.begin(), order.end(), [positions](uint32_t left, uint32_t right) {
+		return std::lexicographical_compare(positions + left * 3, positions + left * 3 + 3, positions + right * 3, positions + right * 3 + 3);
+	});
+	for (size_t i = 1; i < order.size(); i++) {
+		if (samePosition(order[i - 1], order[i])) {
+			kinds[order[i - 1]] = kinds[order[i]] = VertexKind::eLocked;
+		}
+	}
+	return kinds;
+}
+
+uint32_t sharedTriangles(const TriangleAdjacency& adjacency, const std::vector<uint32_t>& indices, uint32_t source, uint32_t target) {
+	uint32_t count = 0;
+	for (uint32_t i = adjacency.offsets[source]; i < adjacency.offsets[source + 1]; i++) {
+		const uint32_t* corners = &indices[adjacency.triangles[i] * 3];
+		count += corners[0] == target || corners[1] == target || corners[2] == target;
+	}
+	return count;
+}
+
+// true if moving source onto target turns any of its other triangles over
+bool flipsTriangles(const TriangleAdjacency& adjacency, const std::vector<uint32_t>& indices, const float* positions, uint32_t source, uint32_t target) {
+	for (uint32_t i = adjacency.offsets[source]; i < adjacency.offsets[source + 1]; i++) {
+		const uint32_t* corners = &indices[adjacency.triangles[i] * 3];
+		if (corners[0] == target || corners[1] == target || corners[2] == target) {
+			continue;
+		}
+		const float* before[3] = { positions + corners[0] * 3, positions + corners[1] * 3, positions + corners[2] * 3 };
+		const float* after[3] = { before[0], before[1], before[2] };
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			if (corners[corner] == source) {
+				after[corner] = positions + target * 3;
+			}
+		}
+		double normalBefore[3], normalAfter[3];
+		triangleNormal(before[0], before[1], before[2], normalBefore);
+		triangleNormal(after[0], after[1], after[2], normalAfter);
+		double lengthBefore = normalBefore[0] * normalBefore[0] + normalBefore[1] * normalBefore[1] + normalBefore[2] * normalBefore[2];
+		if (lengthBefore > 0.0 && normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+size_t simplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount, size_t targetIndexCount, float targetError, float* resultError) {
+	std::vector<uint32_t> result(indices, indices + indexCount - indexCount % 3);
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	edgeUses.reserve(result.size());
+	for (size_t triangle = 0; triangle < result.size(); triangle += 3) {
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			uint32_t a = result[triangle + corner], b = result[triangle + (corner + 1) % 3];
+			if (a != b) {
+				edgeUses[edgeKey(a, b)]++;
+			}
+		}
+	}
+	std::vector<VertexKind> kinds = classifyVertices(positions, vertexCount, edgeUses);
+
+	//area weighted triangle planes, plus planes through border edges perpendicular to their triangle
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t triangle = 0; triangle < result.size(); triangle += 3) {
+		const uint32_t* corners = &result[triangle];
+		double normal[3];
+		triangleNormal(positions + corners[0] * 3, positions + corners[1] * 3, positions + corners[2] * 3, normal);
+		double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length <= 0.0) {
+			continue;
+		}
+		for (double& component : normal) {
+			component /= length;
+		}
+		const float* a = positions + corners[0] * 3;
+		double d = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			quadrics[corners[corner]].addPlane(normal, d, 0.5 * length);
+		}
+
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			uint32_t from = corners[corner], to = corners[(corner + 1) % 3];
+			if (from == to || edgeUses[edgeKey(from, to)] != 1) {
+				continue;
+			}
+			const float* p = positions + from * 3;
+			const float* q = positions + to * 3;
+			double edge[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+			double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+			double perpendicular[3] = { edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2], edge[0] * normal[1] - edge[1] * normal[0] };
+			double perpendicularLength = std::sqrt(perpendicular[0] * perpendicular[0] + perpendicular[1] * perpendicular[1] + perpendicular[2] * perpendicular[2]);
+			if (perpendicularLength <= 0.0) {
+				continue;
+			}
+			for (double& component : perpendicular) {
+				component /= perpendicularLength;
+			}
+			double borderD = -(perpendicular[0] * p[0] + perpendicular[1] * p[1] + perpendicular[2] * p[2]);
+			quadrics[from].addPlane(perpendicular, borderD, BORDER_QUADRIC_WEIGHT * edgeLengthSquared);
+			quadrics[to].addPlane(perpendicular, borderD, BORDER_QUADRIC_WEIGHT * edgeLengthSquared);
+		}
+	}
+
+	float maxError = 0.0f;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> locked(vertexCount);
+	std::vector<Collapse> collapses;
+	while (result.size() > targetIndexCount) {
+		TriangleAdjacency adjacency = buildAdjacency(result.data(), result.size(), vertexCount);
+		auto allowed = [&](uint32_t source, uint32_t target) {
+			return kinds[source] == VertexKind::eManifold || (kinds[source] == VertexKind::eBorder && sharedTriangles(adjacency, result, source, target) == 1);
+		};
+		auto cost = [&](uint32_t source, uint32_t target) {
+			Quadric quadric = quadrics[source];
+			quadric.add(quadrics[target]);
+			return static_cast<float>(std::sqrt(quadric.evaluate(positions + target * 3)));
+		};
+
+		//the cheaper allowed direction of every edge, edges shared by two triangles show up twice
+		collapses.clear();
+		for (size_t triangle = 0; triangle < result.size(); triangle += 3) {
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				uint32_t a = result[triangle + corner], b = result[triangle + (corner + 1) % 3];
+				Collapse collapse = { INVALID_VERTEX, INVALID_VERTEX, INFINITY };
+				if (allowed(a, b)) {
+					collapse = { a, b, cost(a, b) };
+				}
+				if (allowed(b, a)) {
+					float reverseError = cost(b, a);
+					if (reverseError < collapse.error) {
+						collapse = { b, a, reverseError };
+					}
+				}
+				if (collapse.source != INVALID_VERTEX && collapse.error <= targetError) {
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& left, const Collapse& right) { return left.error < right.error; });
+
+		//a pass aims at what is still missing (about two triangles per collapse) and stays near the error of
+		//its cheapest collapses, the rest is ranked again once the quadrics have grown
+		size_t goal = std::max<size_t>((result.size() - targetIndexCount) / 6, 1);
+		float passError = std::min(targetError, 1.5f * collapses[std::min(goal, collapses.size()) - 1].error);
+
+		//every collapse locks the source's triangle fan, so later flip tests in the pass still see true positions
+		std::iota(remap.begin(), remap.end(), 0u);
+		std::fill(locked.begin(), locked.end(), 0);
+		size_t remainingIndices = result.size();
+		size_t collapseCount = 0;
+		for (const Collapse& collapse : collapses) {
+			if (remainingIndices <= targetIndexCount || collapse.error > passError) {
+				break;
+			}
+			if (locked[collapse.source] || locked[collapse.target] || flipsTriangles(adjacency, result, positions, collapse.source, collapse.target)) {
+				continue;
+			}
+
+			remainingIndices -= 3 * sharedTriangles(adjacency, result, collapse.source, collapse.target);
+			remap[collapse.source] = collapse.target;
+			quadrics[collapse.target].add(quadrics[collapse.source]);
+			maxError = std::max(maxError, collapse.error);
+			for (uint32_t i = adjacency.offsets[collapse.source]; i < adjacency.offsets[collapse.source + 1]; i++) {
+				const uint32_t* corners = &result[adjacency.triangles[i] * 3];
+				locked[corners[0]] = locked[corners[1]] = locked[corners[2]] = 1;
+			}
+			collapseCount++;
+		}
+		if (collapseCount == 0) {
+			break;
+		}
+
+		size_t kept = 0;
+		for (size_t triangle = 0; triangle < result.size(); triangle += 3) {
+			uint32_t a = remap[result[triangle]], b = remap[result[triangle + 1]], c = remap[result[triangle + 2]];
+			if (a != b && b != c && c != a) {
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+		}
+		result.resize(kept);
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	if (resultError) {
+		*resultError = maxError;
+	}
+	return result.size();
+}
@@ -0,0 +1,103 @@
+#include "../include/MeshletBuilder.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// a cone wider than this culls too rarely to be worth testing
+static const float MIN_CONE_COSINE = 0.1f;
+
+static void computeBounds(MeshletRecord& meshlet, const uint32_t* indices, const float* positions, float positionError) {
+	//sphere around the box center, the same construction MeshConverter uses for whole meshes
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+		const float* position = positions + indices[meshlet.firstIndex + i] * 3;
+		for (int axis = 0; axis < 3; axis++) {
+			minimum[axis] = std::min(minimum[axis], position[axis]);
+			maximum[axis] = std::max(maximum[axis], position[axis]);
+		}
+	}
+	float radiusSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++) {
+		meshlet.boundingSphere[axis] = 0.5f * (minimum[axis] + maximum[axis]);
+	}
+	for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+		const float* position = positions + indices[meshlet.firstIndex + i] * 3;
+		float dx = position[0] - meshlet.boundingSphere[0], dy = position[1] - meshlet.boundingSphere[1], dz = position[2] - meshlet.boundingSphere[2];
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	meshlet.boundingSphere[3] = std::sqrt(radiusSquared) + positionError;
+
+	//cone around the average unit normal, degenerate triangles have no say
+	std::vector<float> normals;
+	float axis[3] = {};
+	for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+		const float* a = positions + indices[meshlet.firstIndex + i] * 3;
+		const float* b = positions + indices[meshlet.firstIndex + i + 1] * 3;
+		const float* c = positions + indices[meshlet.firstIndex + i + 2] * 3;
+		float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length <= FLT_MIN) {
+			continue;
+		}
+		for (int component = 0; component < 3; component++) {
+			normals.push_back(normal[component] / length);
+			axis[component] += normal[component] / length;
+		}
+	}
+	float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (normals.empty() || axisLength <= FLT_MIN) {
+		return;
+	}
+	float minimumCosine = 1.0f;
+	for (int component = 0; component < 3; component++) {
+		axis[component] /= axisLength;
+	}
+	for (size_t i = 0; i < normals.size(); i += 3) {
+		minimumCosine = std::min(minimumCosine, axis[0] * normals[i] + axis[1] * normals[i + 1] + axis[2] * normals[i + 2]);
+	}
+	if (minimumCosine <= MIN_CONE_COSINE) {
+		return;
+	}
+	std::copy(axis, axis + 3, meshlet.coneAxis);
+	meshlet.coneCutoff = std::sqrt(1.0f - minimumCosine * minimumCosine);
+}
+
+std::vector<MeshletRecord> buildMeshlets(const uint32_t* indices, size_t indexCount, const float* positions, uint32_t vertexCount, float positionError) {
+	std::vector<MeshletRecord> meshlets;
+	//meshletOf[v] is the last meshlet that used v, so membership checks need no clearing
+	std::vector<uint32_t> meshletOf(vertexCount, UINT32_MAX);
+	MeshletRecord current;
+	auto countNewVertices = [&meshletOf](const uint32_t* corners, uint32_t meshletIndex) {
+		uint32_t count = 0;
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner == 2 && corners[2] == corners[1]);
+			count += meshletOf[corners[corner]] != meshletIndex && !repeated;
+		}
+		return count;
+	};
+
+	for (size_t triangle = 0; triangle + 2 < indexCount; triangle += 3) {
+		const uint32_t* corners = indices + triangle;
+		uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+		uint32_t newVertices = countNewVertices(corners, meshletIndex);
+		if (current.indexCount > 0 && (current.vertexCount + newVertices > MAX_MESHLET_VERTICES || current.indexCount / 3 + 1 > MAX_MESHLET_TRIANGLES)) {
+			computeBounds(current, indices, positions, positionError);
+			meshlets.push_back(current);
+			current = MeshletRecord();
+			current.firstIndex = static_cast<uint32_t>(triangle);
+			newVertices = countNewVertices(corners, ++meshletIndex);
+		}
+
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			meshletOf[corners[corner]] = meshletIndex;
+		}
+		current.vertexCount += newVertices;
+		current.indexCount += 3;
+	}
+	if (current.indexCount > 0) {
+		computeBounds(current, indices, positions, positionError);
+		meshlets.push_back(current);
+	}
+	return meshlets;
+}
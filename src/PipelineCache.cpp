@@ -0,0 +1,80 @@
+#include "../include/PipelineCache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+void PipelineCache::init(vk::PhysicalDevice physicalDevice, vk::Device device, const std::string& path) {
+	_physicalDevice = physicalDevice;
+	_device = device;
+	_path = path;
+
+	std::vector<char> data = load();
+	_warm = !data.empty() && isCompatible(data);
+	if (!data.empty() && !_warm) {
+		std::cout << "Pipeline cache " << _path << " does not match this device, discarding it" << std::endl;
+		data.clear();
+	}
+
+	vk::PipelineCacheCreateInfo pipelineCacheCreateInfo({});
+	pipelineCacheCreateInfo.setInitialDataSize(data.size());
+	pipelineCacheCreateInfo.setPInitialData(data.data());
+	_pipelineCache = _device.createPipelineCache(pipelineCacheCreateInfo);
+
+	std::cout << "Pipeline cache: " << (_warm ? "warm, " : "cold, ") << data.size() << " bytes loaded" << std::endl;
+}
+
+void PipelineCache::save() {
+	std::vector<uint8_t> data = _device.getPipelineCacheData(_pipelineCache);
+
+	//write to a temporary file first so a crash mid-write never leaves a truncated cache behind
+	std::string tempPath = _path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cerr << "Failed to write pipeline cache " << tempPath << std::endl;
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+	std::remove(_path.c_str());
+	if (std::rename(tempPath.c_str(), _path.c_str()) != 0) {
+		std::cerr << "Failed to replace pipeline cache " << _path << std::endl;
+		return;
+	}
+	std::cout << "Pipeline cache: " << data.size() << " bytes saved to " << _path << std::endl;
+}
+
+void PipelineCache::destroy() {
+	save();
+	_device.destroyPipelineCache(_pipelineCache);
+}
+
+std::vector<char> PipelineCache::load() const {
+	std::ifstream file(_path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return {};
+	}
+
+	size_t fileSize = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	std::vector<char> data(fileSize);
+	file.read(data.data(), fileSize);
+	return data;
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& data) const {
+	vk::PipelineCacheHeaderVersionOne header;
+	if (data.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+
+	vk::PhysicalDeviceProperties properties = _physicalDevice.getProperties();
+	return header.headerSize >= sizeof(header)
+		&& header.headerVersion == vk::PipelineCacheHeaderVersion::eOne
+		&& header.vendorID == properties.vendorID
+		&& header.deviceID == properties.deviceID
+		&& memcmp(header.pipelineCacheUUID.data(), properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,484 @@
+#include "../include/RenderGraph.hpp"
+#include <algorithm>
+#include <format>
+
+//access bits that make a use a write, only these need to be made available to later uses
+const vk::AccessFlags2 WRITE_ACCESS = vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eTransferWrite;
+
+static vk::ImageAspectFlags formatAspect(vk::Format format) {
+	switch (format) {
+	case vk::Format::eD16Unorm:
+	case vk::Format::eX8D24UnormPack32:
+	case vk::Format::eD32Sfloat:
+		return vk::ImageAspectFlagBits::eDepth;
+	case vk::Format::eD16UnormS8Uint:
+	case vk::Format::eD24UnormS8Uint:
+	case vk::Format::eD32SfloatS8Uint:
+		return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+	case vk::Format::eS8Uint:
+		return vk::ImageAspectFlagBits::eStencil;
+	default:
+		return vk::ImageAspectFlagBits::eColor;
+	}
+}
+
+UsageScope RenderGraph::usageScope(ResourceUsage usage) {
+	using Stage = vk::PipelineStageFlagBits2;
+	using Access = vk::AccessFlagBits2;
+	using Layout = vk::ImageLayout;
+	switch (usage) {
+	case ResourceUsage::eIndirectRead:
+		return { Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined, false };
+	case ResourceUsage::eVertexRead:
+		return { Stage::eVertexAttributeInput | Stage::eIndexInput, Access::eVertexAttributeRead | Access::eIndexRead, Layout::eUndefined, false };
+	case ResourceUsage::eComputeRead:
+		return { Stage::eComputeShader, Access::eShaderStorageRead | Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal, false };
+	case ResourceUsage::eComputeWrite:
+		return { Stage::eComputeShader, Access::eShaderStorageRead | Access::eShaderStorageWrite, Layout::eGeneral, true };
+	case ResourceUsage::eGraphicsRead:
+		return { Stage::eVertexShader | Stage::eFragmentShader, Access::eShaderStorageRead | Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal, false };
+	case ResourceUsage::eColorAttachment:
+		return { Stage::eColorAttachmentOutput, Access::eColorAttachmentRead | Access::eColorAttachmentWrite, Layout::eColorAttachmentOptimal, true };
+	case ResourceUsage::eDepthAttachment:
+		return { Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite, Layout::eDepthAttachmentOptimal, true };
+	case ResourceUsage::eDepthRead:
+		return { Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentRead, Layout::eDepthReadOnlyOptimal, false };
+	case ResourceUsage::eTransferRead:
+		return { Stage::eTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal, false };
+	case ResourceUsage::eTransferWrite:
+		return { Stage::eTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal, true };
+	case ResourceUsage::ePresent:
+		return { Stage::eNone, Access::eNone, Layout::ePresentSrcKHR, false };
+	}
+	return {};
+}
+
+RenderGraph::ResourceId RenderGraph::createImage(const std::string& name, const vk::ImageCreateInfo& imageCreateInfo) {
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.transient = true;
+	resource.imageCreateInfo = imageCreateInfo;
+	resource.aspect = formatAspect(imageCreateInfo.format);
+	_resources.push_back(resource);
+	return static_cast<ResourceId>(_resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(const std::string& name) {
+	Resource resource;
+	resource.name = name;
+	_resources.push_back(resource);
+	return static_cast<ResourceId>(_resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importImage(const std::string& name, vk::ImageLayout initialLayout, vk::ImageAspectFlags aspect, vk::PipelineStageFlags2 availableStages) {
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.initialLayout = initialLayout;
+	resource.availableStages = availableStages;
+	resource.aspect = aspect;
+	_resources.push_back(resource);
+	return static_cast<ResourceId>(_resources.size() - 1);
+}
+
+void RenderGraph::markOutput(ResourceId resource, std::optional<ResourceUsage> finalUsage) {
+	_resources[resource].output = true;
+	_resources[resource].finalUsage = finalUsage;
+}
+
+RenderGraph::PassId RenderGraph::addPass(const std::string& name, RecordFunction record) {
+	Pass pass;
+	pass.name = name;
+	pass.record = std::move(record);
+	_passes.push_back(std::move(pass));
+	return static_cast<PassId>(_passes.size() - 1);
+}
+
+void RenderGraph::read(PassId pass, ResourceId resource, ResourceUsage usage) {
+	if (usageScope(usage).write) {
+		throw std::runtime_error(std::format("pass {} reads {} with a writing usage", _passes[pass].name, _resources[resource].name));
+	}
+	_passes[pass].accesses.push_back({ resource, usage });
+}
+
+void RenderGraph::write(PassId pass, ResourceId resource, ResourceUsage usage) {
+	if (!usageScope(usage).write) {
+		throw std::runtime_error(std::format("pass {} writes {} with a reading usage", _passes[pass].name, _resources[resource].name));
+	}
+	_passes[pass].accesses.push_back({ resource, usage });
+}
+
+void RenderGraph::setSideEffects(PassId pass) {
+	_passes[pass].sideEffects = true;
+}
+
+std::vector<std::pair<RenderGraph::ResourceId, UsageScope>> RenderGraph::passScopes(const Pass& pass) const {
+	std::vector<std::pair<ResourceId, UsageScope>> scopes;
+	for (const Access& access : pass.accesses) {
+		UsageScope scope = usageScope(access.usage);
+		auto it = std::find_if(scopes.begin(), scopes.end(), [&](const auto& entry) { return entry.first == access.resource; });
+		if (it == scopes.end()) {
+			scopes.push_back({ access.resource, scope });
+			continue;
+		}
+		if (_resources[access.resource].isImage && it->second.layout != scope.layout) {
+			throw std::runtime_error(std::format("pass {} uses image {} in two layouts", pass.name, _resources[access.resource].name));
+		}
+		it->second.stages |= scope.stages;
+		it->second.access |= scope.access;
+		it->second.write = it->second.write || scope.write;
+	}
+	return scopes;
+}
+
+void RenderGraph::cullPasses() {
+	//walking backwards, a pass is live if a live pass or the frame's outputs need what it writes.
+	//A write does not end the need for earlier writers, the pass may only update part of the resource.
+	std::vector<bool> needed(_resources.size(), false);
+	for (ResourceId resource = 0; resource < _resources.size(); resource++) {
+		needed[resource] = _resources[resource].output;
+	}
+	for (size_t i = _passes.size(); i-- > 0;) {
+		Pass& pass = _passes[i];
+		pass.live = pass.sideEffects;
+		for (const Access& access : pass.accesses) {
+			pass.live = pass.live || (usageScope(access.usage).write && needed[access.resource]);
+		}
+		if (!pass.live) {
+			continue;
+		}
+		for (const Access& access : pass.accesses) {
+			if (!usageScope(access.usage).write) {
+				needed[access.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes() {
+	for (uint32_t i = 0; i < _passes.size(); i++) {
+		if (!_passes[i].live) {
+			continue;
+		}
+		for (const Access& access : _passes[i].accesses) {
+			Resource& resource = _resources[access.resource];
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = std::max(resource.lastPass, i);
+		}
+	}
+	for (Resource& resource : _resources) {
+		if (resource.output && resource.firstPass != UINT32_MAX) {
+			resource.lastPass = static_cast<uint32_t>(_passes.size());
+		}
+	}
+}
+
+void RenderGraph::planMemory() {
+	//largest first, each into the first slot whose images are all dead while it lives
+	std::vector<ResourceId> order;
+	for (ResourceId resource = 0; resource < _resources.size(); resource++) {
+		if (_resources[resource].transient && _resources[resource].firstPass != UINT32_MAX) {
+			order.push_back(resource);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [this](ResourceId a, ResourceId b) { return _resources[a].memoryRequirements.size > _resources[b].memoryRequirements.size; });
+
+	for (ResourceId id : order) {
+		Resource& resource = _resources[id];
+		auto overlaps = [&](const MemorySlot& slot) {
+			return std::any_of(slot.resources.begin(), slot.resources.end(), [&](ResourceId other) {
+				return resource.firstPass <= _resources[other].lastPass && _resources[other].firstPass <= resource.lastPass;
+			});
+		};
+		uint32_t slotIndex = 0;
+		while (slotIndex < _memorySlots.size() && (!(_memorySlots[slotIndex].memoryRequirements.memoryTypeBits & resource.memoryRequirements.memoryTypeBits) || overlaps(_memorySlots[slotIndex]))) {
+			slotIndex++;
+		}
+		if (slotIndex == _memorySlots.size()) {
+			MemorySlot slot;
+			slot.memoryRequirements = resource.memoryRequirements;
+			_memorySlots.push_back(slot);
+		}
+		MemorySlot& slot = _memorySlots[slotIndex];
+		slot.memoryRequirements.size = std::max(slot.memoryRequirements.size, resource.memoryRequirements.size);
+		slot.memoryRequirements.alignment = std::max(slot.memoryRequirements.alignment, resource.memoryRequirements.alignment);
+		slot.memoryRequirements.memoryTypeBits &= resource.memoryRequirements.memoryTypeBits;
+		slot.resources.push_back(id);
+		resource.memorySlot = slotIndex;
+		_transientBytes += resource.memoryRequirements.size;
+	}
+
+	for (MemorySlot& slot : _memorySlots) {
+		std::sort(slot.resources.begin(), slot.resources.end(), [this](ResourceId a, ResourceId b) { return _resources[a].firstPass < _resources[b].firstPass; });
+		_aliasedBytes += slot.memoryRequirements.size;
+	}
+}
+
+void RenderGraph::buildBarriers() {
+	//what the last write and the reads since left behind, per resource
+	struct State {
+		vk::PipelineStageFlags2 writeStages;
+		vk::AccessFlags2 writeAccess;
+		vk::PipelineStageFlags2 readStages;	// reads already ordered after the write
+		vk::AccessFlags2 readAccess;
+		vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+	};
+	std::vector<State> states(_resources.size());
+
+	//a transient image starts where the previous user of its memory stopped, the last one of the
+	//previous frame for the first, and discards the contents
+	std::vector<UsageScope> lifetimeScopes(_resources.size());
+	for (const Pass& pass : _passes) {
+		if (!pass.live) {
+			continue;
+		}
+		for (const auto& [resource, scope] : passScopes(pass)) {
+			lifetimeScopes[resource].stages |= scope.stages;
+			lifetimeScopes[resource].access |= scope.access;
+		}
+	}
+	for (ResourceId id = 0; id < _resources.size(); id++) {
+		const Resource& resource = _resources[id];
+		states[id].layout = resource.initialLayout;
+		//what makes an imported image available counts as its last write, with nothing to make visible
+		states[id].writeStages = resource.availableStages;
+		if (resource.memorySlot == UINT32_MAX) {
+			continue;
+		}
+		const std::vector<ResourceId>& slotResources = _memorySlots[resource.memorySlot].resources;
+		size_t position = std::find(slotResources.begin(), slotResources.end(), id) - slotResources.begin();
+		ResourceId previous = slotResources[(position + slotResources.size() - 1) % slotResources.size()];
+		states[id].writeStages = lifetimeScopes[previous].stages;
+		states[id].writeAccess = lifetimeScopes[previous].access & WRITE_ACCESS;
+	}
+
+	auto transition = [&](std::vector<Barrier>& barriers, ResourceId id, const UsageScope& scope) {
+		const Resource& resource = _resources[id];
+		State& state = states[id];
+		vk::ImageLayout layout = resource.isImage ? scope.layout : vk::ImageLayout::eUndefined;
+		bool layoutChange = state.layout != layout;
+
+		Barrier barrier;
+		barrier.resource = id;
+		barrier.dstStages = scope.stages;
+		barrier.dstAccess = scope.access;
+		barrier.oldLayout = state.layout;
+		barrier.newLayout = layout;
+		bool needed = layoutChange;
+		if (scope.write) {
+			//after the last write and after every read since
+			barrier.srcStages = state.writeStages | state.readStages;
+			barrier.srcAccess = state.writeAccess;
+			needed = needed || barrier.srcStages;
+			state = { scope.stages, scope.access & WRITE_ACCESS, {}, {}, layout };
+		} else {
+			//reads after a write need a barrier, unless an earlier one already covered this stage and access
+			bool covered = (state.readStages & scope.stages) == scope.stages && (state.readAccess & scope.access) == scope.access;
+			if (state.writeStages && (!covered || layoutChange)) {
+				barrier.srcStages = state.writeStages;
+				barrier.srcAccess = state.writeAccess;
+				needed = true;
+			}
+			if (layoutChange) {
+				//reads in the old layout finish before the transition, later reads chain off this barrier
+				barrier.srcStages |= state.readStages;
+				state.writeStages = scope.stages;
+				state.readStages = {};
+				state.readAccess = {};
+			}
+			state.readStages |= scope.stages;
+			state.readAccess |= scope.access;
+			state.layout = layout;
+		}
+		if (needed) {
+			barriers.push_back(barrier);
+		}
+	};
+
+	for (Pass& pass : _passes) {
+		pass.barriers.clear();
+		if (!pass.live) {
+			continue;
+		}
+		for (const auto& [resource, scope] : passScopes(pass)) {
+			transition(pass.barriers, resource, scope);
+		}
+	}
+	_finalBarriers.clear();
+	for (ResourceId id = 0; id < _resources.size(); id++) {
+		if (_resources[id].finalUsage) {
+			transition(_finalBarriers, id, usageScope(*_resources[id].finalUsage));
+		}
+	}
+}
+
+void RenderGraph::compile(vk::Device device, MemoryAllocator& allocator) {
+	if (_compiled) {
+		throw std::runtime_error("render graph compiled twice");
+	}
+	_device = device;
+	_allocator = &allocator;
+	cullPasses();
+	computeLifetimes();
+
+	for (Resource& resource : _resources) {
+		if (resource.transient && resource.firstPass != UINT32_MAX) {
+			resource.image = _device.createImage(resource.imageCreateInfo);
+			resource.memoryRequirements = _device.getImageMemoryRequirements(resource.image);
+		}
+	}
+	planMemory();
+	for (MemorySlot& slot : _memorySlots) {
+		slot.allocation = _allocator->allocate(slot.memoryRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal, AllocationStrategy::eBuddy, true);
+		for (ResourceId id : slot.resources) {
+			Resource& resource = _resources[id];
+			_device.bindImageMemory(resource.image, slot.allocation.deviceMemory, slot.allocation.offset);
+
+			vk::ImageViewCreateInfo imageViewCreateInfo({});
+			imageViewCreateInfo.setImage(resource.image);
+			imageViewCreateInfo.setViewType(resource.imageCreateInfo.arrayLayers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D);
+			imageViewCreateInfo.setFormat(resource.imageCreateInfo.format);
+			imageViewCreateInfo.setSubresourceRange(vk::ImageSubresourceRange(resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS));
+			resource.imageView = _device.createImageView(imageViewCreateInfo);
+		}
+	}
+	buildBarriers();
+	_compiled = true;
+}
+
+void RenderGraph::compile(const MemoryRequirementsFunction& memoryRequirements) {
+	if (_compiled) {
+		throw std::runtime_error("render graph compiled twice");
+	}
+	cullPasses();
+	computeLifetimes();
+	for (Resource& resource : _resources) {
+		if (resource.transient && resource.firstPass != UINT32_MAX) {
+			resource.memoryRequirements = memoryRequirements(resource.imageCreateInfo);
+		}
+	}
+	planMemory();
+	buildBarriers();
+	_compiled = true;
+}
+
+void RenderGraph::destroy() {
+	if (!_device) {
+		return;
+	}
+	for (Resource& resource : _resources) {
+		if (resource.transient && resource.image) {
+			_device.destroyImageView(resource.imageView);
+			_device.destroyImage(resource.image);
+		}
+	}
+	for (MemorySlot& slot : _memorySlots) {
+		_allocator->free(slot.allocation);
+	}
+	_memorySlots.clear();
+}
+
+void RenderGraph::setImage(ResourceId resource, vk::Image image) {
+	_resources[resource].image = image;
+}
+
+void RenderGraph::recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<Barrier>& barriers) const {
+	if (barriers.empty()) {
+		return;
+	}
+	//every buffer barrier of the batch folds into one global memory barrier
+	vk::MemoryBarrier2 memoryBarrier({});
+	bool bufferBarriers = false;
+	std::vector<vk::ImageMemoryBarrier2> imageBarriers;
+	imageBarriers.reserve(barriers.size());
+	for (const Barrier& barrier : barriers) {
+		const Resource& resource = _resources[barrier.resource];
+		if (!resource.isImage) {
+			memoryBarrier.srcStageMask |= barrier.srcStages;
+			memoryBarrier.srcAccessMask |= barrier.srcAccess;
+			memoryBarrier.dstStageMask |= barrier.dstStages;
+			memoryBarrier.dstAccessMask |= barrier.dstAccess;
+			bufferBarriers = true;
+			continue;
+		}
+		imageBarriers.push_back(vk::ImageMemoryBarrier2(barrier.srcStages, barrier.srcAccess, barrier.dstStages, barrier.dstAccess, barrier.oldLayout, barrier.newLayout,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image, vk::ImageSubresourceRange(resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)));
+	}
+
+	vk::DependencyInfo dependencyInfo({});
+	if (bufferBarriers) {
+		dependencyInfo.setMemoryBarriers(memoryBarrier);
+	}
+	dependencyInfo.setImageMemoryBarriers(imageBarriers);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+void RenderGraph::execute(vk::CommandBuffer commandBuffer, const PassHook& passHook) const {
+	for (const Pass& pass : _passes) {
+		if (!pass.live) {
+			continue;
+		}
+		if (passHook) {
+			passHook(commandBuffer, pass.name.c_str(), true);
+		}
+		recordBarriers(commandBuffer, pass.barriers);
+		pass.record(commandBuffer);
+		if (passHook) {
+			passHook(commandBuffer, pass.name.c_str(), false);
+		}
+	}
+	recordBarriers(commandBuffer, _finalBarriers);
+}
+
+uint32_t RenderGraph::livePassCount() const {
+	return static_cast<uint32_t>(std::count_if(_passes.begin(), _passes.end(), [](const Pass& pass) { return pass.live; }));
+}
+
+uint32_t RenderGraph::barrierBatchCount() const {
+	uint32_t batches = _finalBarriers.empty() ? 0 : 1;
+	for (const Pass& pass : _passes) {
+		batches += pass.live && !pass.barriers.empty() ? 1 : 0;
+	}
+	return batches;
+}
+
+void RenderGraph::printSchedule(std::ostream& out) const {
+	const double megabyte = 1024.0 * 1024.0;
+	auto printBarriers = [&](const std::vector<Barrier>& barriers) {
+		for (const Barrier& barrier : barriers) {
+			const Resource& resource = _resources[barrier.resource];
+			std::string layouts = resource.isImage ? std::format(" {} -> {},", vk::to_string(barrier.oldLayout), vk::to_string(barrier.newLayout)) : "";
+			out << std::format("      {}:{} {} {} -> {} {}", resource.name, layouts, vk::to_string(barrier.srcStages), vk::to_string(barrier.srcAccess),
+				vk::to_string(barrier.dstStages), vk::to_string(barrier.dstAccess)) << std::endl;
+		}
+	};
+
+	out << std::format("Render graph: {} of {} passes live, {} barrier batches", livePassCount(), _passes.size(), barrierBatchCount()) << std::endl;
+	for (size_t i = 0; i < _passes.size(); i++) {
+		out << std::format("  [{}] {}{}", i, _passes[i].name, _passes[i].live ? "" : " (culled)") << std::endl;
+		printBarriers(_passes[i].barriers);
+	}
+	if (!_finalBarriers.empty()) {
+		out << "  after the last pass" << std::endl;
+		printBarriers(_finalBarriers);
+	}
+
+	size_t transientCount = 0;
+	for (const MemorySlot& slot : _memorySlots) {
+		transientCount += slot.resources.size();
+	}
+	if (transientCount == 0) {
+		return;
+	}
+	out << std::format("Transient images: {} in {} allocations, {:.1f} MB instead of {:.1f} MB, {:.1f} MB saved by aliasing",
+		transientCount, _memorySlots.size(), _aliasedBytes / megabyte, _transientBytes / megabyte, aliasingSavedBytes() / megabyte) << std::endl;
+	for (size_t i = 0; i < _memorySlots.size(); i++) {
+		std::string images;
+		for (ResourceId id : _memorySlots[i].resources) {
+			const Resource& resource = _resources[id];
+			images += std::format("{}{} [{}-{}]", images.empty() ? "" : ", ", resource.name, resource.firstPass, resource.lastPass);
+		}
+		out << std::format("  memory {} ({:.1f} MB): {}", i, _memorySlots[i].memoryRequirements.size / megabyte, images) << std::endl;
+	}
+}
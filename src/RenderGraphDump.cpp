@@ -0,0 +1,114 @@
+#include <iostream>
+#include <string>
+
+#include "../include/RenderGraph.hpp"
+
+// Compiles a deferred frame of the kind the engine is heading for, without a device, and prints the
+// schedule: which passes survive culling, the barriers the graph places and how much memory the
+// transient attachments share. Image memory is estimated as width * height * texel size.
+static uint32_t texelSize(vk::Format format) {
+	switch (format) {
+	case vk::Format::eR8Unorm:
+		return 1;
+	case vk::Format::eR16G16B16A16Sfloat:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+static vk::ImageCreateInfo imageInfo(vk::Format format, uint32_t width, uint32_t height, vk::ImageUsageFlags usage) {
+	vk::ImageCreateInfo imageCreateInfo({});
+	imageCreateInfo.setImageType(vk::ImageType::e2D);
+	imageCreateInfo.setFormat(format);
+	imageCreateInfo.setExtent(vk::Extent3D(width, height, 1));
+	imageCreateInfo.setMipLevels(1);
+	imageCreateInfo.setArrayLayers(1);
+	imageCreateInfo.setSamples(vk::SampleCountFlagBits::e1);
+	imageCreateInfo.setTiling(vk::ImageTiling::eOptimal);
+	imageCreateInfo.setUsage(usage);
+	return imageCreateInfo;
+}
+
+int main(int argc, char* argv[]) {
+	uint32_t width = 1920;
+	uint32_t height = 1080;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--width" && i + 1 < argc) {
+			width = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--height" && i + 1 < argc) {
+			height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else {
+			std::cerr << "usage: RenderGraphDump [--width N] [--height N]" << std::endl;
+			return 1;
+		}
+	}
+
+	using Usage = vk::ImageUsageFlagBits;
+	const vk::ImageUsageFlags attachment = Usage::eColorAttachment | Usage::eSampled;
+	const vk::ImageUsageFlags storage = Usage::eStorage | Usage::eSampled;
+
+	RenderGraph graph;
+	RenderGraph::ResourceId depth = graph.createImage("depth", imageInfo(vk::Format::eD32Sfloat, width, height, Usage::eDepthStencilAttachment | Usage::eSampled));
+	RenderGraph::ResourceId albedo = graph.createImage("albedo", imageInfo(vk::Format::eR8G8B8A8Unorm, width, height, attachment));
+	RenderGraph::ResourceId normal = graph.createImage("normal", imageInfo(vk::Format::eR16G16B16A16Sfloat, width, height, attachment));
+	RenderGraph::ResourceId ao = graph.createImage("ao", imageInfo(vk::Format::eR8Unorm, width, height, storage));
+	RenderGraph::ResourceId hdr = graph.createImage("hdr", imageInfo(vk::Format::eR16G16B16A16Sfloat, width, height, storage));
+	RenderGraph::ResourceId bloom = graph.createImage("bloom", imageInfo(vk::Format::eR16G16B16A16Sfloat, width / 2, height / 2, storage));
+	RenderGraph::ResourceId ldr = graph.createImage("ldr", imageInfo(vk::Format::eR8G8B8A8Unorm, width, height, attachment));
+	RenderGraph::ResourceId overlay = graph.createImage("debugOverlay", imageInfo(vk::Format::eR8G8B8A8Unorm, width, height, attachment));
+	RenderGraph::ResourceId swapchain = graph.importImage("swapchain", vk::ImageLayout::eUndefined, vk::ImageAspectFlagBits::eColor, vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+	graph.markOutput(swapchain, ResourceUsage::ePresent);
+
+	auto record = [](vk::CommandBuffer) {};
+	RenderGraph::PassId depthPrepass = graph.addPass("depthPrepass", record);
+	graph.write(depthPrepass, depth, ResourceUsage::eDepthAttachment);
+
+	RenderGraph::PassId gbuffer = graph.addPass("gbuffer", record);
+	graph.read(gbuffer, depth, ResourceUsage::eDepthRead);
+	graph.write(gbuffer, albedo, ResourceUsage::eColorAttachment);
+	graph.write(gbuffer, normal, ResourceUsage::eColorAttachment);
+
+	RenderGraph::PassId ssao = graph.addPass("ssao", record);
+	graph.read(ssao, depth, ResourceUsage::eComputeRead);
+	graph.read(ssao, normal, ResourceUsage::eComputeRead);
+	graph.write(ssao, ao, ResourceUsage::eComputeWrite);
+
+	RenderGraph::PassId lighting = graph.addPass("lighting", record);
+	graph.read(lighting, depth, ResourceUsage::eComputeRead);
+	graph.read(lighting, albedo, ResourceUsage::eComputeRead);
+	graph.read(lighting, normal, ResourceUsage::eComputeRead);
+	graph.read(lighting, ao, ResourceUsage::eComputeRead);
+	graph.write(lighting, hdr, ResourceUsage::eComputeWrite);
+
+	RenderGraph::PassId bloomPass = graph.addPass("bloom", record);
+	graph.read(bloomPass, hdr, ResourceUsage::eComputeRead);
+	graph.write(bloomPass, bloom, ResourceUsage::eComputeWrite);
+
+	RenderGraph::PassId tonemap = graph.addPass("tonemap", record);
+	graph.read(tonemap, hdr, ResourceUsage::eGraphicsRead);
+	graph.read(tonemap, bloom, ResourceUsage::eGraphicsRead);
+	graph.write(tonemap, ldr, ResourceUsage::eColorAttachment);
+
+	//nothing reads the overlay, so the pass is culled and its image never gets memory
+	RenderGraph::PassId debug = graph.addPass("debugNormals", record);
+	graph.read(debug, normal, ResourceUsage::eGraphicsRead);
+	graph.write(debug, overlay, ResourceUsage::eColorAttachment);
+
+	RenderGraph::PassId fxaa = graph.addPass("fxaa", record);
+	graph.read(fxaa, ldr, ResourceUsage::eGraphicsRead);
+	graph.write(fxaa, swapchain, ResourceUsage::eColorAttachment);
+
+	graph.compile([](const vk::ImageCreateInfo& imageCreateInfo) {
+		vk::MemoryRequirements memoryRequirements;
+		memoryRequirements.size = static_cast<vk::DeviceSize>(imageCreateInfo.extent.width) * imageCreateInfo.extent.height * texelSize(imageCreateInfo.format);
+		memoryRequirements.alignment = 65536;
+		memoryRequirements.memoryTypeBits = UINT32_MAX;
+		return memoryRequirements;
+	});
+
+	std::cout << "Frame of " << width << "x" << height << std::endl;
+	graph.printSchedule(std::cout);
+	return 0;
+}
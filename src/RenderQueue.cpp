@@ -0,0 +1,48 @@
+#include "../include/RenderQueue.hpp"
+#include <algorithm>
+#include <array>
+
+uint64_t DrawKey::make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+	uint64_t quantizedDepth = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>((1u << DEPTH_BITS) - 1));
+	uint64_t key = pass & ((1u << PASS_BITS) - 1);
+	key = (key << PIPELINE_BITS) | (pipeline & ((1u << PIPELINE_BITS) - 1));
+	key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+	key = (key << MESH_BITS) | (mesh & ((1u << MESH_BITS) - 1));
+	key = (key << DEPTH_BITS) | quantizedDepth;
+	return key;
+}
+
+void RenderQueue::sort() {
+	const uint32_t DIGIT_COUNT = 8;
+	if (_items.size() < 2) {
+		return;
+	}
+
+	//all eight histograms in one read of the keys
+	std::array<std::array<uint32_t, 256>, DIGIT_COUNT> histograms = {};
+	for (const Item& item : _items) {
+		for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++) {
+			histograms[digit][(item.key >> (digit * 8)) & 0xff]++;
+		}
+	}
+
+	_scratch.resize(_items.size());
+	for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++) {
+		std::array<uint32_t, 256>& histogram = histograms[digit];
+		//a digit every key shares would copy the items in their current order
+		if (histogram[(_items.front().key >> (digit * 8)) & 0xff] == _items.size()) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& count : histogram) {
+			uint32_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+		for (const Item& item : _items) {
+			_scratch[histogram[(item.key >> (digit * 8)) & 0xff]++] = item;
+		}
+		_items.swap(_scratch);
+	}
+}
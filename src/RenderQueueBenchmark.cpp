@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/RenderQueue.hpp"
+
+// Compares RenderQueue::sort against std::stable_sort on the same keys, for a frame's worth of
+// draws spread over a few pipelines and materials and many meshes at random depths
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+	return std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+static void runCase(const std::string& name, uint32_t count, uint32_t iterations, uint32_t pipelineCount, uint32_t materialCount, uint32_t meshCount) {
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> depthDistribution(0.0f, 1.0f);
+	std::vector<uint64_t> keys(count);
+	for (uint64_t& key : keys) {
+		key = DrawKey::make(0, random() % pipelineCount, random() % materialCount, random() % meshCount, depthDistribution(random));
+	}
+
+	RenderQueue queue;
+	queue.reserve(count);
+	std::vector<RenderQueue::Item> reference;
+	double radixMs = 0.0, stdMs = 0.0;
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		queue.clear();
+		for (uint32_t i = 0; i < count; i++) {
+			queue.submit(keys[i], i);
+		}
+		reference = queue.items();
+
+		auto radixStartTime = std::chrono::high_resolution_clock::now();
+		queue.sort();
+		radixMs += millisecondsSince(radixStartTime);
+
+		auto stdStartTime = std::chrono::high_resolution_clock::now();
+		std::stable_sort(reference.begin(), reference.end(), [](const RenderQueue::Item& left, const RenderQueue::Item& right) { return left.key < right.key; });
+		stdMs += millisecondsSince(stdStartTime);
+	}
+
+	bool identical = std::equal(reference.begin(), reference.end(), queue.items().begin(), [](const RenderQueue::Item& left, const RenderQueue::Item& right) {
+		return left.key == right.key && left.draw == right.draw;
+	});
+	std::cout << name << ": std::stable_sort " << stdMs / iterations << " ms, RenderQueue " << radixMs / iterations << " ms (" << stdMs / radixMs << "x), "
+		<< (identical ? "same order" : "ORDER DIFFERS") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	uint32_t count = 100000;
+	uint32_t iterations = 50;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--count" && i + 1 < argc) {
+			count = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--iterations" && i + 1 < argc) {
+			iterations = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+		} else {
+			std::cout << "usage: " << argv[0] << " [--count N] [--iterations I]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << count << " draws, " << iterations << " sorts" << std::endl;
+	runCase("1 pipeline, 1 material, 64 meshes", count, iterations, 1, 1, 64);
+	runCase("8 pipelines, 256 materials, 4096 meshes", count, iterations, 8, 256, 4096);
+	return 0;
+}
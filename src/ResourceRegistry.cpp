@@ -0,0 +1,137 @@
+#include "../include/ResourceRegistry.hpp"
+#include "../include/Utilities.hpp"
+#include <algorithm>
+#include <format>
+
+void DeletionQueue::push(uint64_t timelineValue, vk::DeviceSize bytes, std::function<void()>&& deletion, UploadTicket uploadTicket) {
+	_pending.push_back({ timelineValue, uploadTicket, bytes, std::move(deletion) });
+	_pendingBytes += bytes;
+	_peakPendingBytes = std::max(_peakPendingBytes, _pendingBytes);
+}
+
+void DeletionQueue::collect(uint64_t completedValue, UploadTicket completedUploadTicket) {
+	auto pending = std::stable_partition(_pending.begin(), _pending.end(), [completedValue, completedUploadTicket](const DeferredDeletion& deferredDeletion) {
+		return deferredDeletion.timelineValue <= completedValue && deferredDeletion.uploadTicket <= completedUploadTicket;
+	});
+	for (auto it = _pending.begin(); it != pending; ++it) {
+		it->deletion();
+		_pendingBytes -= it->bytes;
+		_retiredBytes += it->bytes;
+		_retiredCount++;
+	}
+	_pending.erase(_pending.begin(), pending);
+}
+
+void ResourceRegistry::init(vk::Device device, MemoryAllocator& allocator, DeletionQueue& deletionQueue) {
+	_device = device;
+	_allocator = &allocator;
+	_deletionQueue = &deletionQueue;
+}
+
+void ResourceRegistry::destroy() {
+	for (uint32_t i = 0; i < _resources.size(); i++) {
+		if (_resources[i].alive) {
+			release({ i, _resources[i].generation });
+		}
+	}
+	_deletionQueue->flush();
+	_resources.clear();
+	_freeIndices.clear();
+}
+
+ResourceHandle ResourceRegistry::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryPropertyFlags, AllocationStrategy allocationStrategy, const std::vector<uint32_t>& queueFamilyIndices) {
+	vk::Buffer buffer;
+	Allocation allocation;
+	::createBuffer(*_allocator, _device, size, usage, memoryPropertyFlags, buffer, allocation, allocationStrategy, queueFamilyIndices);
+	return insert(buffer, nullptr, allocation);
+}
+
+ResourceHandle ResourceRegistry::createImage(const vk::ImageCreateInfo& imageCreateInfo, vk::MemoryPropertyFlags memoryPropertyFlags) {
+	vk::Image image;
+	Allocation allocation;
+	::createImage(*_allocator, _device, imageCreateInfo, memoryPropertyFlags, image, allocation);
+	return insert(nullptr, image, allocation);
+}
+
+ResourceHandle ResourceRegistry::insert(vk::Buffer buffer, vk::Image image, const Allocation& allocation) {
+	uint32_t index = 0;
+	if (_freeIndices.empty()) {
+		index = static_cast<uint32_t>(_resources.size());
+		_resources.emplace_back();
+	} else {
+		index = _freeIndices.back();
+		_freeIndices.pop_back();
+	}
+
+	Resource& resource = _resources[index];
+	resource.buffer = buffer;
+	resource.image = image;
+	resource.allocation = allocation;
+	resource.lastUse = 0;
+	resource.lastUpload = 0;
+	resource.alive = true;
+	_liveCount++;
+	_liveBytes += allocation.size;
+	return { index, resource.generation };
+}
+
+uint32_t ResourceRegistry::resolve(ResourceHandle handle) const {
+	if (!alive(handle)) {
+		throw std::runtime_error(std::format("stale resource handle {}:{}", handle.index, handle.generation));
+	}
+	return handle.index;
+}
+
+void ResourceRegistry::markUsed(ResourceHandle handle, uint64_t timelineValue) {
+	Resource& resource = _resources[resolve(handle)];
+	resource.lastUse = std::max(resource.lastUse, timelineValue);
+}
+
+void ResourceRegistry::markUploaded(ResourceHandle handle, UploadTicket ticket) {
+	Resource& resource = _resources[resolve(handle)];
+	resource.lastUpload = std::max(resource.lastUpload, ticket);
+}
+
+UploadTicket ResourceRegistry::upload(UploadManager& uploadManager, ResourceHandle handle, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size) {
+	UploadTicket ticket = uploadManager.upload(buffer(handle), dstOffset, data, size);
+	markUploaded(handle, ticket);
+	return ticket;
+}
+
+void ResourceRegistry::release(ResourceHandle handle) {
+	Resource& resource = _resources[resolve(handle)];
+	//the deletion owns the objects now, the slot can be handed out again right away
+	vk::Buffer buffer = resource.buffer;
+	vk::Image image = resource.image;
+	Allocation allocation = resource.allocation;
+	//a copy still recorded in the open upload batch only completes once that batch is flushed
+	_deletionQueue->push(resource.lastUse, allocation.size, [this, buffer, image, allocation]() mutable {
+		if (buffer) {
+			destroyBuffer(*_allocator, _device, buffer, allocation);
+		} else {
+			destroyImage(*_allocator, _device, image, allocation);
+		}
+	}, resource.lastUpload);
+
+	resource = Resource();
+	resource.generation = handle.generation + 1 == 0 ? 1 : handle.generation + 1;
+	_freeIndices.push_back(handle.index);
+	_liveCount--;
+	_liveBytes -= allocation.size;
+}
+
+bool ResourceRegistry::alive(ResourceHandle handle) const {
+	return handle && handle.index < _resources.size() && _resources[handle.index].generation == handle.generation && _resources[handle.index].alive;
+}
+
+vk::Buffer ResourceRegistry::buffer(ResourceHandle handle) const {
+	return _resources[resolve(handle)].buffer;
+}
+
+vk::Image ResourceRegistry::image(ResourceHandle handle) const {
+	return _resources[resolve(handle)].image;
+}
+
+const Allocation& ResourceRegistry::allocation(ResourceHandle handle) const {
+	return _resources[resolve(handle)].allocation;
+}
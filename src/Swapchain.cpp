@@ -0,0 +1,186 @@
+#include "../include/Swapchain.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+
+bool parsePresentOption(const std::string& name, PresentPolicy& policy, std::optional<vk::PresentModeKHR>& presentMode) {
+	if (name == "latency") {
+		policy = PresentPolicy::eLowLatency;
+	} else if (name == "power") {
+		policy = PresentPolicy::eLowPower;
+	} else if (name == "mailbox") {
+		presentMode = vk::PresentModeKHR::eMailbox;
+	} else if (name == "immediate") {
+		presentMode = vk::PresentModeKHR::eImmediate;
+	} else if (name == "fifo") {
+		presentMode = vk::PresentModeKHR::eFifo;
+	} else if (name == "fifo-relaxed") {
+		presentMode = vk::PresentModeKHR::eFifoRelaxed;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+vk::SurfaceFormatKHR Swapchain::chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& available, vk::Format preferred) {
+	for (const vk::SurfaceFormatKHR& surfaceFormat : available) {
+		if (surfaceFormat.format == preferred && surfaceFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+			return surfaceFormat;
+		}
+	}
+	//a single undefined entry means any format goes
+	if (available.empty() || (available.size() == 1 && available[0].format == vk::Format::eUndefined)) {
+		return vk::SurfaceFormatKHR(preferred, vk::ColorSpaceKHR::eSrgbNonlinear);
+	}
+	return available[0];
+}
+
+vk::PresentModeKHR Swapchain::choosePresentMode(const std::vector<vk::PresentModeKHR>& available, PresentPolicy policy, std::optional<vk::PresentModeKHR> requested) {
+	auto supported = [&](vk::PresentModeKHR presentMode) { return std::find(available.begin(), available.end(), presentMode) != available.end(); };
+	if (requested && supported(*requested)) {
+		return *requested;
+	}
+	if (requested) {
+		std::cout << "Present mode " << vk::to_string(*requested) << " not supported, falling back to the policy" << std::endl;
+	}
+
+	std::array<vk::PresentModeKHR, 2> lowLatency = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+	std::array<vk::PresentModeKHR, 2> lowPower = { vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo };
+	for (vk::PresentModeKHR presentMode : policy == PresentPolicy::eLowLatency ? lowLatency : lowPower) {
+		if (supported(presentMode)) {
+			return presentMode;
+		}
+	}
+	return vk::PresentModeKHR::eFifo;
+}
+
+uint32_t Swapchain::chooseImageCount(const vk::SurfaceCapabilitiesKHR& capabilities, vk::PresentModeKHR presentMode) {
+	uint32_t imageCount = capabilities.minImageCount + 1;
+	//Mailbox replaces the queued image, so it needs one on screen, one queued and one to render into.
+	//Immediate never queues, every extra image would only add memory.
+	if (presentMode == vk::PresentModeKHR::eMailbox) {
+		imageCount = std::max(imageCount, 3u);
+	} else if (presentMode == vk::PresentModeKHR::eImmediate) {
+		imageCount = std::max(capabilities.minImageCount, 2u);
+	}
+	if (capabilities.maxImageCount > 0) {
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
+	}
+	return imageCount;
+}
+
+vk::Extent2D Swapchain::chooseExtent(const vk::SurfaceCapabilitiesKHR& capabilities, vk::Extent2D windowExtent) {
+	if (capabilities.currentExtent.width != UINT32_MAX) {
+		return capabilities.currentExtent;
+	}
+	return vk::Extent2D(
+		std::clamp(windowExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
+		std::clamp(windowExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height));
+}
+
+bool Swapchain::presentWaitSupported(vk::PhysicalDevice physicalDevice) {
+	bool presentId = false, presentWait = false;
+	for (const vk::ExtensionProperties& extension : physicalDevice.enumerateDeviceExtensionProperties()) {
+		presentId |= strcmp(extension.extensionName.data(), VK_KHR_PRESENT_ID_EXTENSION_NAME) == 0;
+		presentWait |= strcmp(extension.extensionName.data(), VK_KHR_PRESENT_WAIT_EXTENSION_NAME) == 0;
+	}
+	if (!presentId || !presentWait) {
+		return false;
+	}
+	vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures({});
+	vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures({});
+	presentIdFeatures.setPNext(&presentWaitFeatures);
+	vk::PhysicalDeviceFeatures2 features2({});
+	features2.setPNext(&presentIdFeatures);
+	physicalDevice.getFeatures2(&features2);
+	return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+}
+
+void Swapchain::init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, vk::Format preferredFormat, PresentPolicy policy, std::optional<vk::PresentModeKHR> requestedPresentMode, bool presentWait) {
+	_physicalDevice = physicalDevice;
+	_device = device;
+	_surface = surface;
+	if (presentWait) {
+		_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(_device.getProcAddr("vkWaitForPresentKHR"));
+	}
+
+	_surfaceFormat = chooseSurfaceFormat(_physicalDevice.getSurfaceFormatsKHR(_surface), preferredFormat);
+	_presentMode = choosePresentMode(_physicalDevice.getSurfacePresentModesKHR(_surface), policy, requestedPresentMode);
+	std::cout << "Swapchain: " << vk::to_string(_surfaceFormat.format) << ", " << vk::to_string(_presentMode) << std::endl;
+}
+
+bool Swapchain::recreate(vk::Extent2D windowExtent, RetiredSwapchain& retired) {
+	vk::SurfaceCapabilitiesKHR capabilities = _physicalDevice.getSurfaceCapabilitiesKHR(_surface);
+	vk::Extent2D extent = chooseExtent(capabilities, windowExtent);
+	if (extent.width == 0 || extent.height == 0) {
+		return false;
+	}
+
+	vk::CompositeAlphaFlagBitsKHR compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
+	for (vk::CompositeAlphaFlagBitsKHR candidate : { vk::CompositeAlphaFlagBitsKHR::eOpaque, vk::CompositeAlphaFlagBitsKHR::eInherit, vk::CompositeAlphaFlagBitsKHR::ePreMultiplied, vk::CompositeAlphaFlagBitsKHR::ePostMultiplied }) {
+		if (capabilities.supportedCompositeAlpha & candidate) {
+			compositeAlpha = candidate;
+			break;
+		}
+	}
+
+	vk::SwapchainCreateInfoKHR swapchainCreateInfo({});
+	swapchainCreateInfo.setSurface(_surface);
+	swapchainCreateInfo.setMinImageCount(chooseImageCount(capabilities, _presentMode));
+	swapchainCreateInfo.setImageFormat(_surfaceFormat.format);
+	swapchainCreateInfo.setImageColorSpace(_surfaceFormat.colorSpace);
+	swapchainCreateInfo.setImageExtent(extent);
+	swapchainCreateInfo.setImageArrayLayers(1);
+	swapchainCreateInfo.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment);
+	swapchainCreateInfo.setImageSharingMode(vk::SharingMode::eExclusive);
+	swapchainCreateInfo.setPreTransform(capabilities.currentTransform);
+	swapchainCreateInfo.setCompositeAlpha(compositeAlpha);
+	swapchainCreateInfo.setPresentMode(_presentMode);
+	swapchainCreateInfo.setClipped(VK_TRUE);
+	swapchainCreateInfo.setOldSwapchain(_swapchain);
+	vk::SwapchainKHR swapchain = _device.createSwapchainKHR(swapchainCreateInfo);
+
+	retired.swapchain = _swapchain;
+	retired.imageViews = std::move(_imageViews);
+	_recreateCount += _swapchain ? 1 : 0;
+	_swapchain = swapchain;
+	_extent = extent;
+	_images = _device.getSwapchainImagesKHR(_swapchain);
+
+	_imageViews.clear();
+	for (vk::Image image : _images) {
+		vk::ImageViewCreateInfo imageViewCreateInfo({});
+		imageViewCreateInfo.setImage(image);
+		imageViewCreateInfo.setViewType(vk::ImageViewType::e2D);
+		imageViewCreateInfo.setFormat(_surfaceFormat.format);
+		imageViewCreateInfo.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+		_imageViews.push_back(_device.createImageView(imageViewCreateInfo));
+	}
+	return true;
+}
+
+void Swapchain::destroyRetired(RetiredSwapchain& retired) {
+	for (vk::ImageView imageView : retired.imageViews) {
+		_device.destroyImageView(imageView);
+	}
+	retired.imageViews.clear();
+	if (retired.swapchain) {
+		_device.destroySwapchainKHR(retired.swapchain);
+		retired.swapchain = nullptr;
+	}
+}
+
+vk::Result Swapchain::waitForPresent(uint64_t presentId, uint64_t timeout) const {
+	if (!_waitForPresent) {
+		return vk::Result::eTimeout;
+	}
+	return static_cast<vk::Result>(_waitForPresent(_device, _swapchain, presentId, timeout));
+}
+
+void Swapchain::destroy() {
+	RetiredSwapchain current = { _swapchain, std::move(_imageViews) };
+	destroyRetired(current);
+	_swapchain = nullptr;
+	_images.clear();
+}
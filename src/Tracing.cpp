@@ -0,0 +1,173 @@
+#include "../include/Tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+//events are appended in fixed chunks that never move, so a reader can walk them while the owner appends
+constexpr uint64_t TRACE_CHUNK_EVENTS = 16384;
+constexpr uint64_t TRACE_MAX_CHUNKS = 256;
+
+struct TraceBuffer {
+	uint32_t threadId = 0;
+	std::string threadName;	// guarded by g_traceMutex
+	std::array<std::atomic<TraceEvent*>, TRACE_MAX_CHUNKS> chunks = {};
+	std::atomic<uint64_t> count{ 0 };	// published events, written by the owner only
+	std::atomic<uint64_t> dropped{ 0 };
+
+	~TraceBuffer() {
+		for (std::atomic<TraceEvent*>& chunk : chunks) {
+			delete[] chunk.load();
+		}
+	}
+};
+
+static std::mutex g_traceMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> g_traceBuffers;	// outlive their threads, a worker may exit before the trace is written
+static std::vector<TraceEvent> g_gpuEvents;
+static uint64_t g_traceStartNs = 0;
+static thread_local TraceBuffer* t_traceBuffer = nullptr;
+
+static TraceBuffer& threadBuffer() {
+	if (!t_traceBuffer) {
+		std::lock_guard<std::mutex> lock(g_traceMutex);
+		g_traceBuffers.push_back(std::make_unique<TraceBuffer>());
+		t_traceBuffer = g_traceBuffers.back().get();
+		t_traceBuffer->threadId = static_cast<uint32_t>(g_traceBuffers.size());
+		t_traceBuffer->threadName = std::format("thread {}", t_traceBuffer->threadId);
+	}
+	return *t_traceBuffer;
+}
+
+void startTracing() {
+	{
+		std::lock_guard<std::mutex> lock(g_traceMutex);
+		if (g_traceStartNs == 0) {
+			g_traceStartNs = traceNow();
+		}
+	}
+	g_tracingEnabled.store(true, std::memory_order_relaxed);
+}
+
+void stopTracing() {
+	g_tracingEnabled.store(false, std::memory_order_relaxed);
+}
+
+void setTraceThreadName(const std::string& name) {
+	TraceBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(g_traceMutex);
+	buffer.threadName = name;
+}
+
+void addTraceEvent(const char* name, uint64_t beginNs, uint64_t endNs) {
+	TraceBuffer& buffer = threadBuffer();
+	uint64_t index = buffer.count.load(std::memory_order_relaxed);
+	uint64_t chunkIndex = index / TRACE_CHUNK_EVENTS;
+	if (chunkIndex >= TRACE_MAX_CHUNKS) {
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	TraceEvent* chunk = buffer.chunks[chunkIndex].load(std::memory_order_relaxed);
+	if (!chunk) {
+		chunk = new TraceEvent[TRACE_CHUNK_EVENTS];
+		buffer.chunks[chunkIndex].store(chunk, std::memory_order_release);
+	}
+	chunk[index % TRACE_CHUNK_EVENTS] = { name, beginNs, endNs };
+	buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void addGpuTraceEvent(const char* name, uint64_t beginNs, uint64_t endNs) {
+	std::lock_guard<std::mutex> lock(g_traceMutex);
+	g_gpuEvents.push_back({ name, beginNs, endNs });
+}
+
+uint64_t traceEventCount() {
+	std::lock_guard<std::mutex> lock(g_traceMutex);
+	uint64_t count = g_gpuEvents.size();
+	for (const std::unique_ptr<TraceBuffer>& buffer : g_traceBuffers) {
+		count += buffer->count.load(std::memory_order_acquire);
+	}
+	return count;
+}
+
+uint64_t droppedTraceEventCount() {
+	std::lock_guard<std::mutex> lock(g_traceMutex);
+	uint64_t dropped = 0;
+	for (const std::unique_ptr<TraceBuffer>& buffer : g_traceBuffers) {
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	return dropped;
+}
+
+std::string escapeJson(const std::string& text) {
+	std::string escaped;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+	}
+	return escaped;
+}
+
+//one JSON object per line, separated by commas
+static void writeLine(std::ostream& out, const std::string& line, bool& first) {
+	out << (first ? "\t\t" : ",\n\t\t") << line;
+	first = false;
+}
+
+static void writeName(std::ostream& out, const char* metadata, uint32_t pid, uint32_t tid, const std::string& name, bool& first) {
+	writeLine(out, std::format("{{ \"name\": \"{}\", \"ph\": \"M\", \"pid\": {}, \"tid\": {}, \"args\": {{ \"name\": \"{}\" }} }}", metadata, pid, tid, escapeJson(name)), first);
+}
+
+static void writeEvent(std::ostream& out, uint32_t pid, uint32_t tid, const TraceEvent& event, bool& first) {
+	//microseconds since startTracing(), zones that began before it are clamped to the start
+	double begin = event.beginNs > g_traceStartNs ? (event.beginNs - g_traceStartNs) / 1000.0 : 0.0;
+	double end = event.endNs > g_traceStartNs ? (event.endNs - g_traceStartNs) / 1000.0 : 0.0;
+	writeLine(out, std::format("{{ \"name\": \"{}\", \"ph\": \"X\", \"pid\": {}, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f} }}",
+		escapeJson(event.name), pid, tid, begin, std::max(end - begin, 0.0)), first);
+}
+
+void writeTrace(std::ostream& out) {
+	const uint32_t cpuPid = 1;
+	const uint32_t gpuPid = 2;
+	std::lock_guard<std::mutex> lock(g_traceMutex);
+	out << "{" << std::endl;
+	out << "\t\"displayTimeUnit\": \"ms\"," << std::endl;
+	out << "\t\"traceEvents\": [" << std::endl;
+	bool first = true;
+	writeName(out, "process_name", cpuPid, 0, "CPU", first);
+	writeName(out, "process_name", gpuPid, 0, "GPU", first);
+	writeName(out, "thread_name", gpuPid, 0, "graphics queue", first);
+	for (const std::unique_ptr<TraceBuffer>& buffer : g_traceBuffers) {
+		writeName(out, "thread_name", cpuPid, buffer->threadId, buffer->threadName, first);
+	}
+
+	for (const std::unique_ptr<TraceBuffer>& buffer : g_traceBuffers) {
+		uint64_t count = buffer->count.load(std::memory_order_acquire);
+		for (uint64_t i = 0; i < count; i++) {
+			const TraceEvent* chunk = buffer->chunks[i / TRACE_CHUNK_EVENTS].load(std::memory_order_acquire);
+			writeEvent(out, cpuPid, buffer->threadId, chunk[i % TRACE_CHUNK_EVENTS], first);
+		}
+	}
+	for (const TraceEvent& event : g_gpuEvents) {
+		writeEvent(out, gpuPid, 0, event, first);
+	}
+	out << std::endl << "\t]" << std::endl;
+	out << "}" << std::endl;
+}
+
+void writeTrace(const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		throw std::runtime_error(std::format("failed to open trace file {}", path));
+	}
+	writeTrace(file);
+	if (!file) {
+		throw std::runtime_error(std::format("failed to write trace file {}", path));
+	}
+}
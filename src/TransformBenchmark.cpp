@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "../include/TransformSystem.hpp"
+
+// Compares TransformSystem against rebuilding every matrix with scalar glm, both writing
+// into an instance-buffer-like array (96 byte stride: mat4 + colour + position decode)
+const size_t OUTPUT_STRIDE = 96;
+const uint32_t GROUP_SIZE = 64;
+
+struct Scene {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<uint32_t> parents;
+};
+
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+	return std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// hierarchical: groups of GROUP_SIZE nodes, the first node of a group is the parent of the rest
+static Scene createScene(uint32_t count, bool hierarchical) {
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	Scene scene;
+	for (uint32_t i = 0; i < count; i++) {
+		scene.positions.push_back(glm::vec3(distribution(random), distribution(random), distribution(random)) * 100.0f);
+		scene.rotations.push_back(glm::normalize(glm::quat(distribution(random), distribution(random), distribution(random), distribution(random))));
+		scene.scales.push_back(glm::vec3(1.0f + 0.5f * distribution(random)));
+		scene.parents.push_back(hierarchical && i % GROUP_SIZE != 0 ? i - i % GROUP_SIZE : TransformSystem::NO_PARENT);
+	}
+	return scene;
+}
+
+static void updateScalar(const Scene& scene, std::vector<glm::mat4>& worlds, std::vector<uint8_t>& output) {
+	for (size_t i = 0; i < scene.positions.size(); i++) {
+		glm::mat4 local = glm::translate(glm::mat4(1.0f), scene.positions[i]) * glm::mat4_cast(scene.rotations[i]) * glm::scale(glm::mat4(1.0f), scene.scales[i]);
+		worlds[i] = scene.parents[i] == TransformSystem::NO_PARENT ? local : worlds[scene.parents[i]] * local;
+		memcpy(output.data() + i * OUTPUT_STRIDE, &worlds[i], sizeof(glm::mat4));
+	}
+}
+
+static void runCase(const std::string& name, uint32_t count, uint32_t iterations, bool hierarchical, uint32_t dirtyStride) {
+	Scene scene = createScene(count, hierarchical);
+	std::vector<glm::mat4> worlds(count);
+	std::vector<uint8_t> scalarOutput(count * OUTPUT_STRIDE), simdOutput(count * OUTPUT_STRIDE);
+
+	TransformSystem transformSystem;
+	transformSystem.reserve(count);
+	for (uint32_t i = 0; i < count; i++) {
+		transformSystem.add(scene.positions[i], scene.rotations[i], scene.scales[i], scene.parents[i]);
+	}
+	transformSystem.update();
+	transformSystem.write(simdOutput.data(), OUTPUT_STRIDE, 0, 0, count);
+
+	double scalarMs = 0.0, simdMs = 0.0;
+	uint32_t recomputed = 0;
+	glm::quat spin = glm::angleAxis(0.01f, glm::vec3(0.0f, 0.0f, 1.0f));
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		//the same nodes move on both sides, the scalar path has no dirty tracking and rebuilds everything
+		for (uint32_t i = (iteration * GROUP_SIZE) % dirtyStride; i < count; i += dirtyStride) {
+			scene.rotations[i] = spin * scene.rotations[i];
+			transformSystem.setRotation(i, scene.rotations[i]);
+		}
+
+		auto scalarStartTime = std::chrono::high_resolution_clock::now();
+		updateScalar(scene, worlds, scalarOutput);
+		scalarMs += millisecondsSince(scalarStartTime);
+
+		uint64_t writtenUpdate = transformSystem.updateCount();
+		auto simdStartTime = std::chrono::high_resolution_clock::now();
+		recomputed += transformSystem.update();
+		transformSystem.write(simdOutput.data(), OUTPUT_STRIDE, writtenUpdate, 0, count);
+		simdMs += millisecondsSince(simdStartTime);
+	}
+
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < count; i++) {
+		const float* scalarMatrix = reinterpret_cast<const float*>(scalarOutput.data() + i * OUTPUT_STRIDE);
+		const float* simdMatrix = reinterpret_cast<const float*>(simdOutput.data() + i * OUTPUT_STRIDE);
+		for (int j = 0; j < 16; j++) {
+			maxError = std::max(maxError, std::abs(scalarMatrix[j] - simdMatrix[j]));
+		}
+	}
+
+	std::cout << name << ": glm " << scalarMs / iterations << " ms, TransformSystem " << simdMs / iterations << " ms ("
+		<< scalarMs / simdMs << "x), " << recomputed / iterations << " recomputed per update, max error " << maxError << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	uint32_t count = 1000000;
+	uint32_t iterations = 20;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--count" && i + 1 < argc) {
+			count = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--iterations" && i + 1 < argc) {
+			iterations = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+		} else {
+			std::cout << "usage: " << argv[0] << " [--count N] [--iterations I]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << count << " transforms, " << iterations << " updates" << std::endl;
+	runCase("flat, all dirty", count, iterations, false, 1);
+	runCase("hierarchy, all dirty", count, iterations, true, 1);
+	runCase("hierarchy, 1% of roots dirty", count, iterations, true, 100 * GROUP_SIZE);
+	return 0;
+}
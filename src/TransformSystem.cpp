@@ -0,0 +1,257 @@
+#include "../include/TransformSystem.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SYSTEM_SSE
+#endif
+
+namespace {
+
+//one register worth of lanes, the kernels below are written once against these operators
+#if defined(__AVX__)
+constexpr uint32_t BATCH_WIDTH = 8;
+struct Batch { __m256 v; };
+inline Batch load(const float* p) { return { _mm256_loadu_ps(p) }; }
+inline void store(float* p, Batch a) { _mm256_storeu_ps(p, a.v); }
+inline Batch splat(float f) { return { _mm256_set1_ps(f) }; }
+inline Batch operator+(Batch a, Batch b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline Batch operator-(Batch a, Batch b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline Batch operator*(Batch a, Batch b) { return { _mm256_mul_ps(a.v, b.v) }; }
+#elif defined(TRANSFORM_SYSTEM_SSE)
+constexpr uint32_t BATCH_WIDTH = 4;
+struct Batch { __m128 v; };
+inline Batch load(const float* p) { return { _mm_loadu_ps(p) }; }
+inline void store(float* p, Batch a) { _mm_storeu_ps(p, a.v); }
+inline Batch splat(float f) { return { _mm_set1_ps(f) }; }
+inline Batch operator+(Batch a, Batch b) { return { _mm_add_ps(a.v, b.v) }; }
+inline Batch operator-(Batch a, Batch b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline Batch operator*(Batch a, Batch b) { return { _mm_mul_ps(a.v, b.v) }; }
+#else
+constexpr uint32_t BATCH_WIDTH = 1;
+struct Batch { float v; };
+inline Batch load(const float* p) { return { *p }; }
+inline void store(float* p, Batch a) { *p = a.v; }
+inline Batch splat(float f) { return { f }; }
+inline Batch operator+(Batch a, Batch b) { return { a.v + b.v }; }
+inline Batch operator-(Batch a, Batch b) { return { a.v - b.v }; }
+inline Batch operator*(Batch a, Batch b) { return { a.v * b.v }; }
+#endif
+
+const float IDENTITY[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+
+//3x4 affine product, row-major [row * 4 + column], the implicit fourth row is 0 0 0 1
+template<typename T>
+inline void multiplyAffine(const T* parent, const T* local, T* world) {
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 4; column++) {
+			T value = parent[row * 4] * local[column] + parent[row * 4 + 1] * local[4 + column] + parent[row * 4 + 2] * local[8 + column];
+			world[row * 4 + column] = column == 3 ? value + parent[row * 4 + 3] : value;
+		}
+	}
+}
+
+}
+
+void TransformSystem::reserve(uint32_t count) {
+	size_t padded = (count + BATCH_WIDTH - 1) / BATCH_WIDTH * BATCH_WIDTH;
+	for (std::vector<float>* array : { &_positionX, &_positionY, &_positionZ, &_rotationX, &_rotationY, &_rotationZ, &_rotationW, &_scaleX, &_scaleY, &_scaleZ }) {
+		array->reserve(padded);
+	}
+	for (std::vector<float>& array : _world) {
+		array.reserve(padded);
+	}
+	_dirty.reserve(padded);
+	_parents.reserve(count);
+	_changedUpdate.reserve(count);
+}
+
+void TransformSystem::resizeArrays(size_t count) {
+	//padding lanes hold an identity transform so the kernels never produce NaNs
+	size_t padded = (count + BATCH_WIDTH - 1) / BATCH_WIDTH * BATCH_WIDTH;
+	for (std::vector<float>* array : { &_positionX, &_positionY, &_positionZ, &_rotationX, &_rotationY, &_rotationZ }) {
+		array->resize(padded, 0.0f);
+	}
+	for (std::vector<float>* array : { &_rotationW, &_scaleX, &_scaleY, &_scaleZ }) {
+		array->resize(padded, 1.0f);
+	}
+	for (int i = 0; i < 12; i++) {
+		_world[i].resize(padded, IDENTITY[i]);
+	}
+	_dirty.resize(padded, 0);
+}
+
+uint32_t TransformSystem::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, uint32_t parent) {
+	uint32_t node = size();
+	if (parent != NO_PARENT && parent >= node) {
+		throw std::runtime_error("transform parent must be added before its children");
+	}
+
+	_parents.push_back(parent);
+	_changedUpdate.push_back(0);
+	if (_positionX.size() <= node) {
+		resizeArrays(node + 1);
+	}
+	setPosition(node, position);
+	setRotation(node, rotation);
+	setScale(node, scale);
+	return node;
+}
+
+void TransformSystem::setPosition(uint32_t node, const glm::vec3& position) {
+	_positionX[node] = position.x;
+	_positionY[node] = position.y;
+	_positionZ[node] = position.z;
+	_dirty[node] = 1;
+}
+
+void TransformSystem::setRotation(uint32_t node, const glm::quat& rotation) {
+	_rotationX[node] = rotation.x;
+	_rotationY[node] = rotation.y;
+	_rotationZ[node] = rotation.z;
+	_rotationW[node] = rotation.w;
+	_dirty[node] = 1;
+}
+
+void TransformSystem::setScale(uint32_t node, const glm::vec3& scale) {
+	_scaleX[node] = scale.x;
+	_scaleY[node] = scale.y;
+	_scaleZ[node] = scale.z;
+	_dirty[node] = 1;
+}
+
+uint32_t TransformSystem::update() {
+	_updateCount++;
+	uint32_t count = size();
+
+	//a changed parent dirties its whole subtree, parents come first so one pass is enough
+	for (uint32_t node = 0; node < count; node++) {
+		uint32_t parent = _parents[node];
+		if (parent != NO_PARENT && _dirty[parent]) {
+			_dirty[node] = 1;
+		}
+	}
+
+	uint32_t recomputed = 0;
+	for (uint32_t first = 0; first < count; first += BATCH_WIDTH) {
+		uint32_t last = std::min(first + BATCH_WIDTH, count);
+		bool anyDirty = false;
+		for (uint32_t node = first; node < last; node++) {
+			anyDirty |= _dirty[node] != 0;
+		}
+		if (!anyDirty) {
+			continue;
+		}
+
+		//clean lanes are recomputed too, their inputs did not change so neither does the result
+		updateBatch(first);
+		for (uint32_t node = first; node < last; node++) {
+			if (_dirty[node]) {
+				_dirty[node] = 0;
+				_changedUpdate[node] = _updateCount;
+				recomputed++;
+			}
+		}
+	}
+	return recomputed;
+}
+
+void TransformSystem::updateBatch(uint32_t first) {
+	Batch x = load(&_rotationX[first]), y = load(&_rotationY[first]), z = load(&_rotationZ[first]), w = load(&_rotationW[first]);
+	Batch scaleX = load(&_scaleX[first]), scaleY = load(&_scaleY[first]), scaleZ = load(&_scaleZ[first]);
+	Batch one = splat(1.0f), two = splat(2.0f);
+
+	//T * R * S, rotation from the unit quaternion, columns scaled
+	Batch xx = x * x, yy = y * y, zz = z * z;
+	Batch xy = x * y, xz = x * z, yz = y * z;
+	Batch wx = w * x, wy = w * y, wz = w * z;
+	Batch local[12] = {
+		(one - two * (yy + zz)) * scaleX, two * (xy - wz) * scaleY, two * (xz + wy) * scaleZ, load(&_positionX[first]),
+		two * (xy + wz) * scaleX, (one - two * (xx + zz)) * scaleY, two * (yz - wx) * scaleZ, load(&_positionY[first]),
+		two * (xz - wy) * scaleX, two * (yz + wx) * scaleY, (one - two * (xx + yy)) * scaleZ, load(&_positionZ[first])
+	};
+
+	uint32_t last = std::min(first + BATCH_WIDTH, size());
+	bool allRoots = true, parentsReady = true;
+	for (uint32_t node = first; node < last; node++) {
+		uint32_t parent = _parents[node];
+		allRoots &= parent == NO_PARENT;
+		parentsReady &= parent == NO_PARENT || parent < first;
+	}
+
+	if (allRoots) {
+		for (int i = 0; i < 12; i++) {
+			store(&_world[i][first], local[i]);
+		}
+		return;
+	}
+
+	if (parentsReady) {
+		//gather the parents' world matrices into lanes, roots get the identity
+		alignas(32) float gathered[12][BATCH_WIDTH];
+		for (uint32_t lane = 0; lane < BATCH_WIDTH; lane++) {
+			uint32_t parent = first + lane < last ? _parents[first + lane] : NO_PARENT;
+			for (int i = 0; i < 12; i++) {
+				gathered[i][lane] = parent == NO_PARENT ? IDENTITY[i] : _world[i][parent];
+			}
+		}
+		Batch parentWorld[12];
+		for (int i = 0; i < 12; i++) {
+			parentWorld[i] = load(gathered[i]);
+		}
+
+		Batch world[12];
+		multiplyAffine(parentWorld, local, world);
+		for (int i = 0; i < 12; i++) {
+			store(&_world[i][first], world[i]);
+		}
+		return;
+	}
+
+	//a parent inside this batch: finish lane by lane in order, so the parent is done first
+	alignas(32) float locals[12][BATCH_WIDTH];
+	for (int i = 0; i < 12; i++) {
+		store(locals[i], local[i]);
+	}
+	for (uint32_t node = first; node < last; node++) {
+		uint32_t lane = node - first;
+		float localLane[12], parentLane[12], worldLane[12];
+		for (int i = 0; i < 12; i++) {
+			localLane[i] = locals[i][lane];
+			parentLane[i] = _parents[node] == NO_PARENT ? IDENTITY[i] : _world[i][_parents[node]];
+		}
+		multiplyAffine(parentLane, localLane, worldLane);
+		for (int i = 0; i < 12; i++) {
+			_world[i][node] = worldLane[i];
+		}
+	}
+}
+
+void TransformSystem::write(void* output, size_t stride, uint64_t sinceUpdate, uint32_t first, uint32_t last) const {
+	uint8_t* bytes = static_cast<uint8_t*>(output);
+	for (uint32_t node = first; node < last; node++) {
+		if (_changedUpdate[node] <= sinceUpdate) {
+			continue;
+		}
+		float* matrix = reinterpret_cast<float*>(bytes + node * stride);
+		for (int column = 0; column < 4; column++) {
+			matrix[column * 4] = _world[column][node];
+			matrix[column * 4 + 1] = _world[4 + column][node];
+			matrix[column * 4 + 2] = _world[8 + column][node];
+			matrix[column * 4 + 3] = column == 3 ? 1.0f : 0.0f;
+		}
+	}
+}
+
+glm::mat4 TransformSystem::worldMatrix(uint32_t node) const {
+	glm::mat4 matrix(1.0f);
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 4; column++) {
+			matrix[column][row] = _world[row * 4 + column][node];
+		}
+	}
+	return matrix;
+}
@@ -0,0 +1,46 @@
+#include "../include/UniformAllocator.hpp"
+#include "../include/Utilities.hpp"
+#include <algorithm>
+#include <format>
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void UniformAllocator::init(vk::PhysicalDevice physicalDevice, vk::Device device, MemoryAllocator& allocator, vk::DeviceSize regionSize, uint32_t frameCount, const std::vector<uint32_t>& queueFamilyIndices) {
+	_device = device;
+	_allocator = &allocator;
+
+	//allocations may also be read through storage buffer descriptors (bindless), respect both alignments
+	vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+	_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+	_regionSize = alignUp(regionSize, _alignment);
+	if (_regionSize * frameCount > UINT32_MAX) {
+		throw std::runtime_error(std::format("uniform allocator of {} bytes does not fit 32 bit dynamic offsets", _regionSize * frameCount));
+	}
+
+	createBuffer(allocator, _device, _regionSize * frameCount, vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, _buffer, _allocation, AllocationStrategy::eBuddy, queueFamilyIndices);
+	beginFrame(0);
+}
+
+void UniformAllocator::destroy() {
+	destroyBuffer(*_allocator, _device, _buffer, _allocation);
+}
+
+void UniformAllocator::beginFrame(uint32_t frame) {
+	_regionOffset = frame * _regionSize;
+	_cursor = 0;
+}
+
+UniformAllocation UniformAllocator::allocate(vk::DeviceSize size) {
+	vk::DeviceSize alignedSize = alignUp(size, _alignment);
+	vk::DeviceSize offset = _cursor.fetch_add(alignedSize, std::memory_order_relaxed);
+	if (offset + alignedSize > _regionSize) {
+		throw std::runtime_error(std::format("uniform region of {} bytes exhausted", _regionSize));
+	}
+
+	UniformAllocation allocation;
+	allocation.offset = static_cast<uint32_t>(_regionOffset + offset);
+	allocation.data = static_cast<uint8_t*>(_allocation.mapped) + _regionOffset + offset;
+	return allocation;
+}
@@ -0,0 +1,192 @@
+#include "../include/UploadManager.hpp"
+#include "../include/Utilities.hpp"
+#include "../include/Tracing.hpp"
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void UploadManager::init(vk::Device device, MemoryAllocator& allocator, uint32_t queueFamilyIndex, vk::Queue queue, vk::DeviceSize stagingSize) {
+	_device = device;
+	_allocator = &allocator;
+	_queueFamilyIndex = queueFamilyIndex;
+	_queue = queue;
+	_stagingSize = stagingSize;
+
+	vk::CommandPoolCreateInfo commandPoolCreateInfo({});
+	commandPoolCreateInfo.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
+	commandPoolCreateInfo.setQueueFamilyIndex(queueFamilyIndex);
+	_commandPool = _device.createCommandPool(commandPoolCreateInfo);
+
+	vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, 0);
+	vk::SemaphoreCreateInfo semaphoreCreateInfo({});
+	semaphoreCreateInfo.setPNext(&semaphoreTypeCreateInfo);
+	_timelineSemaphore = _device.createSemaphore(semaphoreCreateInfo);
+
+	createBuffer(*_allocator, _device, _stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, _stagingBuffer, _stagingAllocation);
+}
+
+void UploadManager::destroy() {
+	flush();
+	if (!_inFlight.empty()) {
+		wait(_inFlight.back().ticket);
+	}
+
+	destroyBuffer(*_allocator, _device, _stagingBuffer, _stagingAllocation);
+	_device.destroySemaphore(_timelineSemaphore);
+	_device.destroyCommandPool(_commandPool);
+	_freeCommandBuffers.clear();
+}
+
+UploadTicket UploadManager::upload(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size) {
+	const char* src = static_cast<const char*>(data);
+
+	//uploads larger than half the ring are split so they can stream through it
+	vk::DeviceSize maxChunkSize = _stagingSize / 2;
+	while (size > 0) {
+		vk::DeviceSize chunkSize = std::min(size, maxChunkSize);
+		vk::DeviceSize stagingOffset = reserve(chunkSize, 16);
+
+		if (!_recording.commandBuffer) {
+			beginRecording();
+		}
+		memcpy(static_cast<char*>(_stagingAllocation.mapped) + stagingOffset, src, (size_t) chunkSize);
+
+		vk::BufferCopy copyRegion(stagingOffset, dstOffset, chunkSize);
+		_recording.commandBuffer.copyBuffer(_stagingBuffer, dstBuffer, copyRegion);
+		_copyCount++;
+
+		src += chunkSize;
+		dstOffset += chunkSize;
+		size -= chunkSize;
+	}
+
+	//the last chunk always lives in the batch currently being recorded
+	return _nextTicket;
+}
+
+UploadTicket UploadManager::flush() {
+	TRACE_FUNCTION();
+	if (!_recording.commandBuffer) {
+		return _nextTicket - 1;
+	}
+
+	_recording.commandBuffer.end();
+	_recording.ticket = _nextTicket++;
+
+	vk::TimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo({});
+	timelineSemaphoreSubmitInfo.setSignalSemaphoreValues(_recording.ticket);
+
+	vk::SubmitInfo submitInfo({});
+	submitInfo.setCommandBuffers(_recording.commandBuffer);
+	submitInfo.setSignalSemaphores(_timelineSemaphore);
+	submitInfo.setPNext(&timelineSemaphoreSubmitInfo);
+
+	_queue.submit(submitInfo, nullptr);
+	_submitCount++;
+
+	_inFlight.push_back(_recording);
+	_recording = Batch();
+	return _inFlight.back().ticket;
+}
+
+bool UploadManager::isComplete(UploadTicket ticket) {
+	if (ticket <= _completedTicket) {
+		return true;
+	}
+	_completedTicket = _device.getSemaphoreCounterValue(_timelineSemaphore);
+	return ticket <= _completedTicket;
+}
+
+UploadTicket UploadManager::completedTicket() {
+	_completedTicket = _device.getSemaphoreCounterValue(_timelineSemaphore);
+	return _completedTicket;
+}
+
+void UploadManager::wait(UploadTicket ticket) {
+	//waiting on the batch still being recorded would never finish
+	if (ticket >= _nextTicket) {
+		flush();
+	}
+
+	if (!isComplete(ticket)) {
+		vk::SemaphoreWaitInfo semaphoreWaitInfo({}, _timelineSemaphore, ticket);
+		vk::Result waitResult = _device.waitSemaphores(semaphoreWaitInfo, UINT64_MAX);
+		if (waitResult != vk::Result::eSuccess) {
+			std::string err = std::format("upload wait failure: {} ", vk::to_string(waitResult));
+			throw std::runtime_error(err);
+		}
+	}
+	retireCompleted();
+}
+
+vk::DeviceSize UploadManager::reserve(vk::DeviceSize size, vk::DeviceSize alignment) {
+	vk::DeviceSize offset;
+	vk::DeviceSize neededBytes;
+
+	for (;;) {
+		retireCompleted();
+		if (_ringUsed == 0) {
+			_ringHead = 0;
+		}
+
+		offset = alignUp(_ringHead, alignment);
+		if (offset + size > _stagingSize) {
+			//not enough room before the end of the ring, skip the tail and wrap around
+			neededBytes = _stagingSize - _ringHead + size;
+			offset = 0;
+		} else {
+			neededBytes = offset - _ringHead + size;
+		}
+
+		if (_ringUsed + neededBytes <= _stagingSize) {
+			break;
+		}
+
+		//ring is full: submit what we have and reclaim the oldest batch
+		if (_inFlight.empty()) {
+			flush();
+		} else {
+			retireOldest();
+		}
+	}
+
+	_ringHead = offset + size;
+	_ringUsed += neededBytes;
+	_recording.ringBytes += neededBytes;
+	return offset;
+}
+
+void UploadManager::beginRecording() {
+	if (_freeCommandBuffers.empty()) {
+		vk::CommandBufferAllocateInfo commandBufferAllocateInfo({});
+		commandBufferAllocateInfo.setCommandPool(_commandPool);
+		commandBufferAllocateInfo.setLevel(vk::CommandBufferLevel::ePrimary);
+		commandBufferAllocateInfo.setCommandBufferCount(1);
+		_recording.commandBuffer = _device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+	} else {
+		_recording.commandBuffer = _freeCommandBuffers.back();
+		_freeCommandBuffers.pop_back();
+		_recording.commandBuffer.reset();
+	}
+
+	vk::CommandBufferBeginInfo commandBufferBeginInfo({});
+	commandBufferBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	_recording.commandBuffer.begin(commandBufferBeginInfo);
+}
+
+void UploadManager::retireCompleted() {
+	while (!_inFlight.empty() && isComplete(_inFlight.front().ticket)) {
+		_ringUsed -= _inFlight.front().ringBytes;
+		_freeCommandBuffers.push_back(_inFlight.front().commandBuffer);
+		_inFlight.pop_front();
+	}
+}
+
+void UploadManager::retireOldest() {
+	wait(_inFlight.front().ticket);
+}
@@ -1,37 +1,14 @@
-#pragma once
 #include "../include/Utilities.hpp"
+#include <format>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <stdexcept>
 
-extern vk::PhysicalDevice selectPhysicalDevice(vk::Instance& instance) {
-	auto physicalDevices = instance.enumeratePhysicalDevices();
-	vk::PhysicalDevice selectedPhysicalDevice;
-	
-	//Available Devices 
-	std::cout << "Available Devices: " << std::endl;
-	for (vk::PhysicalDevice physicalDevice : physicalDevices) {
-		std::cout << physicalDevice.getProperties2().properties.deviceName << std::endl;
-		if (physicalDevice.getProperties2().properties.apiVersion >= vk::ApiVersion13) {
-			selectedPhysicalDevice = physicalDevice;
-		}					
-	}
-	std::cout << std::endl;
-	
-	{
-		auto properties = selectedPhysicalDevice.getProperties2().properties;
-		std::cout << "Selected Device: " << properties.deviceName << std::endl;
-		std::cout << "driverVersion: " << properties.driverVersion << std::endl;
-		std::cout << std::endl;			
-	}
-	return selectedPhysicalDevice;
-}
-
 std::vector<uint32_t> readShader(const std::string& filename) {
 	std::ifstream file(filename, std::ios::binary | std::ios::ate);
 	if (!file.is_open()) {
-		throw std::runtime_error("Failed to open SPIR-V Shader file.");
+		throw std::runtime_error(std::format("Failed to open SPIR-V shader {}, build the Shaders target and run from the build directory", filename));
 	}
 
 	size_t fileSize = file.tellg();
@@ -44,71 +21,63 @@ std::vector<uint32_t> readShader(const std::string& filename) {
 	return buffer;
 }
 
-void createBuffer(vk::PhysicalDevice &physicalDevice, vk::Device &device, vk::DeviceSize bufferSize, vk::BufferUsageFlags bufferUsageFlags, vk::MemoryPropertyFlags memoryPropertyFlags, vk::Buffer& buffer, vk::DeviceMemory& deviceMemory) {
+void createBuffer(MemoryAllocator& allocator, vk::Device& device, vk::DeviceSize bufferSize, vk::BufferUsageFlags bufferUsageFlags, vk::MemoryPropertyFlags memoryPropertyFlags, vk::Buffer& buffer, Allocation& allocation, AllocationStrategy allocationStrategy, const std::vector<uint32_t>& queueFamilyIndices) {
 	vk::BufferCreateInfo bufferCreateInfo({});
 	bufferCreateInfo.setSize(bufferSize);
 	bufferCreateInfo.setUsage(bufferUsageFlags);
 	bufferCreateInfo.setSharingMode(vk::SharingMode::eExclusive);
+	//buffers touched by more than one queue family are shared instead of ownership transferred
+	if (queueFamilyIndices.size() > 1) {
+		bufferCreateInfo.setSharingMode(vk::SharingMode::eConcurrent);
+		bufferCreateInfo.setQueueFamilyIndices(queueFamilyIndices);
+	}
 
 	buffer = device.createBuffer(bufferCreateInfo);
 
 	vk::MemoryRequirements memoryRequirements;
 	device.getBufferMemoryRequirements(buffer, &memoryRequirements);
 
-	vk::MemoryAllocateInfo memoryAllocateInfo({});
-	memoryAllocateInfo.setAllocationSize(memoryRequirements.size);
-	memoryAllocateInfo.setMemoryTypeIndex(findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, memoryPropertyFlags));
-	deviceMemory = device.allocateMemory(memoryAllocateInfo);
+	allocation = allocator.allocate(memoryRequirements, memoryPropertyFlags, allocationStrategy);
 
-	device.bindBufferMemory(buffer, deviceMemory, 0);
+	device.bindBufferMemory(buffer, allocation.deviceMemory, allocation.offset);
 }
 
-void copyBuffer(vk::Device device, vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize deviceSize, vk::CommandPool commandPool, vk::Queue queue) {
-	vk::CommandBufferAllocateInfo allocInfo{};
-	allocInfo.setLevel(vk::CommandBufferLevel::ePrimary);
-	allocInfo.setCommandPool(commandPool);
-	allocInfo.setCommandBufferCount(1);
-
-	vk::CommandBuffer commandBuffer;
-	if (vk::Result::eSuccess != device.allocateCommandBuffers(&allocInfo, &commandBuffer)) {
-		throw std::runtime_error("failed allocating Command Buffers");
-	}
+void destroyBuffer(MemoryAllocator& allocator, vk::Device& device, vk::Buffer& buffer, Allocation& allocation) {
+	device.destroyBuffer(buffer);
+	buffer = nullptr;
+	allocator.free(allocation);
+}
 
-	vk::CommandBufferBeginInfo commandBufferBeginInfo({});
-	commandBufferBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-	commandBuffer.begin(commandBufferBeginInfo);
+void createImage(MemoryAllocator& allocator, vk::Device& device, const vk::ImageCreateInfo& imageCreateInfo, vk::MemoryPropertyFlags memoryPropertyFlags, vk::Image& image, Allocation& allocation) {
+	image = device.createImage(imageCreateInfo);
 
-	vk::BufferCopy copyRegion({});
-	copyRegion.setSize(deviceSize);
+	vk::MemoryRequirements memoryRequirements = device.getImageMemoryRequirements(image);
+	allocation = allocator.allocate(memoryRequirements, memoryPropertyFlags, AllocationStrategy::eBuddy, imageCreateInfo.tiling == vk::ImageTiling::eOptimal);
 
-	commandBuffer.copyBuffer(srcBuffer, dstBuffer, copyRegion);
-	commandBuffer.end();
+	device.bindImageMemory(image, allocation.deviceMemory, allocation.offset);
+}
 
-	vk::SubmitInfo submitInfo({});
-	submitInfo.setCommandBuffers(commandBuffer);
-	
-	queue.submit(submitInfo, nullptr);
-	queue.waitIdle();
+void destroyImage(MemoryAllocator& allocator, vk::Device& device, vk::Image& image, Allocation& allocation) {
+	device.destroyImage(image);
+	image = nullptr;
+	allocator.free(allocation);
+}
 
-	device.freeCommandBuffers(commandPool, commandBuffer);
+vk::VertexInputBindingDescription vertexBindingDescription(const VertexLayout& layout) {
+	return vk::VertexInputBindingDescription(0, layout.stride(), vk::VertexInputRate::eVertex);
 }
 
-//uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags memoryPropertyFlags) {
-//	vk::PhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-//	
-//	for (auto x : physicalDeviceMemoryProperties.memoryTypes) {
-//		x.propertyFlags. vk::MemoryPropertyFlagBits::eHostCoherent;
-//	}
-//	physicalDeviceMemoryProperties.memoryTypes
-//}
-
-uint32_t findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
-	vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
+std::vector<vk::VertexInputAttributeDescription> vertexAttributeDescriptions(const VertexLayout& layout) {
+	const vk::Format positionFormats[] = { vk::Format::eR32G32B32Sfloat, vk::Format::eR16G16B16A16Sfloat, vk::Format::eR16G16B16A16Snorm };
+	const vk::Format colorFormats[] = { vk::Format::eR32G32B32Sfloat, vk::Format::eR8G8B8A8Unorm, vk::Format::eA2B10G10R10UnormPack32 };
+	const vk::Format normalFormats[] = { vk::Format::eUndefined, vk::Format::eR16G16Snorm, vk::Format::eR8G8Snorm };
+
+	std::vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+		vk::VertexInputAttributeDescription(0, 0, positionFormats[static_cast<uint32_t>(layout.position)], 0),
+		vk::VertexInputAttributeDescription(1, 0, colorFormats[static_cast<uint32_t>(layout.color)], layout.colorOffset())
+	};
+	if (layout.normal != NormalEncoding::eNone) {
+		attributeDescriptions.push_back(vk::VertexInputAttributeDescription(2, 0, normalFormats[static_cast<uint32_t>(layout.normal)], layout.normalOffset()));
 	}
-	throw std::runtime_error("Failed to find suitable memory type!");
+	return attributeDescriptions;
 }
-
@@ -0,0 +1,415 @@
+#include "../include/VertexLayout.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VERTEX_LAYOUT_SSE
+#endif
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define VERTEX_LAYOUT_F16C
+#endif
+
+namespace {
+
+const char* POSITION_NAMES[] = { "float", "half", "snorm16" };
+const char* COLOR_NAMES[] = { "float", "unorm8", "unorm10" };
+const char* NORMAL_NAMES[] = { "none", "oct16", "oct8" };
+const uint32_t POSITION_SIZES[] = { 12, 8, 8 };
+const uint32_t COLOR_SIZES[] = { 12, 4, 4 };
+const uint32_t NORMAL_SIZES[] = { 0, 4, 2 };
+
+const uint16_t HALF_ONE = 0x3c00;
+const int16_t SNORM16_ONE = 32767;
+
+//round to nearest even, like the SSE conversions with the default rounding mode
+inline int32_t quantize(float value, float minimum, float maximum, float range) {
+	return static_cast<int32_t>(std::nearbyint(std::clamp(value, minimum, maximum) * range));
+}
+
+uint16_t floatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+	if (exponent == 0xff) {
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+
+	int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+	if (halfExponent >= 31) {
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+	uint32_t half, rest, halfway;
+	if (halfExponent <= 0) {
+		//subnormal half
+		if (halfExponent < -10) {
+			return static_cast<uint16_t>(sign);
+		}
+		uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+		mantissa |= 0x800000;
+		half = mantissa >> shift;
+		rest = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	} else {
+		half = static_cast<uint32_t>(halfExponent) << 10 | mantissa >> 13;
+		rest = mantissa & 0x1fff;
+		halfway = 0x1000;
+	}
+	//a carry out of the mantissa correctly bumps the exponent
+	if (rest > halfway || (rest == halfway && (half & 1))) {
+		half++;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t half) {
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+	float magnitude;
+	if (exponent == 0) {
+		magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+	} else if (exponent == 31) {
+		magnitude = mantissa ? NAN : INFINITY;
+	} else {
+		magnitude = std::ldexp(static_cast<float>(mantissa | 0x400), static_cast<int>(exponent) - 25);
+	}
+	return (half & 0x8000) ? -magnitude : magnitude;
+}
+
+// Octahedral projection onto [-1, 1]^2, the lower hemisphere folded over the diagonals
+void octahedralEncode(const float* normal, float& u, float& v) {
+	float length = std::max(std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]), FLT_MIN);
+	u = normal[0] / length;
+	v = normal[1] / length;
+	if (normal[2] < 0.0f) {
+		float foldedU = (1.0f - std::abs(v)) * std::copysign(1.0f, u);
+		float foldedV = (1.0f - std::abs(u)) * std::copysign(1.0f, v);
+		u = foldedU;
+		v = foldedV;
+	}
+}
+
+void octahedralDecode(float u, float v, float* normal) {
+	float z = 1.0f - std::abs(u) - std::abs(v);
+	if (z < 0.0f) {
+		float unfoldedU = (1.0f - std::abs(v)) * std::copysign(1.0f, u);
+		float unfoldedV = (1.0f - std::abs(u)) * std::copysign(1.0f, v);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+	float length = std::sqrt(u * u + v * v + z * z);
+	normal[0] = u / length;
+	normal[1] = v / length;
+	normal[2] = z / length;
+}
+
+// Reference encoder for one vertex, used for the tail and the whole path without SSE
+void encodeVertex(const VertexLayout& layout, const float* position, const float* color, const float* normal, const PositionDecode& decode, uint8_t* output) {
+	float inverseScale = 1.0f / decode.scale;
+	if (layout.position == PositionEncoding::eFloat32) {
+		memcpy(output, position, 3 * sizeof(float));
+	} else {
+		uint16_t encoded[4];
+		for (int axis = 0; axis < 3; axis++) {
+			float relative = (position[axis] - decode.offset[axis]) * inverseScale;
+			encoded[axis] = layout.position == PositionEncoding::eHalf ? floatToHalf(relative) : static_cast<uint16_t>(quantize(relative, -1.0f, 1.0f, SNORM16_ONE));
+		}
+		encoded[3] = layout.position == PositionEncoding::eHalf ? HALF_ONE : static_cast<uint16_t>(SNORM16_ONE);
+		memcpy(output, encoded, sizeof(encoded));
+	}
+
+	uint8_t* colorOutput = output + layout.colorOffset();
+	if (layout.color == ColorEncoding::eFloat32) {
+		memcpy(colorOutput, color, 3 * sizeof(float));
+	} else {
+		uint32_t packed;
+		if (layout.color == ColorEncoding::eUnorm8) {
+			packed = static_cast<uint32_t>(quantize(color[0], 0.0f, 1.0f, 255.0f)) | static_cast<uint32_t>(quantize(color[1], 0.0f, 1.0f, 255.0f)) << 8
+				| static_cast<uint32_t>(quantize(color[2], 0.0f, 1.0f, 255.0f)) << 16 | 0xffu << 24;
+		} else {
+			packed = static_cast<uint32_t>(quantize(color[0], 0.0f, 1.0f, 1023.0f)) | static_cast<uint32_t>(quantize(color[1], 0.0f, 1.0f, 1023.0f)) << 10
+				| static_cast<uint32_t>(quantize(color[2], 0.0f, 1.0f, 1023.0f)) << 20 | 3u << 30;
+		}
+		memcpy(colorOutput, &packed, sizeof(packed));
+	}
+
+	if (layout.normal != NormalEncoding::eNone) {
+		float u, v;
+		octahedralEncode(normal, u, v);
+		uint8_t* normalOutput = output + layout.normalOffset();
+		if (layout.normal == NormalEncoding::eOctahedral16) {
+			int16_t encoded[2] = { static_cast<int16_t>(quantize(u, -1.0f, 1.0f, SNORM16_ONE)), static_cast<int16_t>(quantize(v, -1.0f, 1.0f, SNORM16_ONE)) };
+			memcpy(normalOutput, encoded, sizeof(encoded));
+		} else {
+			int8_t encoded[2] = { static_cast<int8_t>(quantize(u, -1.0f, 1.0f, 127.0f)), static_cast<int8_t>(quantize(v, -1.0f, 1.0f, 127.0f)) };
+			memcpy(normalOutput, encoded, sizeof(encoded));
+		}
+	}
+}
+
+#ifdef VERTEX_LAYOUT_SSE
+// Four xyz / rgb triples transposed into one register per component
+inline void loadTransposed(const float* source, __m128& x, __m128& y, __m128& z) {
+	x = _mm_setr_ps(source[0], source[3], source[6], source[9]);
+	y = _mm_setr_ps(source[1], source[4], source[7], source[10]);
+	z = _mm_setr_ps(source[2], source[5], source[8], source[11]);
+}
+
+inline __m128i quantize(__m128 value, __m128 minimum, __m128 maximum, __m128 range) {
+	return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(value, minimum), maximum), range));
+}
+
+// stores lane i (size bytes each) to output + i * stride, for up to four vertices
+inline void storeLanes(__m128i value, uint32_t size, uint8_t* output, size_t stride) {
+	alignas(16) uint8_t bytes[16];
+	_mm_store_si128(reinterpret_cast<__m128i*>(bytes), value);
+	for (uint32_t lane = 0; lane < std::min(16 / size, 4u); lane++) {
+		memcpy(output + lane * stride, bytes + lane * size, size);
+	}
+}
+
+// [x0..x3 y0..y3] and [z0..z3 w0..w3] 16 bit lanes into four xyzw vertices
+inline void storeInterleaved16(__m128i xy, __m128i zw, uint8_t* output, size_t stride) {
+	__m128i xz = _mm_unpacklo_epi16(xy, zw);
+	__m128i yw = _mm_unpackhi_epi16(xy, zw);
+	storeLanes(_mm_unpacklo_epi16(xz, yw), 8, output, stride);
+	storeLanes(_mm_unpackhi_epi16(xz, yw), 8, output + 2 * stride, stride);
+}
+
+// Encodes four vertices
+void encodeBlock(const VertexLayout& layout, const float* positions, const float* colors, const float* normals, const PositionDecode& decode, uint8_t* output) {
+	size_t stride = layout.stride();
+	__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+	__m128 x, y, z;
+
+	if (layout.position == PositionEncoding::eFloat32) {
+		for (uint32_t lane = 0; lane < 4; lane++) {
+			memcpy(output + lane * stride, positions + lane * 3, 3 * sizeof(float));
+		}
+	} else {
+		loadTransposed(positions, x, y, z);
+		__m128 inverseScale = _mm_set1_ps(1.0f / decode.scale);
+		x = _mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(decode.offset[0])), inverseScale);
+		y = _mm_mul_ps(_mm_sub_ps(y, _mm_set1_ps(decode.offset[1])), inverseScale);
+		z = _mm_mul_ps(_mm_sub_ps(z, _mm_set1_ps(decode.offset[2])), inverseScale);
+		__m128i xy, zw;
+		if (layout.position == PositionEncoding::eSnorm16) {
+			__m128 range = _mm_set1_ps(SNORM16_ONE);
+			xy = _mm_packs_epi32(quantize(x, minusOne, one, range), quantize(y, minusOne, one, range));
+			zw = _mm_packs_epi32(quantize(z, minusOne, one, range), _mm_set1_epi32(SNORM16_ONE));
+		} else {
+#ifdef VERTEX_LAYOUT_F16C
+			xy = _mm_unpacklo_epi64(_mm_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT), _mm_cvtps_ph(y, _MM_FROUND_TO_NEAREST_INT));
+			zw = _mm_unpacklo_epi64(_mm_cvtps_ph(z, _MM_FROUND_TO_NEAREST_INT), _mm_set1_epi16(static_cast<short>(HALF_ONE)));
+#else
+			alignas(16) float lanesX[4], lanesY[4], lanesZ[4];
+			_mm_store_ps(lanesX, x);
+			_mm_store_ps(lanesY, y);
+			_mm_store_ps(lanesZ, z);
+			xy = _mm_setr_epi16(floatToHalf(lanesX[0]), floatToHalf(lanesX[1]), floatToHalf(lanesX[2]), floatToHalf(lanesX[3]), floatToHalf(lanesY[0]), floatToHalf(lanesY[1]), floatToHalf(lanesY[2]), floatToHalf(lanesY[3]));
+			zw = _mm_setr_epi16(floatToHalf(lanesZ[0]), floatToHalf(lanesZ[1]), floatToHalf(lanesZ[2]), floatToHalf(lanesZ[3]), HALF_ONE, HALF_ONE, HALF_ONE, HALF_ONE);
+#endif
+		}
+		storeInterleaved16(xy, zw, output, stride);
+	}
+
+	uint8_t* colorOutput = output + layout.colorOffset();
+	if (layout.color == ColorEncoding::eFloat32) {
+		for (uint32_t lane = 0; lane < 4; lane++) {
+			memcpy(colorOutput + lane * stride, colors + lane * 3, 3 * sizeof(float));
+		}
+	} else if (layout.color == ColorEncoding::eUnorm8) {
+		loadTransposed(colors, x, y, z);
+		__m128 range = _mm_set1_ps(255.0f);
+		//bytes r0..r3 b0..b3 g0..g3 a0..a3, then two unpacks give rgba per vertex
+		__m128i rb = _mm_packs_epi32(quantize(x, zero, one, range), quantize(z, zero, one, range));
+		__m128i ga = _mm_packs_epi32(quantize(y, zero, one, range), _mm_set1_epi32(255));
+		__m128i planar = _mm_packus_epi16(rb, ga);
+		__m128i pairs = _mm_unpacklo_epi8(planar, _mm_srli_si128(planar, 8));
+		storeLanes(_mm_unpacklo_epi16(pairs, _mm_srli_si128(pairs, 8)), 4, colorOutput, stride);
+	} else {
+		loadTransposed(colors, x, y, z);
+		__m128 range = _mm_set1_ps(1023.0f);
+		__m128i packed = _mm_or_si128(quantize(x, zero, one, range), _mm_slli_epi32(quantize(y, zero, one, range), 10));
+		packed = _mm_or_si128(packed, _mm_slli_epi32(quantize(z, zero, one, range), 20));
+		packed = _mm_or_si128(packed, _mm_set1_epi32(static_cast<int>(3u << 30)));
+		storeLanes(packed, 4, colorOutput, stride);
+	}
+
+	if (layout.normal != NormalEncoding::eNone) {
+		loadTransposed(normals, x, y, z);
+		__m128 signMask = _mm_set1_ps(-0.0f);
+		__m128 length = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z));
+		length = _mm_max_ps(length, _mm_set1_ps(FLT_MIN));
+		__m128 u = _mm_div_ps(x, length), v = _mm_div_ps(y, length);
+
+		//lower hemisphere: (1 - |v|) * sign(u), (1 - |u|) * sign(v)
+		__m128 foldedU = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, v)), _mm_or_ps(_mm_and_ps(u, signMask), one));
+		__m128 foldedV = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, u)), _mm_or_ps(_mm_and_ps(v, signMask), one));
+		__m128 lower = _mm_cmplt_ps(z, zero);
+		u = _mm_or_ps(_mm_and_ps(lower, foldedU), _mm_andnot_ps(lower, u));
+		v = _mm_or_ps(_mm_and_ps(lower, foldedV), _mm_andnot_ps(lower, v));
+
+		uint8_t* normalOutput = output + layout.normalOffset();
+		if (layout.normal == NormalEncoding::eOctahedral16) {
+			__m128 range = _mm_set1_ps(SNORM16_ONE);
+			__m128i uv = _mm_packs_epi32(quantize(u, minusOne, one, range), quantize(v, minusOne, one, range));
+			storeLanes(_mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8)), 4, normalOutput, stride);
+		} else {
+			__m128 range = _mm_set1_ps(127.0f);
+			__m128i uv = _mm_packs_epi32(quantize(u, minusOne, one, range), quantize(v, minusOne, one, range));
+			__m128i pairs = _mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8));
+			storeLanes(_mm_packs_epi16(pairs, pairs), 2, normalOutput, stride);
+		}
+	}
+}
+#endif
+
+}
+
+uint32_t VertexLayout::colorOffset() const {
+	return POSITION_SIZES[static_cast<uint32_t>(position)];
+}
+
+uint32_t VertexLayout::normalOffset() const {
+	return colorOffset() + COLOR_SIZES[static_cast<uint32_t>(color)];
+}
+
+uint32_t VertexLayout::stride() const {
+	return (normalOffset() + NORMAL_SIZES[static_cast<uint32_t>(normal)] + 3) / 4 * 4;
+}
+
+VertexLayout VertexLayout::fromKey(uint32_t key) {
+	uint32_t position = key & 0xff, color = key >> 8 & 0xff, normal = key >> 16 & 0xff;
+	if (position > static_cast<uint32_t>(PositionEncoding::eSnorm16) || color > static_cast<uint32_t>(ColorEncoding::eUnorm10) || normal > static_cast<uint32_t>(NormalEncoding::eOctahedral8) || key >> 24 != 0) {
+		throw std::runtime_error(std::format("Unknown vertex layout {:#x}", key));
+	}
+	return { static_cast<PositionEncoding>(position), static_cast<ColorEncoding>(color), static_cast<NormalEncoding>(normal) };
+}
+
+std::string VertexLayout::name() const {
+	return std::format("{}/{}/{}", POSITION_NAMES[static_cast<uint32_t>(position)], COLOR_NAMES[static_cast<uint32_t>(color)], NORMAL_NAMES[static_cast<uint32_t>(normal)]);
+}
+
+PositionDecode computePositionDecode(const VertexLayout& layout, const VertexStreams& streams) {
+	PositionDecode decode;
+	if (layout.position == PositionEncoding::eFloat32 || streams.count == 0) {
+		return decode;
+	}
+
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t vertex = 0; vertex < streams.count; vertex++) {
+		for (int axis = 0; axis < 3; axis++) {
+			minimum[axis] = std::min(minimum[axis], streams.positions[vertex * 3 + axis]);
+			maximum[axis] = std::max(maximum[axis], streams.positions[vertex * 3 + axis]);
+		}
+	}
+	//one scale for all axes, so the decode stays a uniform scale the vertex shader applies with one multiply-add
+	float halfExtent = 0.0f;
+	for (int axis = 0; axis < 3; axis++) {
+		decode.offset[axis] = 0.5f * (minimum[axis] + maximum[axis]);
+		halfExtent = std::max(halfExtent, 0.5f * (maximum[axis] - minimum[axis]));
+	}
+	decode.scale = halfExtent > 0.0f ? halfExtent : 1.0f;
+	return decode;
+}
+
+void encodeVertices(const VertexLayout& layout, const VertexStreams& streams, const PositionDecode& decode, void* output) {
+	if (streams.count > 0 && (!streams.positions || !streams.colors || (layout.normal != NormalEncoding::eNone && !streams.normals))) {
+		throw std::runtime_error(std::format("Vertex layout {} needs a stream that was not given", layout.name()));
+	}
+
+	uint8_t* bytes = static_cast<uint8_t*>(output);
+	size_t stride = layout.stride();
+	//padding at the end of the stride stays zero, so files are reproducible
+	memset(bytes, 0, stride * streams.count);
+
+	uint32_t vertex = 0;
+#ifdef VERTEX_LAYOUT_SSE
+	for (; vertex + 4 <= streams.count; vertex += 4) {
+		encodeBlock(layout, streams.positions + vertex * 3, streams.colors + vertex * 3, streams.normals ? streams.normals + vertex * 3 : nullptr, decode, bytes + vertex * stride);
+	}
+#endif
+	//the last few vertices, or all of them without SSE, bit identical to the SSE path
+	for (; vertex < streams.count; vertex++) {
+		encodeVertex(layout, streams.positions + vertex * 3, streams.colors + vertex * 3, streams.normals ? streams.normals + vertex * 3 : nullptr, decode, bytes + vertex * stride);
+	}
+}
+
+void decodeVertex(const VertexLayout& layout, const void* vertex, const PositionDecode& decode, float position[3], float color[3], float normal[3]) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertex);
+	if (layout.position == PositionEncoding::eFloat32) {
+		memcpy(position, bytes, 3 * sizeof(float));
+	} else {
+		uint16_t encoded[3];
+		memcpy(encoded, bytes, sizeof(encoded));
+		for (int axis = 0; axis < 3; axis++) {
+			float relative = layout.position == PositionEncoding::eHalf ? halfToFloat(encoded[axis]) : std::max(static_cast<int16_t>(encoded[axis]) / static_cast<float>(SNORM16_ONE), -1.0f);
+			position[axis] = decode.offset[axis] + relative * decode.scale;
+		}
+	}
+
+	const uint8_t* colorBytes = bytes + layout.colorOffset();
+	if (layout.color == ColorEncoding::eFloat32) {
+		memcpy(color, colorBytes, 3 * sizeof(float));
+	} else {
+		uint32_t packed;
+		memcpy(&packed, colorBytes, sizeof(packed));
+		uint32_t bits = layout.color == ColorEncoding::eUnorm8 ? 8 : 10;
+		uint32_t mask = (1u << bits) - 1;
+		for (uint32_t channel = 0; channel < 3; channel++) {
+			color[channel] = (packed >> (channel * bits) & mask) / static_cast<float>(mask);
+		}
+	}
+
+	const uint8_t* normalBytes = bytes + layout.normalOffset();
+	if (layout.normal == NormalEncoding::eOctahedral16) {
+		int16_t encoded[2];
+		memcpy(encoded, normalBytes, sizeof(encoded));
+		octahedralDecode(std::max(encoded[0] / static_cast<float>(SNORM16_ONE), -1.0f), std::max(encoded[1] / static_cast<float>(SNORM16_ONE), -1.0f), normal);
+	} else if (layout.normal == NormalEncoding::eOctahedral8) {
+		int8_t encoded[2];
+		memcpy(encoded, normalBytes, sizeof(encoded));
+		octahedralDecode(std::max(encoded[0] / 127.0f, -1.0f), std::max(encoded[1] / 127.0f, -1.0f), normal);
+	}
+}
+
+VertexEncodingError measureEncodingError(const VertexLayout& layout, const VertexStreams& streams, const PositionDecode& decode, const void* encoded) {
+	VertexEncodingError error;
+	const uint8_t* bytes = static_cast<const uint8_t*>(encoded);
+	double squaredSum = 0.0;
+	for (uint32_t vertex = 0; vertex < streams.count; vertex++) {
+		float position[3], color[3], normal[3];
+		decodeVertex(layout, bytes + static_cast<size_t>(vertex) * layout.stride(), decode, position, color, normal);
+
+		const float* sourcePosition = streams.positions + vertex * 3;
+		const float* sourceColor = streams.colors + vertex * 3;
+		float squaredDistance = 0.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			squaredDistance += (position[axis] - sourcePosition[axis]) * (position[axis] - sourcePosition[axis]);
+			error.maxColor = std::max(error.maxColor, std::abs(color[axis] - std::clamp(sourceColor[axis], 0.0f, 1.0f)));
+		}
+		error.maxPosition = std::max(error.maxPosition, std::sqrt(squaredDistance));
+		squaredSum += squaredDistance;
+
+		if (layout.normal != NormalEncoding::eNone) {
+			const float* sourceNormal = streams.normals + vertex * 3;
+			float sourceLength = std::sqrt(sourceNormal[0] * sourceNormal[0] + sourceNormal[1] * sourceNormal[1] + sourceNormal[2] * sourceNormal[2]);
+			if (sourceLength > 0.0f) {
+				float cosine = (normal[0] * sourceNormal[0] + normal[1] * sourceNormal[1] + normal[2] * sourceNormal[2]) / sourceLength;
+				error.maxNormalDegrees = std::max(error.maxNormalDegrees, std::acos(std::clamp(cosine, -1.0f, 1.0f)) * 57.2957795f);
+			}
+		}
+	}
+	if (streams.count > 0) {
+		error.rmsPosition = static_cast<float>(std::sqrt(squaredSum / streams.count));
+	}
+	return error;
+}
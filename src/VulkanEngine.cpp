@@ -1,4 +1,9 @@
+#include <cassert>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
 #include <thread>
 
 #define SDL_MAIN_HANDLED
@@ -12,48 +17,43 @@
 const std::string APPLICATION_NAME = "APPLICATION NAME";
 const std::string ENGINE_NAME = "VULKAN ENGINE";
 const vk::Format VULKAN_FORMAT = vk::Format::eB8G8R8A8Unorm; 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+const uint32_t DEFAULT_HEADLESS_FRAME_COUNT = 100;
+const uint64_t NO_TIMESTAMP_FRAME = UINT64_MAX;
+const float OBJECT_SPACING = 1.5f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 10.0f;
+const uint32_t INSTANCE_UPDATE_GRAIN = 4096;
+//per frame uniform memory, a frame only needs one UniformBufferObject today
+const vk::DeviceSize UNIFORM_REGION_SIZE = 64 * 1024;
+//every cluster costs a thread and an indirect draw slot per frame in flight, past this objects are culled whole
+const uint64_t MAX_CLUSTER_COUNT = 4 * 1024 * 1024;
 
 static VulkanEngine* loadedEngine = nullptr;
 
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+	return std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// The default VertexLayout, float position and colour
 struct Vertex {
-	glm::vec2 position;
+	glm::vec3 position;
 	glm::vec3 color;
-
-	static vk::VertexInputBindingDescription getBindingDescription() {
-		vk::VertexInputBindingDescription bindingDescription({});
-		bindingDescription.setStride(sizeof(Vertex));
-		bindingDescription.setInputRate(vk::VertexInputRate::eVertex);
-
-		return bindingDescription;
-	};
-
-	static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions() {
-		std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions({});
-		attributeDescriptions[0].setLocation(0);
-		attributeDescriptions[0].setFormat(vk::Format::eR32G32Sfloat);
-		attributeDescriptions[0].setOffset(offsetof(Vertex, position));
-
-		attributeDescriptions[1].setLocation(1);
-		attributeDescriptions[1].setFormat(vk::Format::eR32G32B32Sfloat);
-		attributeDescriptions[1].setOffset(offsetof(Vertex, color));
-
-		return attributeDescriptions;
-	}
 };
+static_assert(sizeof(Vertex) == 24);
 
 struct UniformBufferObject {
 
 	alignas(16) glm::mat4x4 projection;	
-	alignas(16) glm::mat4x4 model;
 	alignas(16) glm::mat4x4 view;
 };
 
+//built-in quad, used when no mesh file is given
 const std::vector<Vertex> vertices = {
-	{{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-	{{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-	{{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-	{{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+	{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+	{{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+	{{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+	{{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}}
 };
 
 const std::vector<uint16_t> indices = {
@@ -62,135 +62,252 @@ const std::vector<uint16_t> indices = {
 
 
 
-VulkanEngine::VulkanEngine()
+VulkanEngine::VulkanEngine(const EngineConfig& config)
 {
 	const uint32_t windowHeight = 800, windowWidth = 1200;
 	const std::vector<const char*> validationLayers = {
 		"VK_LAYER_KHRONOS_validation"
 	};
+	_config = config;
+	if (_config.framesInFlight < 1 || _config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+		throw std::runtime_error(std::format("frames in flight must be 1 to {}, got {}", MAX_FRAMES_IN_FLIGHT, _config.framesInFlight));
+	}
+	_frameStats.framesInFlight = _config.framesInFlight;
+	if (_config.headless && _config.frameCount == 0) {
+		_config.frameCount = DEFAULT_HEADLESS_FRAME_COUNT;
+	}
 	_windowExtent = vk::Extent2D(windowWidth, windowHeight);
+	if (!_config.tracePath.empty()) {
+		startTracing();
+		setTraceThreadName("main");
+	}
+	TRACE_SCOPE("VulkanEngine");
 
 
 	//Only 1 engine allowed
 	assert(loadedEngine == nullptr);
 	loadedEngine = this;
 
-	// Initialize SDL
-	if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-		throw std::runtime_error("SDL_CreateWindow Error: " + std::string(SDL_GetError()));
-	}
+	std::vector<const char*> instanceExtensions;
+	if (!_config.headless) {
+		// Initialize SDL
+		if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+			throw std::runtime_error("SDL_CreateWindow Error: " + std::string(SDL_GetError()));
+		}
 
-	// Create an SDL window with Vulkan support
-	//TODO: resize support
-	SDL_Window* window = SDL_CreateWindow("Vulkan Window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, windowWidth, windowHeight, (SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE));
-	if (!window) {
-		std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << std::endl;
-		SDL_Quit();
-		throw std::runtime_error("SDL_CreateWindow Error: " + std::string(SDL_GetError()));
+		// Create an SDL window with Vulkan support
+		_window = SDL_CreateWindow("Vulkan Window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, windowWidth, windowHeight, (SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE));
+		if (!_window) {
+			std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << std::endl;
+			SDL_Quit();
+			throw std::runtime_error("SDL_CreateWindow Error: " + std::string(SDL_GetError()));
+		}
+
+		unsigned int sdlExtensionCount;
+		SDL_Vulkan_GetInstanceExtensions(_window, &sdlExtensionCount, nullptr);
+		instanceExtensions.resize(sdlExtensionCount);
+		SDL_Vulkan_GetInstanceExtensions(_window, &sdlExtensionCount, instanceExtensions.data());
 	}
 
 	vk::ApplicationInfo applicationInfo(APPLICATION_NAME.c_str(), 1, ENGINE_NAME.c_str(), 1, VK_API_VERSION_1_3);
 
-	unsigned int sdlExtensionCount;
-	SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, nullptr);
-	std::vector<const char*> sdlExtensions(sdlExtensionCount);
-	SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions.data());
-
-	vk::InstanceCreateInfo instanceCreateInfo({}, &applicationInfo, 0, nullptr, sdlExtensionCount, sdlExtensions.data());
+	vk::InstanceCreateInfo instanceCreateInfo({}, &applicationInfo, 0, nullptr, static_cast<uint32_t>(instanceExtensions.size()), instanceExtensions.data());
 	auto instanceLayerProperties = vk::enumerateInstanceLayerProperties();
+	std::vector<const char*> enabledLayers;
 	for (vk::LayerProperties ilp : instanceLayerProperties) {
 		std::cout << ilp.layerName << std::endl;
+		for (const char* validationLayer : validationLayers) {
+			if (strcmp(ilp.layerName.data(), validationLayer) == 0) {
+				enabledLayers.push_back(validationLayer);
+			}
+		}
 	}
 	std::cout << std::endl;
 
-	instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-	instanceCreateInfo.ppEnabledLayerNames = validationLayers.data();
-
-	vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo = {};
-	instanceCreateInfo.pNext = &debugCreateInfo;
-
+	//build machines often have no validation layer installed, only enable what is there
+	instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(enabledLayers.size());
+	instanceCreateInfo.ppEnabledLayerNames = enabledLayers.data();
 
 	_instance = vk::createInstance(instanceCreateInfo);
 
-	VkSurfaceKHR cSurface;
-	if (!SDL_Vulkan_CreateSurface(window, _instance, &cSurface)) {
-		vkDestroyInstance(_instance, nullptr);
-		SDL_DestroyWindow(window);
-		SDL_Quit();
-		throw std::exception("Failed to create Vulkan surface");
+	if (!_config.headless) {
+		VkSurfaceKHR cSurface;
+		if (!SDL_Vulkan_CreateSurface(_window, _instance, &cSurface)) {
+			vkDestroyInstance(_instance, nullptr);
+			SDL_DestroyWindow(_window);
+			SDL_Quit();
+			throw std::runtime_error("Failed to create Vulkan surface");
+		}
+		_surface = vk::SurfaceKHR(cSurface);
 	}
-	_surface = vk::SurfaceKHR(cSurface);
 
+	initJobSystem();
 	initDevice();
+	initAllocator();
+	initUploadManager();
+	initPipelineCache();
 	initSwapchain();
 	initImageViews();
 	initRenderPass();
+	initMeshes();
+	initObjectBuffer();
 	initDescriptorSetLayout();
 	initGraphicsPipeline();
 	initFramebuffers();
-	initCommandPool();
-	initVertexBuffer();
-	initIndexBuffer();
+	initCommandRecorder();
+	initInstanceBuffer();
 	initUniformBuffers();
+	initCullingPass();
+	initRenderGraph();
 	initDescriptorPool();
 	initDescriptorSets();
-	initCommandBuffers();
-	initSemaphores();
+	initFrames();
+	initTimestampQueries();
+}
+
+void VulkanEngine::initJobSystem() {
+	TRACE_FUNCTION();
+	_jobSystem.init(_config.workerThreadCount);
+	std::cout << "Job system: " << _jobSystem.workerCount() << " worker threads" << std::endl;
 }
 
 void VulkanEngine::initDevice() {
-	_physicalDevice = selectPhysicalDevice(_instance);
+	TRACE_FUNCTION();
+	DeviceCandidate device = selectPhysicalDevice(_instance, _surface, _config.device);
+	_physicalDevice = device.physicalDevice;
+	_capabilities = device.capabilities;
+
+	//a graphics queue, plus compute-only and transfer-only queues where the device has them
+	_queues.selectFamilies(_physicalDevice, _config.gpuCulling && _config.asyncCompute, true);
+	std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos = _queues.queueCreateInfos();
 
-	//creating graphics queue
-	uint32_t queueFamilyIndex = 0;
-	auto queueFamilyProperties = _physicalDevice.getQueueFamilyProperties();
-	for (uint32_t i = 0; i < queueFamilyProperties.size(); ++i) {
-		if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eGraphics) {
-			queueFamilyIndex = i;
-			break;
+	// Enable the extension
+	std::vector<const char*> deviceExtensions;
+	if (!_config.headless) {
+		deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+		//only needed to measure when presents reach the screen
+		_presentWait = _capabilities.presentWait;
+		if (_presentWait) {
+			deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+			deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		} else {
+			std::cout << "present wait not supported, input latency not measured" << std::endl;
 		}
 	}
 
-	float queuePriority = 1.0f;
-	vk::DeviceQueueCreateInfo deviceQueueCreateInfo({}, queueFamilyIndex, 1, &queuePriority);
+	//GPU culling needs indirect count draws with a per-draw firstInstance, fall back to CPU draws without them.
+	//Timeline semaphores and synchronization2 are required, the selector already rejected devices without.
+	_gpuCulling = _config.gpuCulling && _capabilities.drawIndirectCount;
+	if (_config.gpuCulling && !_gpuCulling) {
+		std::cout << "drawIndirectCount not supported, GPU culling disabled" << std::endl;
+	}
+	_bindless = _config.bindless && _capabilities.descriptorIndexing;
+	if (_config.bindless && !_bindless) {
+		std::cout << "descriptor indexing not supported, using per-frame descriptor sets" << std::endl;
+	}
 
-	// Enable the extension
-	std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	vk::PhysicalDeviceVulkan12Features physicalDeviceVulkan12Features({});
+	physicalDeviceVulkan12Features.setTimelineSemaphore(VK_TRUE);
+	physicalDeviceVulkan12Features.setDrawIndirectCount(_gpuCulling);
+	if (_bindless) {
+		BindlessDescriptors::enableFeatures(physicalDeviceVulkan12Features);
+	}
+	vk::PhysicalDeviceVulkan13Features physicalDeviceVulkan13Features({});
+	physicalDeviceVulkan13Features.setSynchronization2(VK_TRUE);
+	physicalDeviceVulkan12Features.setPNext(&physicalDeviceVulkan13Features);
+	vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures(VK_TRUE);
+	vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures(VK_TRUE);
+	if (_presentWait) {
+		presentIdFeatures.setPNext(&presentWaitFeatures);
+		physicalDeviceVulkan13Features.setPNext(&presentIdFeatures);
+	}
 
-	vk::DeviceCreateInfo deviceCreateInfo({}, 1, &deviceQueueCreateInfo);
+	vk::PhysicalDeviceFeatures2 physicalDeviceFeatures2({});
+	physicalDeviceFeatures2.features.setMultiDrawIndirect(_gpuCulling);
+	physicalDeviceFeatures2.features.setDrawIndirectFirstInstance(_gpuCulling);
+	physicalDeviceFeatures2.setPNext(&physicalDeviceVulkan12Features);
+
+	vk::DeviceCreateInfo deviceCreateInfo({});
+	deviceCreateInfo.setQueueCreateInfos(deviceQueueCreateInfos);
 	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
 	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	deviceCreateInfo.setPNext(&physicalDeviceFeatures2);
 
 	_device = _physicalDevice.createDevice(deviceCreateInfo);
-	_graphicsQueue = _device.getQueue(queueFamilyIndex, 0);
+	_queues.init(_device);
+
+	//culling is the only compute work, it runs async when it is on and compute has a queue of its own
+	_asyncCompute = _gpuCulling && _queues.dedicated(QueueType::eCompute);
+	_sceneQueueFamilyIndices = _queues.sharingFamilies({ QueueType::eGraphics, QueueType::eCompute, QueueType::eTransfer });
+	_frameQueueFamilyIndices = _queues.sharingFamilies({ QueueType::eGraphics, QueueType::eCompute });
+	std::cout << "Queues: graphics family " << _queues.family(QueueType::eGraphics)
+		<< ", compute " << (_asyncCompute ? std::format("family {}", _queues.family(QueueType::eCompute)) : "on graphics")
+		<< ", transfer " << (_queues.dedicated(QueueType::eTransfer) ? std::format("family {}", _queues.family(QueueType::eTransfer)) : "on graphics") << std::endl;
+}
+
+void VulkanEngine::initAllocator() {
+	TRACE_FUNCTION();
+	_allocator.init(_physicalDevice, _device);
+	_resources.init(_device, _allocator, _deletionQueue);
+}
+
+void VulkanEngine::initUploadManager() {
+	TRACE_FUNCTION();
+	_uploadManager.init(_device, _allocator, _queues.family(QueueType::eTransfer), _queues.queue(QueueType::eTransfer));
+}
+
+void VulkanEngine::initPipelineCache() {
+	TRACE_FUNCTION();
+	_pipelineCache.init(_physicalDevice, _device, PIPELINE_CACHE_PATH);
 }
 
 void VulkanEngine::initSwapchain() {
-	//Swapchain setup
-	vk::SwapchainCreateInfoKHR swapchainCreateInfo({});
-	swapchainCreateInfo.surface = _surface; // The surface to present images to
-	swapchainCreateInfo.minImageCount = 2; // Minimum number of images in the swapchain
-	swapchainCreateInfo.imageFormat = VULKAN_FORMAT; // Image format
-	swapchainCreateInfo.imageColorSpace = vk::ColorSpaceKHR::eSrgbNonlinear; // Color space
-	swapchainCreateInfo.imageExtent = _windowExtent; // Image size
-	swapchainCreateInfo.imageArrayLayers = 1; // Number of layers in each image
-	swapchainCreateInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment; // Image usage
-	swapchainCreateInfo.imageSharingMode = vk::SharingMode::eExclusive; // Sharing mode
-	swapchainCreateInfo.preTransform = vk::SurfaceTransformFlagBitsKHR::eIdentity; // Pre-transform
-	swapchainCreateInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque; // Composite alpha
-	swapchainCreateInfo.presentMode = vk::PresentModeKHR::eFifoRelaxed; // Present mode
-	swapchainCreateInfo.clipped = VK_TRUE; // Clipping
-	swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE; // Old swapchain
-
-	_swapchain = _device.createSwapchainKHR(swapchainCreateInfo);
+	TRACE_FUNCTION();
+	if (_config.headless) {
+		initOffscreenImages();
+		return;
+	}
+
+	//format and present mode come from what the surface supports, image count and extent from its capabilities
+	_swapchain.init(_physicalDevice, _device, _surface, VULKAN_FORMAT, _config.presentPolicy, _config.presentMode, _presentWait);
+	RetiredSwapchain retired;
+	if (!_swapchain.recreate(_windowExtent, retired)) {
+		throw std::runtime_error("window has no area to create a swapchain for");
+	}
+	_windowExtent = _swapchain.extent();
+	_frameStats.presentMode = vk::to_string(_swapchain.presentMode());
+}
+
+void VulkanEngine::initOffscreenImages() {
+	TRACE_FUNCTION();
+	//Headless: render into our own images instead of a presentable swapchain, one per frame in flight
+	//so no frame renders into an image an earlier frame is still writing
+	_offscreenImageAllocations.resize(_config.framesInFlight);
+	for (uint32_t i = 0; i < _config.framesInFlight; i++) {
+		vk::ImageCreateInfo imageCreateInfo({});
+		imageCreateInfo.setImageType(vk::ImageType::e2D);
+		imageCreateInfo.setFormat(VULKAN_FORMAT);
+		imageCreateInfo.setExtent(vk::Extent3D(_windowExtent, 1));
+		imageCreateInfo.setMipLevels(1);
+		imageCreateInfo.setArrayLayers(1);
+		imageCreateInfo.setSamples(vk::SampleCountFlagBits::e1);
+		imageCreateInfo.setTiling(vk::ImageTiling::eOptimal);
+		imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc);
+		imageCreateInfo.setSharingMode(vk::SharingMode::eExclusive);
+		imageCreateInfo.setInitialLayout(vk::ImageLayout::eUndefined);
+
+		vk::Image image;
+		createImage(_allocator, _device, imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, image, _offscreenImageAllocations[i]);
+		_swapchainImages.push_back(image);
+	}
 }
 
 void VulkanEngine::initImageViews() {
-	//ImageViews setup
-	std::vector<vk::Image> images = _device.getSwapchainImagesKHR(_swapchain);
-	for (int i = 0; i < images.size(); i++) {
+	TRACE_FUNCTION();
+	//ImageViews setup, the swapchain creates its own
+	for (size_t i = 0; i < _swapchainImages.size(); i++) {
 		vk::ImageViewCreateInfo imageViewCreateInfo({});
-		imageViewCreateInfo.image = images[i];
+		imageViewCreateInfo.image = _swapchainImages[i];
 		imageViewCreateInfo.format = VULKAN_FORMAT;
 		imageViewCreateInfo.viewType = vk::ImageViewType::e2D;
 
@@ -205,6 +322,7 @@ void VulkanEngine::initImageViews() {
 }
 
 void VulkanEngine::initRenderPass() {
+	TRACE_FUNCTION();
 	//RenderPass Setup
 	vk::RenderPassCreateInfo2 renderPassCreateInfo2({});
 	vk::SubpassDescription2 subpassDescription({});
@@ -220,13 +338,14 @@ void VulkanEngine::initRenderPass() {
 	renderPassCreateInfo2.subpassCount = 1;
 
 	vk::AttachmentDescription2 colorAttachment({});
-	colorAttachment.setFormat(VULKAN_FORMAT);
+	colorAttachment.setFormat(_config.headless ? VULKAN_FORMAT : _swapchain.format());
 	colorAttachment.setLoadOp(vk::AttachmentLoadOp::eClear);
 	colorAttachment.setStoreOp(vk::AttachmentStoreOp::eStore);
 	colorAttachment.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare);
-	colorAttachment.setStoreOp(vk::AttachmentStoreOp::eDontCare);
-	colorAttachment.setInitialLayout(vk::ImageLayout::eUndefined);
-	colorAttachment.setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+	colorAttachment.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare);
+	//the render graph transitions the image around the pass, after the acquire semaphore and on to present or readback
+	colorAttachment.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal);
+	colorAttachment.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
 	std::vector<vk::AttachmentDescription2> attachmentDescriptions = { colorAttachment };
 	renderPassCreateInfo2.setAttachments(attachmentDescriptions);
@@ -235,10 +354,12 @@ void VulkanEngine::initRenderPass() {
 }
 
 void VulkanEngine::initFramebuffers() {
+	TRACE_FUNCTION();
 	//Framebuffer setup
-	for (int i = 0; i < _imageViews.size(); i++) {
+	const std::vector<vk::ImageView>& imageViews = _config.headless ? _imageViews : _swapchain.imageViews();
+	for (size_t i = 0; i < imageViews.size(); i++) {
 		vk::ImageView attachments[] = {
-			_imageViews[i]
+			imageViews[i]
 		};
 
 		vk::FramebufferCreateInfo framebufferCreateInfo({});
@@ -253,129 +374,320 @@ void VulkanEngine::initFramebuffers() {
 	}
 }
 
-void VulkanEngine::initCommandPool() {
-	//CommandPool setup
-	vk::CommandPoolCreateInfo commandPoolCreateInfo({});
-	commandPoolCreateInfo.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
-	_commandPool = _device.createCommandPool(commandPoolCreateInfo);
+void VulkanEngine::initCommandRecorder() {
+	TRACE_FUNCTION();
+	_commandRecorder.init(_device, _jobSystem, _queues.family(QueueType::eGraphics), _config.framesInFlight);
 }
 
-void VulkanEngine::initVertexBuffer() {
-	uint32_t vertexBufferSize = sizeof(Vertex) * static_cast<uint32_t>(vertices.size());
+void VulkanEngine::initMeshes() {
+	TRACE_FUNCTION();
+	if (_config.meshPath.empty()) {
+		float radius = 0.0f;
+		for (const Vertex& vertex : vertices) {
+			radius = std::max(radius, glm::length(vertex.position));
+		}
 
-	vk::DeviceMemory stagingBufferDeviceMemory = vk::DeviceMemory();
-	vk::Buffer stagingBuffer;
-	createBuffer(_physicalDevice, _device, vertexBufferSize, vk::BufferUsageFlagBits::eTransferSrc, (vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent), stagingBuffer, stagingBufferDeviceMemory);
+		initGeometryBuffers(sizeof(Vertex) * vertices.size(), sizeof(uint16_t) * indices.size());
+		_vertexLayout = VertexLayout();
+		_indexType = vk::IndexType::eUint16;
+		_resources.upload(_uploadManager, _vertexResource, 0, vertices.data(), sizeof(Vertex) * vertices.size());
+		_uploadTicket = _resources.upload(_uploadManager, _indexResource, 0, indices.data(), sizeof(uint16_t) * indices.size());
+
+		MeshLod lod;
+		lod.indexCount = static_cast<uint32_t>(indices.size());
+		Mesh mesh;
+		mesh.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, radius);
+		mesh.lods.push_back(lod);
+		_meshes.push_back(mesh);
+		_lods.push_back({ 0, lod.indexCount });
+		return;
+	}
 
-	void* data =_device.mapMemory(stagingBufferDeviceMemory, 0, vertexBufferSize, {});
-	memcpy(data, vertices.data(), (size_t) vertexBufferSize);
-	_device.unmapMemory(stagingBufferDeviceMemory);
-	
-	createBuffer(_physicalDevice, _device, vertexBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, _vertexBuffer, _deviceMemory);
-	copyBuffer(_device, stagingBuffer, _vertexBuffer, vertexBufferSize, _commandPool, _graphicsQueue);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	MeshFile meshFile;
+	meshFile.open(_config.meshPath);
+	if (meshFile.meshCount() == 0) {
+		throw std::runtime_error(std::format("{} contains no meshes", _config.meshPath));
+	}
 
-	_device.destroyBuffer(stagingBuffer);
-	_device.freeMemory(stagingBufferDeviceMemory);
-}
+	//one vertex and one index buffer and a single pipeline for the whole file, so every mesh has to share
+	//the vertex layout. Index sizes are picked per mesh, 16 bit meshes are widened when any mesh needs 32.
+	_vertexLayout = VertexLayout::fromKey(meshFile.mesh(0).vertexLayout);
+	uint32_t indexSize = sizeof(uint16_t);
+	uint64_t indexCount = 0;
+	for (uint32_t i = 0; i < meshFile.meshCount(); i++) {
+		const MeshRecord& record = meshFile.mesh(i);
+		if (record.vertexLayout != _vertexLayout.key() || record.vertexStride != _vertexLayout.stride()) {
+			throw std::runtime_error(std::format("{}: mesh {} has vertex layout {} with stride {}, mesh 0 has {}", _config.meshPath, i, VertexLayout::fromKey(record.vertexLayout).name(), record.vertexStride, _vertexLayout.name()));
+		}
+		indexSize = std::max(indexSize, record.indexSize);
+		indexCount += record.indexCount;
+	}
+	initGeometryBuffers(meshFile.header().vertexDataSize, indexCount * indexSize);
+	_indexType = indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+
+	//blobs go straight from the mapping into the staging ring, upload() is done with them once it returns
+	vk::DeviceSize vertexOffset = 0, indexOffset = 0;
+	std::vector<uint32_t> widenedIndices;
+	for (uint32_t i = 0; i < meshFile.meshCount(); i++) {
+		const MeshRecord& record = meshFile.mesh(i);
+		vk::DeviceSize vertexBytes = static_cast<vk::DeviceSize>(record.vertexCount) * record.vertexStride;
+		vk::DeviceSize indexBytes = static_cast<vk::DeviceSize>(record.indexCount) * indexSize;
+		const void* indexData = meshFile.indexData(i);
+		if (record.indexSize != indexSize) {
+			const uint16_t* shortIndices = static_cast<const uint16_t*>(indexData);
+			widenedIndices.assign(shortIndices, shortIndices + record.indexCount);
+			indexData = widenedIndices.data();
+		}
 
-void VulkanEngine::initIndexBuffer() {
-	uint32_t indexBufferSize = sizeof(uint16_t) * static_cast<uint32_t>(indices.size());
+		Mesh mesh;
+		mesh.boundingSphere = glm::vec4(record.boundingSphere[0], record.boundingSphere[1], record.boundingSphere[2], record.boundingSphere[3]);
+		mesh.positionDecode = glm::vec4(record.positionDecode[0], record.positionDecode[1], record.positionDecode[2], record.positionDecode[3]);
+		mesh.vertexOffset = static_cast<int32_t>(vertexOffset / _vertexLayout.stride());
+		mesh.firstIndex = static_cast<uint32_t>(indexOffset / indexSize);
+		mesh.lods.assign(record.lods, record.lods + record.lodCount);
+		mesh.firstLod = static_cast<uint32_t>(_lods.size());
+		mesh.firstMeshlet = static_cast<uint32_t>(_meshlets.size());
+		mesh.meshletCount = record.meshletCount;
+		_meshes.push_back(mesh);
+		for (const MeshLod& lod : mesh.lods) {
+			_lods.push_back({ mesh.firstIndex + lod.firstIndex, lod.indexCount });
+		}
 
-	vk::DeviceMemory stagingBufferDeviceMemory = vk::DeviceMemory();
-	vk::Buffer stagingBuffer;
-	createBuffer(_physicalDevice, _device, indexBufferSize, vk::BufferUsageFlagBits::eTransferSrc, (vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent), stagingBuffer, stagingBufferDeviceMemory);
+		const MeshletRecord* meshletRecords = meshFile.meshlets(i);
+		for (uint32_t meshletIndex = 0; meshletIndex < record.meshletCount; meshletIndex++) {
+			const MeshletRecord& meshletRecord = meshletRecords[meshletIndex];
+			MeshletData meshlet;
+			meshlet.boundingSphere = glm::vec4(meshletRecord.boundingSphere[0], meshletRecord.boundingSphere[1], meshletRecord.boundingSphere[2], meshletRecord.boundingSphere[3]);
+			meshlet.cone = glm::vec4(meshletRecord.coneAxis[0], meshletRecord.coneAxis[1], meshletRecord.coneAxis[2], meshletRecord.coneCutoff);
+			meshlet.firstIndex = mesh.firstIndex + meshletRecord.firstIndex;
+			meshlet.indexCount = meshletRecord.indexCount;
+			_meshlets.push_back(meshlet);
+		}
 
-	void* data = _device.mapMemory(stagingBufferDeviceMemory, 0, indexBufferSize, {});
-	memcpy(data, indices.data(), (size_t) indexBufferSize);
-	_device.unmapMemory(stagingBufferDeviceMemory);
-	
-	createBuffer(_physicalDevice, _device, indexBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, _indexBuffer, _deviceMemory);
-	copyBuffer(_device, stagingBuffer, _indexBuffer, indexBufferSize, _commandPool, _graphicsQueue);
+		_resources.upload(_uploadManager, _vertexResource, vertexOffset, meshFile.vertexData(i), vertexBytes);
+		_uploadTicket = _resources.upload(_uploadManager, _indexResource, indexOffset, indexData, indexBytes);
+		vertexOffset += vertexBytes;
+		indexOffset += indexBytes;
+	}
+	meshFile.close();
 
-	_device.destroyBuffer(stagingBuffer);
-	_device.freeMemory(stagingBufferDeviceMemory);	
+	std::cout << std::format("Loaded {} meshes ({:.1f} MB, vertex layout {}, {} bit indices, {} LODs, {} meshlets) from {} in {:.1f} ms", _meshes.size(), (vertexOffset + indexOffset) / (1024.0 * 1024.0),
+		_vertexLayout.name(), indexSize * 8, _lods.size(), _meshlets.size(), _config.meshPath, millisecondsSince(startTime)) << std::endl;
 }
 
-void VulkanEngine::initCommandBuffers() {
-	//CommandBuffer setup
-	vk::CommandBufferAllocateInfo commandBufferAllocateInfo({});
-	commandBufferAllocateInfo.commandPool = _commandPool;
-	commandBufferAllocateInfo.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
-	_commandBuffers = _device.allocateCommandBuffers(commandBufferAllocateInfo);
+void VulkanEngine::initGeometryBuffers(vk::DeviceSize vertexBufferSize, vk::DeviceSize indexBufferSize) {
+	TRACE_FUNCTION();
+	_vertexResource = createSceneBuffer(vertexBufferSize, vk::BufferUsageFlagBits::eVertexBuffer, _vertexBuffer);
+	_indexResource = createSceneBuffer(indexBufferSize, vk::BufferUsageFlagBits::eIndexBuffer, _indexBuffer);
 }
 
-void VulkanEngine::initUniformBuffers() {
-	uint32_t bufferSize = sizeof(UniformBufferObject);
+ResourceHandle VulkanEngine::createSceneBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::Buffer& buffer) {
+	ResourceHandle resource = _resources.createBuffer(size, vk::BufferUsageFlagBits::eTransferDst | usage, vk::MemoryPropertyFlagBits::eDeviceLocal, AllocationStrategy::eBuddy, _sceneQueueFamilyIndices);
+	_frameResources.push_back(resource);
+	buffer = _resources.buffer(resource);
+	return resource;
+}
 
-	_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	_uniformBufferDeviceMemories.resize(MAX_FRAMES_IN_FLIGHT);
-	_uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+void VulkanEngine::initObjectBuffer() {
+	TRACE_FUNCTION();
+	//meshes are scaled to the built-in quad's radius, so any file fits the grid spacing
+	float quadRadius = 0.0f;
+	for (const Vertex& vertex : vertices) {
+		quadRadius = std::max(quadRadius, glm::length(vertex.position));
+	}
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		createBuffer(_physicalDevice, _device, bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, _uniformBuffers[i], _uniformBufferDeviceMemories[i]);
-		_uniformBuffersMapped[i] = _device.mapMemory(_uniformBufferDeviceMemories[i], 0, bufferSize);
+	//square grid centered on the origin, a single object sits at the origin
+	uint32_t objectCount = std::max(_config.objectCount, 1u);
+	uint32_t meshCount = static_cast<uint32_t>(_meshes.size());
+	uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+	float gridOffset = 0.5f * (gridSize - 1) * OBJECT_SPACING;
+	_objects.resize(objectCount);
+	_objectMeshes.resize(objectCount);
+	_transformSystem.reserve(objectCount);
+	_instanceColors.resize(objectCount);
+	_instancePositionDecodes.resize(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		//meshes get contiguous runs of objects, so CPU draws can batch them into instanced draws
+		uint32_t meshIndex = static_cast<uint32_t>(static_cast<uint64_t>(i) * meshCount / objectCount);
+		const Mesh& mesh = _meshes[meshIndex];
+		ObjectData& object = _objects[i];
+		object.boundingSphere = mesh.boundingSphere;
+		object.indexCount = mesh.lods[0].indexCount;
+		object.firstIndex = mesh.firstIndex + mesh.lods[0].firstIndex;
+		object.vertexOffset = mesh.vertexOffset;
+		object.firstMeshlet = mesh.firstMeshlet;
+		object.meshletCount = mesh.meshletCount;
+		object.firstLod = mesh.firstLod;
+		object.lodCount = static_cast<uint32_t>(mesh.lods.size());
+		_objectMeshes[i] = meshIndex;
+		_lodTriangles += object.indexCount / 3;
+		_instancePositionDecodes[i] = mesh.positionDecode;
+
+		float scale = mesh.boundingSphere.w > 0.0f ? quadRadius / mesh.boundingSphere.w : 1.0f;
+		glm::vec3 position((i % gridSize) * OBJECT_SPACING - gridOffset, (i / gridSize) * OBJECT_SPACING - gridOffset, 0.0f);
+		_transformSystem.add(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(scale));
+		//golden ratio steps keep neighbours apart, the first instance keeps the vertex colours
+		float hue = std::fmod(i * 0.618034f, 1.0f);
+		_instanceColors[i] = glm::vec4(1.0f - 0.5f * hue, 1.0f - 0.5f * std::fmod(hue * 2.0f, 1.0f), 1.0f, 1.0f);
 	}
+
+	//everything starts at LOD 0, the first frame picks the real ones
+	_objectLods.assign(objectCount, 0);
+	_objectLodChanges.assign(objectCount, 0);
+	buildDrawCommands();
+
+	vk::DeviceSize objectBufferSize = sizeof(ObjectData) * _objects.size();
+	vk::DeviceSize lodBufferSize = sizeof(LodData) * _lods.size();
+	_objectResource = createSceneBuffer(objectBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, _objectBuffer);
+	_lodResource = createSceneBuffer(lodBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, _lodBuffer);
+	_resources.upload(_uploadManager, _lodResource, 0, _lods.data(), lodBufferSize);
+	_uploadTicket = _resources.upload(_uploadManager, _objectResource, 0, _objects.data(), objectBufferSize);
+	initClusters();
+}
+
+void VulkanEngine::initClusters() {
+	TRACE_FUNCTION();
+	//every mesh needs meshlets, an object without any could not be drawn by the cluster pass
+	uint64_t clusterCount = 0;
+	bool allMeshlets = !_meshlets.empty();
+	for (const ObjectData& object : _objects) {
+		clusterCount += object.meshletCount;
+		allMeshlets = allMeshlets && object.meshletCount > 0;
+	}
+	_clusterCulling = _gpuCulling && _config.clusterCulling && allMeshlets && clusterCount <= MAX_CLUSTER_COUNT;
+	if (_gpuCulling && _config.clusterCulling && allMeshlets && !_clusterCulling) {
+		std::cout << std::format("{} clusters exceed the limit of {}, culling whole objects", clusterCount, MAX_CLUSTER_COUNT) << std::endl;
+	}
+	if (!_clusterCulling) {
+		return;
+	}
+
+	_clusters.reserve(static_cast<size_t>(clusterCount));
+	for (uint32_t i = 0; i < _objects.size(); i++) {
+		for (uint32_t meshlet = 0; meshlet < _objects[i].meshletCount; meshlet++) {
+			_clusters.push_back({ i, _objects[i].firstMeshlet + meshlet });
+		}
+	}
+
+	vk::DeviceSize meshletBufferSize = sizeof(MeshletData) * _meshlets.size();
+	vk::DeviceSize clusterBufferSize = sizeof(ClusterData) * _clusters.size();
+	_meshletResource = createSceneBuffer(meshletBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, _meshletBuffer);
+	_clusterResource = createSceneBuffer(clusterBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, _clusterBuffer);
+	_resources.upload(_uploadManager, _meshletResource, 0, _meshlets.data(), meshletBufferSize);
+	_uploadTicket = _resources.upload(_uploadManager, _clusterResource, 0, _clusters.data(), clusterBufferSize);
+	std::cout << std::format("Cluster culling: {} meshlets, {} clusters", _meshlets.size(), _clusters.size()) << std::endl;
+}
+
+void VulkanEngine::initInstanceBuffer() {
+	TRACE_FUNCTION();
+	//one region per frame in flight, the CPU rewrites a region only after that frame's fence
+	vk::DeviceSize alignment = _physicalDevice.getProperties().limits.minStorageBufferOffsetAlignment;
+	_instanceRegionSize = (sizeof(InstanceData) * _objects.size() + alignment - 1) / alignment * alignment;
+
+	createBuffer(_allocator, _device, _instanceRegionSize * _config.framesInFlight, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, _instanceBuffer, _instanceBufferAllocation, AllocationStrategy::eLinear, _frameQueueFamilyIndices);
+
+	//colours and position decodes never change, only the transforms are rewritten per frame
+	for (uint32_t frame = 0; frame < _config.framesInFlight; frame++) {
+		InstanceData* instances = instanceRegion(frame);
+		for (size_t i = 0; i < _instanceColors.size(); i++) {
+			instances[i].color = _instanceColors[i];
+			instances[i].positionDecode = _instancePositionDecodes[i];
+			instances[i].lod = 0;
+		}
+	}
+	_instanceRegionUpdates.assign(_config.framesInFlight, 0);
+	_instanceRegionLodFrames.assign(_config.framesInFlight, 0);
+}
+
+void VulkanEngine::initUniformBuffers() {
+	TRACE_FUNCTION();
+	_uniformAllocator.init(_physicalDevice, _device, _allocator, UNIFORM_REGION_SIZE, _config.framesInFlight, _frameQueueFamilyIndices);
 }
 
 void VulkanEngine::initDescriptorPool() {
-	vk::DescriptorPoolSize descriptorPoolSize = vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT);
+	TRACE_FUNCTION();
+	std::array<vk::DescriptorPoolSize, 2> descriptorPoolSizes = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBufferDynamic, 1)
+	};
 
 	vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo({});
-	descriptorPoolCreateInfo.setPoolSizes(descriptorPoolSize);
-	descriptorPoolCreateInfo.setMaxSets(MAX_FRAMES_IN_FLIGHT);
+	descriptorPoolCreateInfo.setPoolSizes(descriptorPoolSizes);
+	descriptorPoolCreateInfo.setMaxSets(1);
 
 	_descriptorPool = _device.createDescriptorPool(descriptorPoolCreateInfo);
 }
 
 void VulkanEngine::initDescriptorSetLayout() {
+	TRACE_FUNCTION();
+	//bindless reads instances through the bindless arrays, the frame uniforms stay in their own set (1)
+	//because dynamic descriptors can't be update-after-bind
+	if (_bindless) {
+		_bindlessDescriptors.init(_physicalDevice, _device, vk::ShaderStageFlagBits::eVertex);
+	}
+
+	//both bindings are dynamic, each frame passes its offsets when binding the one set
 	vk::DescriptorSetLayoutBinding descriptorSetLayoutBinding({});
 	descriptorSetLayoutBinding.setBinding(0);
-	descriptorSetLayoutBinding.setDescriptorType(vk::DescriptorType::eUniformBuffer);
+	descriptorSetLayoutBinding.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic);
 	descriptorSetLayoutBinding.setDescriptorCount(1);
 	descriptorSetLayoutBinding.setStageFlags(vk::ShaderStageFlagBits::eVertex);
 
+	vk::DescriptorSetLayoutBinding instanceSetLayoutBinding({});
+	instanceSetLayoutBinding.setBinding(1);
+	instanceSetLayoutBinding.setDescriptorType(vk::DescriptorType::eStorageBufferDynamic);
+	instanceSetLayoutBinding.setDescriptorCount(1);
+	instanceSetLayoutBinding.setStageFlags(vk::ShaderStageFlagBits::eVertex);
+
+	std::array<vk::DescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings = { descriptorSetLayoutBinding, instanceSetLayoutBinding };
 	vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo({});
-	descriptorSetLayoutCreateInfo.setBindings(descriptorSetLayoutBinding);
+	descriptorSetLayoutCreateInfo.setPBindings(descriptorSetLayoutBindings.data());
+	descriptorSetLayoutCreateInfo.setBindingCount(_bindless ? 1 : 2);
 
 	_descriptorSetLayout = _device.createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
 }
 
 void VulkanEngine::initDescriptorSets() {
-	std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, _descriptorSetLayout);
+	TRACE_FUNCTION();
+	//bindless frames differ only in the instance slot they push
+	if (_bindless) {
+		_drawConstants.resize(_config.framesInFlight);
+		for (size_t i = 0; i < _config.framesInFlight; i++) {
+			_drawConstants[i].instanceSlot = _bindlessDescriptors.addBuffer(_instanceBuffer, i * _instanceRegionSize, _instanceRegionSize);
+		}
+	}
 
 	vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo({});
 	descriptorSetAllocateInfo.setDescriptorPool(_descriptorPool);
-	descriptorSetAllocateInfo.setDescriptorSetCount(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)); 
-	descriptorSetAllocateInfo.setSetLayouts(layouts);
-
-	_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-
-	vk::resultCheck(_device.allocateDescriptorSets(&descriptorSetAllocateInfo, _descriptorSets.data()), "failed to allocate descriptor set");
-	
-	
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vk::DescriptorBufferInfo descriptorBufferInfo{};
-		descriptorBufferInfo.setBuffer(_uniformBuffers[i]);
-		descriptorBufferInfo.setRange(sizeof(UniformBufferObject));
-		descriptorBufferInfo.setOffset(0);
-
-		vk::WriteDescriptorSet writeDescriptorSet;
-		writeDescriptorSet.setDstSet(_descriptorSets[i]);
-		writeDescriptorSet.setDstBinding(0);
-		writeDescriptorSet.setDstArrayElement(0);
-		writeDescriptorSet.setDescriptorType(vk::DescriptorType::eUniformBuffer);
-		writeDescriptorSet.setDescriptorCount(1);
-		writeDescriptorSet.setBufferInfo(descriptorBufferInfo);
-
-		_device.updateDescriptorSets(1, &writeDescriptorSet, 0, nullptr);
-	}
+	descriptorSetAllocateInfo.setSetLayouts(_descriptorSetLayout);
+	vk::resultCheck(_device.allocateDescriptorSets(&descriptorSetAllocateInfo, &_descriptorSet), "failed to allocate descriptor set");
+
+	//written once, the offsets of this frame's uniforms and instance region are dynamic
+	vk::DescriptorBufferInfo descriptorBufferInfo(_uniformAllocator.buffer(), 0, sizeof(UniformBufferObject));
+	vk::WriteDescriptorSet writeDescriptorSet;
+	writeDescriptorSet.setDstSet(_descriptorSet);
+	writeDescriptorSet.setDstBinding(0);
+	writeDescriptorSet.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic);
+	writeDescriptorSet.setBufferInfo(descriptorBufferInfo);
+
+	vk::DescriptorBufferInfo instanceBufferInfo(_instanceBuffer, 0, _instanceRegionSize);
+	vk::WriteDescriptorSet instanceWriteDescriptorSet;
+	instanceWriteDescriptorSet.setDstSet(_descriptorSet);
+	instanceWriteDescriptorSet.setDstBinding(1);
+	instanceWriteDescriptorSet.setDescriptorType(vk::DescriptorType::eStorageBufferDynamic);
+	instanceWriteDescriptorSet.setBufferInfo(instanceBufferInfo);
+
+	std::array<vk::WriteDescriptorSet, 2> writeDescriptorSets = { writeDescriptorSet, instanceWriteDescriptorSet };
+	_device.updateDescriptorSets(_bindless ? 1 : 2, writeDescriptorSets.data(), 0, nullptr);
 }
 
 
 void VulkanEngine::initGraphicsPipeline() {
+	TRACE_FUNCTION();
 	//Graphics Pipeline
 	vk::ShaderModuleCreateInfo vertexShaderCreateInfo({});
-	std::vector<uint32_t> vertexShaderCode = readShader("shaders/v_shader.spv");
+	std::vector<uint32_t> vertexShaderCode = readShader(_bindless ? "shaders/v_shader_bindless.spv" : "shaders/v_shader.spv");
 	vertexShaderCreateInfo.setCode(vertexShaderCode);
 	_vertexShaderModule = _device.createShaderModule(vertexShaderCreateInfo);
 	vk::PipelineShaderStageCreateInfo vertexPipelineShaderStageCreateInfo = vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, _vertexShaderModule, "VS_main");
@@ -388,16 +700,25 @@ void VulkanEngine::initGraphicsPipeline() {
 
 	vk::PipelineShaderStageCreateInfo pipelineShaderStageCreateInfoArray[] = { vertexPipelineShaderStageCreateInfo, fragmentPipelineShaderStageCreateInfo };
 	
+	//bindless: set 0 the bindless arrays, set 1 the frame uniforms, instance slots in push constants
 	vk::PipelineLayoutCreateInfo pipelineLayout({});
-	pipelineLayout.setSetLayouts(_descriptorSetLayout);
+	std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = { _descriptorSetLayout };
+	if (_bindless) {
+		descriptorSetLayouts.insert(descriptorSetLayouts.begin(), _bindlessDescriptors.layout());
+	}
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawConstants));
+	pipelineLayout.setSetLayouts(descriptorSetLayouts);
+	if (_bindless) {
+		pipelineLayout.setPushConstantRanges(pushConstantRange);
+	}
 	_pipelineLayout = _device.createPipelineLayout(pipelineLayout);
 
 	vk::DynamicState dynamicStateArray[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
 	vk::PipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo({}, dynamicStateArray);
 	vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo({});
 
-	std::vector<vk::VertexInputBindingDescription> bindingDescriptions = { Vertex::getBindingDescription() };
-	std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions = Vertex::getAttributeDescriptions();
+	std::vector<vk::VertexInputBindingDescription> bindingDescriptions = { vertexBindingDescription(_vertexLayout) };
+	std::vector<vk::VertexInputAttributeDescription> attributeDescriptions = vertexAttributeDescriptions(_vertexLayout);
 
 	vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo({});
 	pipelineVertexInputStateCreateInfo.setVertexBindingDescriptions(bindingDescriptions);
@@ -407,6 +728,12 @@ void VulkanEngine::initGraphicsPipeline() {
 	vk::PipelineRasterizationStateCreateInfo pipelineRasterizationStateCreateInfo({});
 	pipelineRasterizationStateCreateInfo.setRasterizerDiscardEnable(VK_FALSE);
 	pipelineRasterizationStateCreateInfo.setLineWidth(1.0);
+	//the cluster pass drops meshlets whose triangles all face away, so the rasterizer has to drop backfaces too
+	//or culling would change the picture. The projection flips y, which keeps counter-clockwise in front.
+	if (_clusterCulling) {
+		pipelineRasterizationStateCreateInfo.setCullMode(vk::CullModeFlagBits::eBack);
+		pipelineRasterizationStateCreateInfo.setFrontFace(vk::FrontFace::eCounterClockwise);
+	}
 
 	vk::PipelineViewportStateCreateInfo pipelineViewportStateCreateInfo({});
 	vk::Viewport viewport({});
@@ -436,68 +763,296 @@ void VulkanEngine::initGraphicsPipeline() {
 	graphicsPipelineCreateInfo.setPViewportState(&pipelineViewportStateCreateInfo);
 	graphicsPipelineCreateInfo.setPColorBlendState(&pipelineColorBlendState);
 
-	_graphicsPipeline = _device.createGraphicsPipeline({}, graphicsPipelineCreateInfo).value;
+	auto pipelineStartTime = std::chrono::high_resolution_clock::now();
+	_graphicsPipeline = _device.createGraphicsPipeline(_pipelineCache.get(), graphicsPipelineCreateInfo).value;
+	float pipelineMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - pipelineStartTime).count();
+	std::cout << "Graphics pipeline created in " << pipelineMilliseconds << " ms (" << (_pipelineCache.isWarm() ? "warm" : "cold") << " cache)" << std::endl;
 }
 
-void VulkanEngine::initSemaphores() {
-	_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	_inflightFences.resize(MAX_FRAMES_IN_FLIGHT);
+void VulkanEngine::initCullingPass() {
+	TRACE_FUNCTION();
+	if (!_gpuCulling) {
+		return;
+	}
+	_cullingPass.init(_device, _allocator, _pipelineCache.get(), _objects, _objectBuffer, _lods, _lodBuffer, _instanceBuffer, _instanceRegionSize, _config.framesInFlight, _uniformAllocator.buffer(), sizeof(UniformBufferObject),
+		_meshlets, _meshletBuffer, _clusters, _clusterBuffer, _config.validateCulling);
+}
 
-	vk::FenceCreateInfo fenceCreateInfo({});
-	fenceCreateInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
+void VulkanEngine::initRenderGraph() {
+	TRACE_FUNCTION();
+	//an acquired swapchain image is only available once the acquire semaphore wait at color attachment
+	//output is done. Headless frames are never presented, they are left ready for readback instead.
+	if (_config.headless) {
+		_colorTarget = _renderGraph.importImage("offscreenImage", vk::ImageLayout::eUndefined);
+		_renderGraph.markOutput(_colorTarget, ResourceUsage::eTransferRead);
+	} else {
+		_colorTarget = _renderGraph.importImage("swapchainImage", vk::ImageLayout::eUndefined, vk::ImageAspectFlagBits::eColor, vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+		_renderGraph.markOutput(_colorTarget, ResourceUsage::ePresent);
+	}
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		_imageAvailableSemaphores[i] = _device.createSemaphore(vk::SemaphoreCreateInfo({}));
-		_renderFinishedSemaphores[i] = _device.createSemaphore(vk::SemaphoreCreateInfo({}));
-		_inflightFences[i] = _device.createFence(fenceCreateInfo);
+	//the culling buffers are per frame, the graph only orders the passes touching this frame's
+	if (_gpuCulling) {
+		RenderGraph::ResourceId drawCommands = _renderGraph.importBuffer("drawCommands");
+		RenderGraph::ResourceId drawCount = _renderGraph.importBuffer("drawCount");
+
+		//async culling is recorded for the compute queue, the graphics side starts with acquiring its results
+		if (!_asyncCompute) {
+			RenderGraph::PassId cullPass = _renderGraph.addPass("cull", [this](vk::CommandBuffer commandBuffer) {
+				_cullingPass.record(commandBuffer, currentFrame, _frameUniforms.offset, _cullMatrix, _cameraPosition);
+			});
+			_renderGraph.write(cullPass, drawCommands, ResourceUsage::eComputeWrite);
+			_renderGraph.write(cullPass, drawCount, ResourceUsage::eTransferWrite);
+			_renderGraph.write(cullPass, drawCount, ResourceUsage::eComputeWrite);
+		}
+
+		RenderGraph::PassId mainPass = _renderGraph.addPass("main", [this](vk::CommandBuffer commandBuffer) { recordMainPass(commandBuffer); });
+		_renderGraph.read(mainPass, drawCommands, ResourceUsage::eIndirectRead);
+		_renderGraph.read(mainPass, drawCount, ResourceUsage::eIndirectRead);
+		_renderGraph.write(mainPass, _colorTarget, ResourceUsage::eColorAttachment);
+
+		if (_config.validateCulling) {
+			RenderGraph::PassId readbackPass = _renderGraph.addPass("readback", [this](vk::CommandBuffer commandBuffer) {
+				_cullingPass.recordReadback(commandBuffer, currentFrame);
+			});
+			_renderGraph.read(readbackPass, drawCommands, ResourceUsage::eTransferRead);
+			_renderGraph.read(readbackPass, drawCount, ResourceUsage::eTransferRead);
+			_renderGraph.setSideEffects(readbackPass);
+		}
+	} else {
+		RenderGraph::PassId mainPass = _renderGraph.addPass("main", [this](vk::CommandBuffer commandBuffer) { recordMainPass(commandBuffer); });
+		_renderGraph.write(mainPass, _colorTarget, ResourceUsage::eColorAttachment);
 	}
+	_renderGraph.compile(_device, _allocator);
+	_renderGraph.printSchedule(std::cout);
 }
 
-void VulkanEngine::updateUniformBuffers() {
-	static auto startTime = std::chrono::high_resolution_clock::now();
+void VulkanEngine::initFrames() {
+	TRACE_FUNCTION();
+	//one timeline semaphore paces every frame, each submit signals its frame number + 1
+	_frameSemaphore = createTimelineSemaphore(_device);
+	if (_asyncCompute) {
+		_computeSemaphore = createTimelineSemaphore(_device);
+	}
 
-	auto currentTime = std::chrono::high_resolution_clock::now();
-	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+	_frames.resize(_config.framesInFlight);
+	for (FrameContext& frame : _frames) {
+		vk::CommandPoolCreateInfo commandPoolCreateInfo({});
+		commandPoolCreateInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+		commandPoolCreateInfo.setQueueFamilyIndex(_queues.family(QueueType::eGraphics));
+		frame.commandPool = _device.createCommandPool(commandPoolCreateInfo);
+
+		vk::CommandBufferAllocateInfo commandBufferAllocateInfo({});
+		commandBufferAllocateInfo.setCommandPool(frame.commandPool);
+		commandBufferAllocateInfo.setCommandBufferCount(1);
+		frame.commandBuffer = _device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+
+		if (_asyncCompute) {
+			commandPoolCreateInfo.setQueueFamilyIndex(_queues.family(QueueType::eCompute));
+			frame.computeCommandPool = _device.createCommandPool(commandPoolCreateInfo);
+			commandBufferAllocateInfo.setCommandPool(frame.computeCommandPool);
+			frame.computeCommandBuffer = _device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+		}
+
+		//presentation still needs binary semaphores
+		if (!_config.headless) {
+			frame.imageAvailableSemaphore = _device.createSemaphore(vk::SemaphoreCreateInfo({}));
+		}
+	}
+	if (!_config.headless) {
+		initPresentSemaphores();
+	}
+}
+
+void VulkanEngine::initPresentSemaphores() {
+	TRACE_FUNCTION();
+	//the semaphore a present waits on is only free again once that image is acquired again, which
+	//frames in flight don't bound, so there is one per image instead of one per frame
+	_presentSemaphores.resize(_swapchain.images().size());
+	for (vk::Semaphore& semaphore : _presentSemaphores) {
+		semaphore = _device.createSemaphore(vk::SemaphoreCreateInfo({}));
+	}
+}
 
+void VulkanEngine::initTimestampQueries() {
+	TRACE_FUNCTION();
+	vk::PhysicalDeviceLimits limits = _physicalDevice.getProperties().limits;
+	uint32_t timestampValidBits = _physicalDevice.getQueueFamilyProperties()[_queues.family(QueueType::eGraphics)].timestampValidBits;
+
+	_timestampsSupported = timestampValidBits > 0 && limits.timestampPeriod > 0.0f;
+	_timestampPeriod = limits.timestampPeriod;
+	_timestampMask = timestampValidBits >= 64 ? UINT64_MAX : ((1ull << timestampValidBits) - 1);
+	_timestampFrameNumbers.assign(_config.framesInFlight, NO_TIMESTAMP_FRAME);
+	_gpuTrace.init(_device, _physicalDevice, _queues.family(QueueType::eGraphics), _config.framesInFlight);
+
+	if (!_timestampsSupported) {
+		std::cout << "GPU timestamps not supported on the graphics queue, gpu timings disabled" << std::endl;
+		return;
+	}
+
+	//two queries per frame in flight: before and after the render pass
+	vk::QueryPoolCreateInfo queryPoolCreateInfo({});
+	queryPoolCreateInfo.setQueryType(vk::QueryType::eTimestamp);
+	queryPoolCreateInfo.setQueryCount(2 * _config.framesInFlight);
+	_timestampQueryPool = _device.createQueryPool(queryPoolCreateInfo);
+}
+
+void VulkanEngine::collectTimestamps(uint32_t frame) {
+	if (!_timestampsSupported || _timestampFrameNumbers[frame] == NO_TIMESTAMP_FRAME) {
+		return;
+	}
+
+	//the frame's fence has signaled, so its queries are available without waiting
+	vk::ResultValue<std::vector<uint64_t>> timestamps = _device.getQueryPoolResults<uint64_t>(_timestampQueryPool, 2 * frame, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	uint64_t frameNumber = _timestampFrameNumbers[frame];
+	if (timestamps.result == vk::Result::eSuccess) {
+		if (frameNumber >= _config.warmupFrameCount) {
+			uint64_t ticks = (timestamps.value[1] - timestamps.value[0]) & _timestampMask;
+			_frameStats.gpuMs.push_back(ticks * static_cast<double>(_timestampPeriod) / 1e6);
+
+			//the GPU waiting for the CPU shows up as a gap between consecutive frames. A frame may start
+			//before the previous one drained, which wraps around and counts as no gap.
+			if (_lastTimestampFrameNumber != NO_TIMESTAMP_FRAME && frameNumber == _lastTimestampFrameNumber + 1) {
+				uint64_t gapTicks = (timestamps.value[0] - _lastGpuEndTimestamp) & _timestampMask;
+				_frameStats.gpuIdleMs.push_back(gapTicks > _timestampMask / 2 ? 0.0 : gapTicks * static_cast<double>(_timestampPeriod) / 1e6);
+			}
+		}
+		_lastTimestampFrameNumber = frameNumber;
+		_lastGpuEndTimestamp = timestamps.value[1];
+	}
+	_timestampFrameNumbers[frame] = NO_TIMESTAMP_FRAME;
+}
+
+std::string VulkanEngine::deviceName() const {
+	return std::string(_physicalDevice.getProperties().deviceName.data());
+}
+
+glm::mat4 VulkanEngine::updateUniformBuffers() {
+	TRACE_FUNCTION();
 	UniformBufferObject ubo{};
-	ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.projection = glm::perspective(glm::radians(45.0f), _windowExtent.width / (float) _windowExtent.height, 0.1f, 10.0f);
+	_cameraPosition = glm::vec3(2.0f, 2.0f, 2.0f);
+	ubo.view = glm::lookAt(_cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.projection = glm::perspective(glm::radians(45.0f), _windowExtent.width / (float) _windowExtent.height, NEAR_PLANE, FAR_PLANE);
 
 	ubo.projection[1][1] *= -1; //y coordinate is inverted on OpenGL - flip it
+	_projectionScale = std::abs(ubo.projection[1][1]) * 0.5f * _windowExtent.height;
+
+	//the region was last read framesInFlight frames ago, the frame wait made it free again
+	_uniformAllocator.beginFrame(currentFrame);
+	_frameUniforms = _uniformAllocator.push(ubo);
 
-	memcpy(_uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+	//what the cull shader builds from the same ubo
+	return ubo.projection * ubo.view;
 }
 
-void VulkanEngine::draw() {
-	uint32_t imageIndex = 0;
-	
-	vk::Result fenceWaitResult = _device.waitForFences(_inflightFences[currentFrame], VK_TRUE, UINT64_MAX);
-	
-	updateUniformBuffers();
+InstanceData* VulkanEngine::instanceRegion(uint32_t frame) {
+	return reinterpret_cast<InstanceData*>(static_cast<uint8_t*>(_instanceBufferAllocation.mapped) + frame * _instanceRegionSize);
+}
 
-	_device.resetFences(_inflightFences[currentFrame]);
+void VulkanEngine::updateInstances() {
+	TRACE_FUNCTION();
+	static auto startTime = std::chrono::high_resolution_clock::now();
 
-	if (fenceWaitResult != vk::Result::eSuccess) {
-		std::string err = std::format("acquire next image failure: {} ", vk::to_string(fenceWaitResult));
-		throw std::runtime_error(err);
-	}	
+	auto currentTime = std::chrono::high_resolution_clock::now();
+	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
-	vk::Result acquireNextImageResult = _device.acquireNextImageKHR(_swapchain, UINT64_MAX, _imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-	if (acquireNextImageResult != vk::Result::eSuccess) {
-		std::string err = std::format("acquire next image failure: {} ", vk::to_string(acquireNextImageResult));
-		throw std::runtime_error(err);
+	//every quad spins around its own center
+	glm::quat rotation = glm::angleAxis(time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	for (uint32_t i = 0; i < _transformSystem.size(); i++) {
+		_transformSystem.setRotation(i, rotation);
 	}
-	
-	vk::CommandBuffer* p_commandBuffer = &_commandBuffers[currentFrame];
-	p_commandBuffer->reset();
+	_transformSystem.update();
+
+	//the region still holds what was written framesInFlight frames ago, only catch up on what changed since
+	InstanceData* instances = instanceRegion(currentFrame);
+	uint64_t sinceUpdate = _instanceRegionUpdates[currentFrame];
+	uint64_t regionLodFrame = _instanceRegionLodFrames[currentFrame];
+	bool lodSelection = _config.lodErrorPixels > 0.0f;
+	std::atomic<uint32_t> lodChanges = 0;
+	std::atomic<int64_t> triangleDelta = 0;
+	std::function<void(uint32_t, uint32_t)> writeRange = [&](uint32_t first, uint32_t last) {
+		_transformSystem.write(instances, sizeof(InstanceData), sinceUpdate, first, last);
+		if (lodSelection) {
+			selectLods(instances, regionLodFrame, first, last, lodChanges, triangleDelta);
+		}
+	};
 
-	//CommandBuffer begin recording
-	vk::CommandBufferBeginInfo commandBufferBeginInfo({});
-	p_commandBuffer->begin(commandBufferBeginInfo);
+	JobCounter counter;
+	_jobSystem.parallelFor(_transformSystem.size(), INSTANCE_UPDATE_GRAIN, writeRange, counter);
+	_jobSystem.wait(counter);
+	_instanceRegionUpdates[currentFrame] = _transformSystem.updateCount();
+	_instanceRegionLodFrames[currentFrame] = _frameNumber + 1;
+	_lodTriangles += triangleDelta;
+
+	//CPU draws batch runs of objects with the same mesh and LOD, GPU culled frames read the LOD from the instance
+	if (!_gpuCulling && lodChanges > 0) {
+		buildDrawCommands();
+	}
+}
 
-	//RenderPass
+void VulkanEngine::selectLods(InstanceData* instances, uint64_t regionFrame, uint32_t first, uint32_t last, std::atomic<uint32_t>& changeCount, std::atomic<int64_t>& triangleDelta) {
+	TRACE_FUNCTION();
+	uint32_t changes = 0;
+	int64_t triangles = 0;
+	for (uint32_t i = first; i < last; i++) {
+		const Mesh& mesh = _meshes[_objectMeshes[i]];
+		uint32_t lod = _objectLods[i];
+		if (mesh.lods.size() > 1) {
+			float pixelsPerUnit = meshPixelsPerUnit(mesh.boundingSphere, _transformSystem.worldMatrix(i), _cameraPosition, _projectionScale, NEAR_PLANE);
+			lod = selectLod(mesh.lods.data(), static_cast<uint32_t>(mesh.lods.size()), pixelsPerUnit, lod, _config.lodErrorPixels);
+		}
+		if (lod != _objectLods[i]) {
+			triangles += static_cast<int64_t>(mesh.lods[lod].indexCount / 3) - static_cast<int64_t>(mesh.lods[_objectLods[i]].indexCount / 3);
+			_objectLods[i] = static_cast<uint8_t>(lod);
+			_objectLodChanges[i] = _frameNumber + 1;
+			changes++;
+		}
+		//the region is mapped write-combined memory, only write what it is missing
+		if (_objectLodChanges[i] > regionFrame) {
+			instances[i].lod = lod;
+		}
+	}
+	changeCount += changes;
+	triangleDelta += triangles;
+}
+
+void VulkanEngine::buildDrawCommands() {
+	//objects of a mesh are contiguous, so without LODs each mesh is one instanced draw
+	_drawCommands.clear();
+	for (uint32_t i = 0; i < _objects.size(); i++) {
+		if (i == 0 || _objectMeshes[i] != _objectMeshes[i - 1] || _objectLods[i] != _objectLods[i - 1]) {
+			const LodData& lod = _lods[_objects[i].firstLod + _objectLods[i]];
+			DrawCommand drawCommand;
+			drawCommand.indexCount = lod.indexCount;
+			drawCommand.instanceCount = 0;
+			drawCommand.firstIndex = lod.firstIndex;
+			drawCommand.vertexOffset = _objects[i].vertexOffset;
+			drawCommand.firstInstance = i;
+			_drawCommands.push_back(drawCommand);
+		}
+		_drawCommands.back().instanceCount++;
+	}
+}
+
+void VulkanEngine::buildRenderQueue() {
+	TRACE_FUNCTION();
+	//one key per draw, today every draw shares the pipeline and the frame's descriptor set so only the
+	//mesh and depth fields differ; GPU culled frames are a single indirect draw
+	_renderQueue.clear();
+	if (_gpuCulling) {
+		_renderQueue.submit(DrawKey::make(0, 0, 0, 0, 0.0f), 0);
+		return;
+	}
+	_renderQueue.reserve(_drawCommands.size());
+	for (uint32_t i = 0; i < _drawCommands.size(); i++) {
+		uint32_t object = _drawCommands[i].firstInstance;
+		float distance = glm::length(glm::vec3(_transformSystem.worldMatrix(object)[3]) - _cameraPosition);
+		_renderQueue.submit(DrawKey::make(0, 0, 0, _objectMeshes[object], distance / FAR_PLANE), i);
+	}
+	_renderQueue.sort();
+}
+
+void VulkanEngine::recordMainPass(vk::CommandBuffer commandBuffer) {
+	TRACE_FUNCTION();
 	vk::RenderPassBeginInfo renderPassBeginInfo({});
 	vk::ClearColorValue clearColorValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f);
 	vk::ClearValue clearValue = vk::ClearValue();
@@ -505,66 +1060,329 @@ void VulkanEngine::draw() {
 	std::vector<vk::ClearValue> clearValues = { clearValue };
 	renderPassBeginInfo.setClearValues(clearValues);
 	renderPassBeginInfo.setRenderPass(_renderPass);
-	renderPassBeginInfo.setFramebuffer(_frameBuffers[imageIndex]);
+	renderPassBeginInfo.setFramebuffer(_frameBuffers[_imageIndex]);
 	renderPassBeginInfo.renderArea.setExtent(_windowExtent);
 
-	p_commandBuffer->beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-	p_commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, _graphicsPipeline);
+	commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+
+	//the draw list is split across the recorder threads, each records its own secondary command buffer,
+	//GPU culled frames are a single indirect draw
+	vk::CommandBufferInheritanceInfo commandBufferInheritanceInfo({});
+	commandBufferInheritanceInfo.setRenderPass(_renderPass);
+	commandBufferInheritanceInfo.setSubpass(0);
+	commandBufferInheritanceInfo.setFramebuffer(_frameBuffers[_imageIndex]);
+
+	std::vector<vk::CommandBuffer> secondaryCommandBuffers = _commandRecorder.record(currentFrame, commandBufferInheritanceInfo, _renderQueue.size(),
+		[this](vk::CommandBuffer commandBuffer, uint32_t first, uint32_t last) { recordDrawCommands(commandBuffer, first, last); });
+	commandBuffer.executeCommands(secondaryCommandBuffers);
 
+	commandBuffer.endRenderPass();
+}
+
+void VulkanEngine::recordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t first, uint32_t last) {
+	//secondary command buffers inherit no state, every one binds what it needs, but only once
 	vk::Viewport viewport({});
 	viewport.setHeight(static_cast<float>(_windowExtent.height));
 	viewport.setWidth(static_cast<float>(_windowExtent.width));
 	viewport.setMaxDepth(1.0f);
-	p_commandBuffer->setViewport(0, viewport);
+	commandBuffer.setViewport(0, viewport);
 
 	vk::Rect2D scissor({});
 	scissor.extent = _windowExtent;
-	p_commandBuffer->setScissor(0, scissor);
+	commandBuffer.setScissor(0, scissor);
+
+	//every frame binds the same sets, its uniforms and instance region are picked by dynamic offsets
+	//or, for bindless, by the pushed slot
+	if (_bindless) {
+		commandBuffer.pushConstants(_pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawConstants), &_drawConstants[currentFrame]);
+	}
+	std::array<uint32_t, 2> dynamicOffsets = { _frameUniforms.offset, static_cast<uint32_t>(currentFrame * _instanceRegionSize) };
+	uint32_t frameSetIndex = _bindless ? 1 : 0;
+	vk::ArrayProxy<const uint32_t> frameSetOffsets(_bindless ? 1 : 2, dynamicOffsets.data());
+
+	BindCache bindCache(commandBuffer);
+	const std::vector<RenderQueue::Item>& items = _renderQueue.items();
+	for (uint32_t i = first; i < last; i++) {
+		bindCache.bindPipeline(vk::PipelineBindPoint::eGraphics, _graphicsPipeline);
+		if (_bindless) {
+			bindCache.bindDescriptorSet(vk::PipelineBindPoint::eGraphics, _pipelineLayout, 0, _bindlessDescriptors.descriptorSet());
+		}
+		bindCache.bindDescriptorSet(vk::PipelineBindPoint::eGraphics, _pipelineLayout, frameSetIndex, _descriptorSet, frameSetOffsets);
+		bindCache.bindVertexBuffer(_vertexBuffer, 0);
+		bindCache.bindIndexBuffer(_indexBuffer, 0, _indexType);
+		if (_gpuCulling) {
+			commandBuffer.drawIndexedIndirectCount(_cullingPass.indirectBuffer(currentFrame), 0, _cullingPass.countBuffer(currentFrame), 0, _cullingPass.maxDrawCount(), sizeof(vk::DrawIndexedIndirectCommand));
+			continue;
+		}
+		const DrawCommand& drawCommand = _drawCommands[items[i].draw];
+		commandBuffer.drawIndexed(drawCommand.indexCount, drawCommand.instanceCount, drawCommand.firstIndex, drawCommand.vertexOffset, drawCommand.firstInstance);
+	}
+	_bindCount += bindCache.bindCount();
+	_skippedBindCount += bindCache.skippedCount();
+}
+
+void VulkanEngine::draw() {
+	TRACE_FUNCTION();
+	bool measured = _frameNumber >= _config.warmupFrameCount;
+	auto frameStartTime = std::chrono::high_resolution_clock::now();
 	
-	vk::Buffer vertexBuffers[] = { _vertexBuffer };
-	vk::DeviceSize offsets[] = { 0 };
-	p_commandBuffer->bindVertexBuffers(0, vertexBuffers, offsets);
-	p_commandBuffer->bindIndexBuffer(_indexBuffer, 0, vk::IndexType::eUint16);
+	//the frame's resources are free again once the GPU finished the submit that last used them
+	FrameContext& frame = _frames[currentFrame];
+	{
+		TRACE_SCOPE("waitForFrame");
+		vk::SemaphoreWaitInfo semaphoreWaitInfo({}, _frameSemaphore, frame.timelineValue);
+		vk::Result frameWaitResult = _device.waitSemaphores(semaphoreWaitInfo, UINT64_MAX);
+		if (frameWaitResult != vk::Result::eSuccess) {
+			std::string err = std::format("frame wait failure: {} ", vk::to_string(frameWaitResult));
+			throw std::runtime_error(err);
+		}
+	}
+	uint64_t completedValue = _device.getSemaphoreCounterValue(_frameSemaphore);
+	if (measured) {
+		_frameStats.frameWaitMs.push_back(millisecondsSince(frameStartTime));
+		//submitted frames the GPU has not finished yet, the work it overlaps with this frame's recording
+		_frameStats.framesQueued.push_back(static_cast<double>(_frameNumber - completedValue));
+	}
+	_deletionQueue.collect(completedValue, _uploadManager.completedTicket());
+	if (measured) {
+		_frameStats.pendingDeletions.push_back(static_cast<double>(_deletionQueue.pendingCount()));
+		_frameStats.pendingDeletionBytes.push_back(static_cast<double>(_deletionQueue.pendingBytes()));
+	}
+	collectTimestamps(currentFrame);
+	_gpuTrace.collect(currentFrame);
+	if (_gpuCulling) {
+		_cullingPass.validate(currentFrame, instanceRegion(currentFrame));
+	}
+
+	//acquire before sampling input and scene state, so time blocked in acquire delays the sample
+	//instead of adding to the latency of what ends up on screen
+	if (_config.headless) {
+		_imageIndex = static_cast<uint32_t>(_frameNumber % _swapchainImages.size());
+	} else {
+		collectPresentLatencies(0);
+		auto acquireStartTime = std::chrono::high_resolution_clock::now();
+		if (!acquireImage(frame, _imageIndex)) {
+			return;
+		}
+		if (measured) {
+			_frameStats.acquireMs.push_back(millisecondsSince(acquireStartTime));
+		}
+		//with FIFO the acquire returns at vblank, right when an earlier frame reached the screen
+		collectPresentLatencies(0);
+	}
+	auto inputTime = std::chrono::high_resolution_clock::now();
 	
-	p_commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipelineLayout, 0, _descriptorSets[currentFrame], nullptr);
-	p_commandBuffer->drawIndexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+	//uploads queued since the last frame go out as one batch
+	_uploadManager.flush();
+	_cullMatrix = updateUniformBuffers();
+	updateInstances();
+	buildRenderQueue();
+	if (measured) {
+		_frameStats.triangles.push_back(static_cast<double>(_lodTriangles));
+	}
 
-	p_commandBuffer->endRenderPass();
-	p_commandBuffer->end();
+	//async culling goes to the compute queue, where it can overlap the previous frame's rendering, and
+	//hands its results over to the graphics family. They are rewritten from scratch every frame, so
+	//nothing is handed back, the compute family just takes the buffers and discards their contents.
+	if (_asyncCompute) {
+		TRACE_SCOPE("recordAsyncCulling");
+		_device.resetCommandPool(frame.computeCommandPool);
+		frame.computeCommandBuffer.begin(vk::CommandBufferBeginInfo({}));
+		_cullingPass.record(frame.computeCommandBuffer, currentFrame, _frameUniforms.offset, _cullMatrix, _cameraPosition);
+		for (vk::Buffer buffer : { _cullingPass.indirectBuffer(currentFrame), _cullingPass.countBuffer(currentFrame) }) {
+			_queues.releaseBuffer(frame.computeCommandBuffer, buffer, QueueType::eCompute, QueueType::eGraphics,
+				vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eTransferWrite);
+		}
+		frame.computeCommandBuffer.end();
+	}
 
-	vk::SubmitInfo submitInfo({});
+	_device.resetCommandPool(frame.commandPool);
+	vk::CommandBuffer* p_commandBuffer = &frame.commandBuffer;
 
-	std::vector<vk::PipelineStageFlags> waitDstStageMasks = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-	submitInfo.setPWaitDstStageMask(waitDstStageMasks.data());
-	
-	std::vector<vk::Semaphore> waitSemaphores = {_imageAvailableSemaphores[currentFrame]};
-	submitInfo.setWaitSemaphores(waitSemaphores);
+	//CommandBuffer begin recording
+	vk::CommandBufferBeginInfo commandBufferBeginInfo({});
+	p_commandBuffer->begin(commandBufferBeginInfo);
+	_gpuTrace.beginFrame(*p_commandBuffer, currentFrame);
+	_gpuTrace.begin(*p_commandBuffer, "frame");
 
-	std::vector<vk::Semaphore> signalSemaphores = { _renderFinishedSemaphores[currentFrame]};
-	submitInfo.setSignalSemaphores(signalSemaphores);
+	if (_timestampsSupported) {
+		p_commandBuffer->resetQueryPool(_timestampQueryPool, 2 * currentFrame, 2);
+		p_commandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, _timestampQueryPool, 2 * currentFrame);
+		_timestampFrameNumbers[currentFrame] = _frameNumber;
+	}
+	if (_asyncCompute) {
+		for (vk::Buffer buffer : { _cullingPass.indirectBuffer(currentFrame), _cullingPass.countBuffer(currentFrame) }) {
+			_queues.acquireBuffer(*p_commandBuffer, buffer, QueueType::eCompute, QueueType::eGraphics,
+				vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eTransferRead);
+		}
+	}
 
-	submitInfo.setCommandBuffers(_commandBuffers[currentFrame]);
-	std::vector<vk::SubmitInfo> submitInfos = { submitInfo };
+	_bindCount = 0;
+	_skippedBindCount = 0;
+	RenderGraph::PassHook passHook;
+	if (_gpuTrace.enabled()) {
+		passHook = [this](vk::CommandBuffer commandBuffer, const char* passName, bool begin) {
+			if (begin) {
+				_gpuTrace.begin(commandBuffer, passName);
+			} else {
+				_gpuTrace.end(commandBuffer);
+			}
+		};
+	}
+	_renderGraph.setImage(_colorTarget, _config.headless ? _swapchainImages[_imageIndex] : _swapchain.images()[_imageIndex]);
+	_renderGraph.execute(*p_commandBuffer, passHook);
+	if (measured) {
+		_frameStats.binds.push_back(_bindCount);
+		_frameStats.bindsSkipped.push_back(_skippedBindCount);
+	}
+	if (_timestampsSupported) {
+		p_commandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, _timestampQueryPool, 2 * currentFrame + 1);
+	}
+	_gpuTrace.end(*p_commandBuffer);
+	p_commandBuffer->end();
 
-	vk::DeviceQueueCreateInfo deviceQueueCreateInfo({});
-	_graphicsQueue.submit(submitInfos, _inflightFences[currentFrame]);
+	//geometry and objects must not be read before the upload batch that wrote them has executed
+	frame.timelineValue = _frameNumber + 1;
+	for (ResourceHandle resource : _frameResources) {
+		_resources.markUsed(resource, frame.timelineValue);
+	}
+	if (_asyncCompute) {
+		_queues.submit(QueueType::eCompute, { frame.computeCommandBuffer }, { { _uploadManager.timelineSemaphore(), _uploadTicket, vk::PipelineStageFlagBits::eComputeShader } },
+			{ { _computeSemaphore, frame.timelineValue } });
+	}
+	std::vector<SemaphoreWait> waits = { { _uploadManager.timelineSemaphore(), _uploadTicket, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader } };
+	std::vector<SemaphoreSignal> signals = { { _frameSemaphore, frame.timelineValue } };
+	if (_asyncCompute) {
+		//the indirect draws and the validation copy wait for this frame's culling
+		waits.push_back({ _computeSemaphore, frame.timelineValue, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer });
+	}
+	if (!_config.headless) {
+		waits.push_back({ frame.imageAvailableSemaphore, 0, vk::PipelineStageFlagBits::eColorAttachmentOutput });
+		signals.push_back({ _presentSemaphores[_imageIndex], 0 });
+	}
+	_gpuTrace.submitted(currentFrame);
+	_queues.submit(QueueType::eGraphics, { frame.commandBuffer }, waits, signals);
 	
-	vk::PresentInfoKHR presentInfo({});
-	presentInfo.setWaitSemaphores(_renderFinishedSemaphores[currentFrame]);
-	std::vector<vk::SwapchainKHR> swapchains = { _swapchain };
-	presentInfo.setSwapchains(swapchains);
-	presentInfo.setImageIndices(imageIndex);
+	if (!_config.headless) {
+		vk::PresentInfoKHR presentInfo({});
+		presentInfo.setWaitSemaphores(_presentSemaphores[_imageIndex]);
+		std::vector<vk::SwapchainKHR> swapchains = { _swapchain.handle() };
+		presentInfo.setSwapchains(swapchains);
+		presentInfo.setImageIndices(_imageIndex);
+		uint64_t presentId = ++_presentId;
+		vk::PresentIdKHR presentIdInfo(presentId);
+		if (_swapchain.presentWait()) {
+			presentInfo.setPNext(&presentIdInfo);
+		}
+
+		//a swapchain that no longer matches the window still takes this present, it is rebuilt before the next acquire
+		auto presentStartTime = std::chrono::high_resolution_clock::now();
+		try {
+			TRACE_SCOPE("present");
+			if (_queues.queue(QueueType::eGraphics).presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) {
+				_swapchainDirty = true;
+			}
+		} catch (vk::OutOfDateKHRError&) {
+			_swapchainDirty = true;
+		}
+		if (measured) {
+			_frameStats.presentMs.push_back(millisecondsSince(presentStartTime));
+			if (_swapchain.presentWait() && !_swapchainDirty) {
+				_pendingPresents.push_back({ presentId, inputTime });
+			}
+		}
+	}
+
+	if (measured) {
+		_frameStats.cpuFrameMs.push_back(millisecondsSince(frameStartTime));
+	}
+
+	currentFrame = (currentFrame + 1) % _config.framesInFlight;
+	_frameNumber++;
 
-	vk::Result queuePresentResult = _graphicsQueue.presentKHR(presentInfo);
-	if (queuePresentResult != vk::Result::eSuccess) {
-		throw queuePresentResult;
+}
+
+bool VulkanEngine::acquireImage(FrameContext& frame, uint32_t& imageIndex) {
+	TRACE_FUNCTION();
+	while (true) {
+		if (_swapchainDirty && !recreateSwapchain()) {
+			return false;
+		}
+		vk::Result acquireNextImageResult = _device.acquireNextImageKHR(_swapchain.handle(), UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		if (acquireNextImageResult == vk::Result::eErrorOutOfDateKHR) {
+			//nothing was acquired and the semaphore stays unsignaled, try again on a new swapchain
+			_swapchainDirty = true;
+			continue;
+		}
+		if (acquireNextImageResult == vk::Result::eSuboptimalKHR) {
+			//the image can still be presented, rebuild for the next frame
+			_swapchainDirty = true;
+		} else if (acquireNextImageResult != vk::Result::eSuccess) {
+			std::string err = std::format("acquire next image failure: {} ", vk::to_string(acquireNextImageResult));
+			throw std::runtime_error(err);
+		}
+		return true;
 	}
+}
 
-	currentFrame = (currentFrame % 1) % MAX_FRAMES_IN_FLIGHT;
+bool VulkanEngine::recreateSwapchain() {
+	TRACE_FUNCTION();
+	int width = 0, height = 0;
+	SDL_Vulkan_GetDrawableSize(_window, &width, &height);
+	RetiredSwapchain retired;
+	if (!_swapchain.recreate(vk::Extent2D(static_cast<uint32_t>(width), static_cast<uint32_t>(height)), retired)) {
+		return false;
+	}
+	_swapchainDirty = false;
+	_windowExtent = _swapchain.extent();
+	_frameStats.swapchainRecreates = _swapchain.recreateCount();
+	//present ids are per swapchain, the retired one's presents can't be waited on anymore
+	_pendingPresents.clear();
+
+	//frames already submitted still render into and present the retired images, destroy them once
+	//those frames finished instead of waiting for the whole device
+	std::vector<vk::Framebuffer> retiredFramebuffers = std::move(_frameBuffers);
+	std::vector<vk::Semaphore> retiredPresentSemaphores = std::move(_presentSemaphores);
+	_frameBuffers.clear();
+	_presentSemaphores.clear();
+	initFramebuffers();
+	initPresentSemaphores();
+	deferDeletion([this, retired, retiredFramebuffers, retiredPresentSemaphores]() mutable {
+		for (vk::Framebuffer framebuffer : retiredFramebuffers) {
+			_device.destroyFramebuffer(framebuffer);
+		}
+		for (vk::Semaphore semaphore : retiredPresentSemaphores) {
+			_device.destroySemaphore(semaphore);
+		}
+		_swapchain.destroyRetired(retired);
+	});
+	return true;
+}
 
+void VulkanEngine::collectPresentLatencies(uint64_t timeout) {
+	//only polled where the CPU passes anyway, a latency includes the time until that poll
+	while (!_pendingPresents.empty()) {
+		const PendingPresent& pendingPresent = _pendingPresents.front();
+		vk::Result result = _swapchain.waitForPresent(pendingPresent.presentId, timeout);
+		if (result == vk::Result::eTimeout) {
+			return;
+		}
+		if (result == vk::Result::eSuccess || result == vk::Result::eSuboptimalKHR) {
+			_frameStats.inputLatencyMs.push_back(millisecondsSince(pendingPresent.inputTime));
+		}
+		_pendingPresents.pop_front();
+	}
 }
 
 void VulkanEngine::run() {
+	if (_config.headless) {
+		for (uint32_t frame = 0; frame < _config.frameCount; frame++) {
+			draw();
+		}
+		finishFrames();
+		return;
+	}
+
 	SDL_Event e;
     bool bQuit = false;
 	bool stopRendering = false;
@@ -584,6 +1402,9 @@ void VulkanEngine::run() {
                 if (e.window.event == SDL_WINDOWEVENT_RESTORED) {
                     stopRendering = false;
                 }
+                if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    _swapchainDirty = true;
+                }
             }
         }
 
@@ -595,36 +1416,112 @@ void VulkanEngine::run() {
         }
 
         draw();
+
+        if (_config.frameCount != 0 && _frameNumber >= _config.frameCount) {
+            bQuit = true;
+        }
     }
+	finishFrames();
+}
+
+void VulkanEngine::finishFrames() {
+	TRACE_FUNCTION();
+	//oldest frame first, currentFrame is the next one to be reused
 	_device.waitIdle();
+	_deletionQueue.collect(_device.getSemaphoreCounterValue(_frameSemaphore), _uploadManager.completedTicket());
+	for (uint32_t i = 0; i < _config.framesInFlight; i++) {
+		uint32_t frame = (currentFrame + i) % _config.framesInFlight;
+		collectTimestamps(frame);
+		_gpuTrace.collect(frame);
+		if (_gpuCulling) {
+			_cullingPass.validate(frame, instanceRegion(frame));
+		}
+	}
+	if (!_config.headless) {
+		//the last presents are queued but may not be on screen yet, give each up to 100 ms
+		collectPresentLatencies(100'000'000);
+	}
+}
+
+void VulkanEngine::deferDeletion(std::function<void()>&& deletion) {
+	//the next submit signals _frameNumber + 1, whichever frame it belongs to
+	_deletionQueue.push(_frameNumber + 1, 0, std::move(deletion));
 }
 
 void VulkanEngine::destroy() {
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		_device.destroyFence(_inflightFences[i]);
-		_device.destroySemaphore(_imageAvailableSemaphores[i]);
-		_device.destroySemaphore(_renderFinishedSemaphores[i]);
+	_allocator.printStats(std::cout);
+	std::cout << "Uploads: " << _uploadManager.copyCount() << " copies in " << _uploadManager.submitCount() << " submits" << std::endl;
+	if (_config.validateCulling && _gpuCulling) {
+		std::cout << "Culling validated against the CPU reference for " << _cullingPass.validatedFrameCount() << " frames" << std::endl;
+	}
+	MetricSummary framesQueued = FrameStats::summarize(_frameStats.framesQueued);
+	MetricSummary gpuIdle = FrameStats::summarize(_frameStats.gpuIdleMs);
+	std::cout << std::format("Frame pacing: {} frames in flight, {:.2f} frames queued on the GPU on average, GPU idle between frames p50 {:.3f} ms p95 {:.3f} ms",
+		_config.framesInFlight, framesQueued.mean, gpuIdle.p50, gpuIdle.p95) << std::endl;
+	if (!_config.headless) {
+		MetricSummary inputLatency = FrameStats::summarize(_frameStats.inputLatencyMs);
+		std::cout << std::format("Presentation: {}, {} swapchain images, recreated {} times, input to screen p50 {:.3f} ms p95 {:.3f} ms over {} presents",
+			_frameStats.presentMode, _swapchain.imageCount(), _swapchain.recreateCount(), inputLatency.p50, inputLatency.p95, inputLatency.count) << std::endl;
+	}
+	std::cout << std::format("Deletion queue: {} retired ({:.1f} MB), peak {:.1f} MB waiting for the GPU, {} resources ({:.1f} MB) live",
+		_deletionQueue.retiredCount(), _deletionQueue.retiredBytes() / (1024.0 * 1024.0), _deletionQueue.peakPendingBytes() / (1024.0 * 1024.0),
+		_resources.liveCount(), _resources.liveBytes() / (1024.0 * 1024.0)) << std::endl;
+	if (!_config.tracePath.empty()) {
+		_gpuTrace.flush();
+		stopTracing();
+		writeTrace(_config.tracePath);
+		std::cout << std::format("Trace: {} zones written to {}, {} dropped", traceEventCount(), _config.tracePath, droppedTraceEventCount()) << std::endl;
+	}
+	_uploadManager.destroy();
+
+	//after finishFrames() nothing is pending on the GPU, not even what a skipped frame deferred
+	_deletionQueue.flush();
+	for (FrameContext& frame : _frames) {
+		_device.destroyCommandPool(frame.commandPool);
+		if (_asyncCompute) {
+			_device.destroyCommandPool(frame.computeCommandPool);
+		}
+		if (!_config.headless) {
+			_device.destroySemaphore(frame.imageAvailableSemaphore);
+		}
 	}
+	_frames.clear();
+	for (vk::Semaphore semaphore : _presentSemaphores) {
+		_device.destroySemaphore(semaphore);
+	}
+	_presentSemaphores.clear();
+	_device.destroySemaphore(_frameSemaphore);
+	if (_asyncCompute) {
+		_device.destroySemaphore(_computeSemaphore);
+	}
+
+	if (_timestampQueryPool) {
+		_device.destroyQueryPool(_timestampQueryPool);
+	}
+	_gpuTrace.destroy();
 
 	_device.destroyShaderModule(_fragmentShaderModule);
 	_device.destroyShaderModule(_vertexShaderModule);
 	
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		_device.destroyBuffer(_uniformBuffers[i]);
-		_device.freeMemory(_uniformBufferDeviceMemories[i]);
-		_uniformBuffersMapped[i] = nullptr;
-	}
+	_uniformAllocator.destroy();
 
+	if (_bindless) {
+		_bindlessDescriptors.destroy();
+	}
 	_device.destroyDescriptorSetLayout(_descriptorSetLayout);
 	_device.destroyDescriptorPool(_descriptorPool);
 
-	_device.destroyBuffer(_indexBuffer);
-	_device.destroyBuffer(_vertexBuffer);
-	_device.freeMemory(_deviceMemory);
+	_renderGraph.destroy();
+	if (_gpuCulling) {
+		_cullingPass.destroy();
+	}
+	destroyBuffer(_allocator, _device, _instanceBuffer, _instanceBufferAllocation);
+	_resources.destroy();
 
-	_device.destroyCommandPool(_commandPool);
+	_commandRecorder.destroy();
 	_device.destroyRenderPass(_renderPass);
 	_device.destroyPipeline(_graphicsPipeline);
+	_pipelineCache.destroy();
 
 	_device.destroyPipelineLayout(_pipelineLayout);
 	for (vk::Framebuffer fb : _frameBuffers) {
@@ -633,8 +1530,25 @@ void VulkanEngine::destroy() {
 	for (vk::ImageView iv : _imageViews) {
 		_device.destroyImageView(iv);
 	}
-	_device.destroySwapchainKHR(_swapchain);
+	if (_config.headless) {
+		for (size_t i = 0; i < _offscreenImageAllocations.size(); i++) {
+			destroyImage(_allocator, _device, _swapchainImages[i], _offscreenImageAllocations[i]);
+		}
+	} else {
+		_swapchain.destroy();
+	}
+
+	_allocator.destroy();
 	_device.destroy();
-	_instance.destroySurfaceKHR(_surface);
+	if (_surface) {
+		_instance.destroySurfaceKHR(_surface);
+	}
 	_instance.destroy();
+
+	_jobSystem.destroy();
+
+	if (_window) {
+		SDL_DestroyWindow(_window);
+		SDL_Quit();
+	}
 }
\ No newline at end of file
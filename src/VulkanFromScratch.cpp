@@ -1,19 +1,58 @@
 ﻿#include "../include/VulkanEngine.hpp"
 
-int main() {
-	
+int main(int argc, char* argv[]) {
+	EngineConfig config;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--headless") {
+			config.headless = true;
+		} else if (arg == "--frames" && i + 1 < argc) {
+			config.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--objects" && i + 1 < argc) {
+			config.objectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--cpu-draws") {
+			config.gpuCulling = false;
+		} else if (arg == "--validate-culling") {
+			config.validateCulling = true;
+		} else if (arg == "--no-cluster-culling") {
+			config.clusterCulling = false;
+		} else if (arg == "--frames-in-flight" && i + 1 < argc) {
+			config.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--no-bindless") {
+			config.bindless = false;
+		} else if (arg == "--no-async-compute") {
+			config.asyncCompute = false;
+		} else if (arg == "--device" && i + 1 < argc) {
+			config.device = argv[++i];
+		} else if (arg == "--lod-error" && i + 1 < argc) {
+			config.lodErrorPixels = std::stof(argv[++i]);
+		} else if (arg == "--mesh" && i + 1 < argc) {
+			config.meshPath = argv[++i];
+		} else if (arg == "--trace" && i + 1 < argc) {
+			config.tracePath = argv[++i];
+		} else if (arg == "--present" && i + 1 < argc && parsePresentOption(argv[i + 1], config.presentPolicy, config.presentMode)) {
+			i++;
+		} else {
+			std::cout << "usage: " << argv[0] << " [--headless] [--frames N] [--objects N] [--cpu-draws] [--validate-culling] [--no-cluster-culling] [--frames-in-flight 1-4] [--no-bindless] [--no-async-compute] [--device INDEX|TYPE|NAME] [--lod-error PIXELS] [--mesh scene.mesh] [--trace trace.json] [--present latency|power|mailbox|immediate|fifo|fifo-relaxed]" << std::endl;
+			return 1;
+		}
+	}
+
 	try {
-		VulkanEngine *vulkanEngine = new VulkanEngine();
+		VulkanEngine *vulkanEngine = new VulkanEngine(config);
 		vulkanEngine->run();
 		vulkanEngine->destroy();
 	} catch (vk::SystemError& err) {
 		std::cout << "vk::SystemError: " << err.what() << std::endl;
+		return 1;
 	}
 	catch (std::exception& err) {
 		std::cout << "std::Exception: " << err.what() << std::endl;
+		return 1;
 	}
 	catch (...) {
 		std::cout << "unknown error" << std::endl;
+		return 1;
 	}
 
 